@@ -16,6 +16,7 @@
 #include <linux/platform_device.h>
 #include <linux/bootmem.h>
 #include <linux/ion.h>
+#include <linux/async.h>
 #include <asm/mach-types.h>
 #include <mach/msm_memtypes.h>
 #include <mach/board.h>
@@ -2931,6 +2932,9 @@ static int __init m7_panel_init(void)
 {
 	int ret;
 
+	/* mdp/mipi_dsi must be bound before the panel adds its devices */
+	async_synchronize_full_domain(&device_async_display.domain);
+
 	if(panel_type == PANEL_ID_NONE)	{
 		PR_DISP_INFO("%s panel ID = PANEL_ID_NONE\n", __func__);
 		return 0;
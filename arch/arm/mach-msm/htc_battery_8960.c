@@ -19,6 +19,7 @@
 #include <linux/err.h>
 #include <linux/platform_device.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/wakelock.h>
 #include <linux/gpio.h>
 #include <mach/board.h>
@@ -98,6 +99,20 @@ static int context_state;
 #define BATT_SUSPEND_HIGHFREQ_CHECK_TIME	(300)
 #define BATT_TIMER_CHECK_TIME				(360)
 #define BATT_TIMER_UPDATE_TIME				(60)
+#define BATT_TIMER_IDLE_MAX_TIME			(1800)
+#define BATT_EVENT_COALESCE_MS				(2000)
+
+enum {
+	BATT_UPDATE_TIMER = 0,
+	BATT_UPDATE_EVENT,
+	BATT_UPDATE_RESUME,
+	BATT_UPDATE_OTHER,
+	BATT_UPDATE_REASON_MAX,
+};
+
+static const char *batt_update_reason_str[BATT_UPDATE_REASON_MAX] = {
+	"timer", "event", "resume", "other",
+};
 
 #define HTC_EXT_UNKNOWN_USB_CHARGER		(1<<0)
 #define HTC_EXT_CHG_UNDER_RATING		(1<<1)
@@ -187,10 +202,18 @@ struct htc_battery_timer {
 	unsigned int batt_alarm_enabled;
 	unsigned int alarm_timer_flag;
 	unsigned int time_out;
+	unsigned int idle_time;
+	int idle_last_level;
+	unsigned int update_count[BATT_UPDATE_REASON_MAX];
+	unsigned int coalesced_count;
+	unsigned int alarm_count;
+	unsigned int suspend_abort_count;
 	struct work_struct batt_work;
+	struct delayed_work event_work;
 	struct delayed_work unknown_usb_detect_work;
 	struct alarm batt_check_wakeup_alarm;
 	struct timer_list batt_timer;
+	struct timer_list batt_idle_timer;
 	struct workqueue_struct *batt_wq;
 	struct wake_lock battery_lock;
 	struct wake_lock unknown_usb_detect_lock;
@@ -255,7 +278,7 @@ int htc_is_wireless_charger(void)
 		return -1;
 }
 
-int htc_batt_schedule_batt_info_update(void)
+static int batt_schedule_update(int reason)
 {
 	if (htc_batt_info.state & STATE_WORKQUEUE_PENDING) {
 		htc_batt_info.state &= ~STATE_WORKQUEUE_PENDING;
@@ -265,10 +288,34 @@ int htc_batt_schedule_batt_info_update(void)
 
 	
 	wake_lock(&htc_batt_timer.battery_lock);
-	queue_work(htc_batt_timer.batt_wq, &htc_batt_timer.batt_work);
+	if (queue_work(htc_batt_timer.batt_wq, &htc_batt_timer.batt_work))
+		htc_batt_timer.update_count[reason]++;
+	else
+		htc_batt_timer.coalesced_count++;
 	return 0;
 }
 
+int htc_batt_schedule_batt_info_update(void)
+{
+	return batt_schedule_update(BATT_UPDATE_OTHER);
+}
+
+static void batt_event_worker(struct work_struct *work)
+{
+	batt_schedule_update(BATT_UPDATE_EVENT);
+}
+
+static void batt_schedule_event_update(void)
+{
+	if (htc_batt_info.state & STATE_PREPARE) {
+		htc_batt_info.state |= STATE_WORKQUEUE_PENDING;
+		return;
+	}
+	if (!queue_delayed_work(htc_batt_timer.batt_wq, &htc_batt_timer.event_work,
+				msecs_to_jiffies(BATT_EVENT_COALESCE_MS)))
+		htc_batt_timer.coalesced_count++;
+}
+
 static void batt_lower_voltage_alarm_handler(int status)
 {
 	wake_lock(&voltage_alarm_wake_lock);
@@ -280,7 +327,7 @@ static void batt_lower_voltage_alarm_handler(int status)
 		if (critical_alarm_level == 0)
 			critical_shutdown = 1;
 		critical_alarm_level--;
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 	} else {
 		pr_info("[BATT] voltage_alarm level=%d (%d mV) raised back.\n",
 			critical_alarm_level,
@@ -344,12 +391,12 @@ int htc_gauge_event_notify(enum htc_gauge_event event)
 		} else {
 			pr_debug("[BATT] %s(): Run, htc_batt_info.state=0x%x\n",
 					__func__, htc_batt_info.state);
-			htc_batt_schedule_batt_info_update();
+			batt_schedule_update(BATT_UPDATE_EVENT);
 		}
 		break;
 	case HTC_GAUGE_EVENT_EOC:
 	case HTC_GAUGE_EVENT_OVERLOAD:
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_GAUGE_EVENT_BATT_REMOVED:
 		if (!(get_kernel_flag() & KERNEL_FLAG_TEST_PWR_SUPPLY)) {
@@ -360,7 +407,10 @@ int htc_gauge_event_notify(enum htc_gauge_event event)
 		break;
 	case HTC_GAUGE_EVENT_EOC_STOP_CHG:
 		sw_stimer_counter = 0;
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
+		break;
+	case HTC_GAUGE_EVENT_OCV_UPDATE:
+		batt_schedule_event_update();
 		break;
 	default:
 		pr_info("[BATT] unsupported gauge event(%d)\n", event);
@@ -381,18 +431,18 @@ int htc_charger_event_notify(enum htc_charger_event event)
 	case HTC_CHARGER_EVENT_SRC_INTERNAL:
 		htc_ext_5v_output_now = 1;
 		BATT_LOG("%s htc_ext_5v_output_now:%d", __func__, htc_ext_5v_output_now);
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_SRC_CLEAR:
 		latest_chg_src = CHARGER_BATTERY;
 		htc_ext_5v_output_now = 0;
 		BATT_LOG("%s htc_ext_5v_output_now:%d", __func__, htc_ext_5v_output_now);
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_VBUS_OUT:
 	case HTC_CHARGER_EVENT_SRC_NONE: 
 		latest_chg_src = CHARGER_BATTERY;
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_SRC_USB: 
 		if (force_fast_charge == 1) {
@@ -402,19 +452,19 @@ int htc_charger_event_notify(enum htc_charger_event event)
 			printk("[FASTCHARGE] NOT set, using normal CHARGER_USB");
 			latest_chg_src = CHARGER_USB;
 		}
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_SRC_AC: 
 		latest_chg_src = CHARGER_AC;
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_SRC_WIRELESS: 
 		latest_chg_src = CHARGER_WIRELESS;
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_SRC_DETECTING: 
 		latest_chg_src = CHARGER_DETECTING;
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		wake_lock(&htc_batt_timer.unknown_usb_detect_lock);
 		queue_delayed_work(htc_batt_timer.batt_wq,
 				&htc_batt_timer.unknown_usb_detect_work,
@@ -429,17 +479,20 @@ int htc_charger_event_notify(enum htc_charger_event event)
 			printk("[FASTCHARGE] NOT set, using normal CHARGER_UNKNOWN_USB");
 			latest_chg_src = CHARGER_UNKNOWN_USB;
 		}
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_OVP:
 	case HTC_CHARGER_EVENT_OVP_RESOLVE:
 	case HTC_CHARGER_EVENT_SRC_UNDER_RATING:
 	case HTC_CHARGER_EVENT_SAFETY_TIMEOUT:
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
 		break;
 	case HTC_CHARGER_EVENT_SRC_MHL_AC:
 		latest_chg_src = CHARGER_MHL_AC;
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_EVENT);
+		break;
+	case HTC_CHARGER_EVENT_STATE_CHANGE:
+		batt_schedule_event_update();
 		break;
 	case HTC_CHARGER_EVENT_READY:
 		if (!htc_batt_info.icharger) {
@@ -1020,11 +1073,46 @@ static int htc_batt_get_battery_info(struct battery_info_reply *htc_batt_update)
 	return 0;
 }
 
+static bool batt_idle_backoff(void)
+{
+	return (htc_batt_info.state & STATE_EARLY_SUSPEND) &&
+		htc_batt_info.rep.charging_source == CHARGER_BATTERY &&
+		!suspend_highfreq_check_reason;
+}
+
+static u32 batt_next_check_time(void)
+{
+	u32 time_out = htc_batt_timer.time_out;
+	u32 max_time = max_t(u32, time_out, BATT_TIMER_IDLE_MAX_TIME);
+
+	if (!batt_idle_backoff() || !time_out) {
+		htc_batt_timer.idle_time = 0;
+		return time_out;
+	}
+
+	if (!htc_batt_timer.idle_time ||
+			htc_batt_timer.idle_last_level != htc_batt_info.rep.level)
+		htc_batt_timer.idle_time = time_out;
+	else
+		htc_batt_timer.idle_time = min_t(u32,
+				htc_batt_timer.idle_time * 2, max_time);
+	htc_batt_timer.idle_last_level = htc_batt_info.rep.level;
+
+	return htc_batt_timer.idle_time;
+}
+
 static void batt_set_check_timer(u32 seconds)
 {
+	struct timer_list *timer = &htc_batt_timer.batt_timer;
+	struct timer_list *other = &htc_batt_timer.batt_idle_timer;
+
+	/* charging and safety checks must not wait for the cpu to wake up */
+	if (batt_idle_backoff())
+		swap(timer, other);
+
 	pr_debug("[BATT] %s(%u sec)\n", __func__, seconds);
-	mod_timer(&htc_batt_timer.batt_timer,
-			jiffies + msecs_to_jiffies(seconds * 1000));
+	del_timer(other);
+	mod_timer(timer, jiffies + msecs_to_jiffies(seconds * 1000));
 }
 
 
@@ -1114,12 +1202,13 @@ static void batt_regular_timer_handler(unsigned long data)
 		htc_batt_info.state &= ~STATE_WORKQUEUE_PENDING;
 		pr_debug("[BATT] %s(): Run, htc_batt_info.state=0x%x\n",
 				__func__, htc_batt_info.state);
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_TIMER);
 	}
 }
 
 static void batt_check_alarm_handler(struct alarm *alarm)
 {
+	htc_batt_timer.alarm_count++;
 	BATT_LOG("alarm handler, but do nothing.");
 	return;
 }
@@ -1533,7 +1622,7 @@ static void batt_worker(struct work_struct *work)
 	
 	
 	del_timer_sync(&htc_batt_timer.batt_timer);
-	batt_set_check_timer(htc_batt_timer.time_out);
+	del_timer_sync(&htc_batt_timer.batt_idle_timer);
 
 
 	htc_batt_timer.batt_alarm_status = 0;
@@ -1552,6 +1641,8 @@ static void batt_worker(struct work_struct *work)
 	
 	batt_level_adjust(time_since_last_update_ms);
 
+	batt_set_check_timer(batt_next_check_time());
+
 	
 	if (critical_shutdown) {
 		BATT_LOG("critical shutdown (set level=0 to force shutdown)");
@@ -2011,6 +2102,7 @@ static int htc_battery_prepare(struct device *dev)
 			__func__, htc_batt_timer.total_time_ms,
 			suspend_highfreq_check_reason,
 			batt_temp, sensor0_temp);
+		htc_batt_timer.suspend_abort_count++;
 		htc_batt_schedule_batt_info_update();
 		return -EBUSY;
 	}
@@ -2068,12 +2160,54 @@ static void htc_battery_complete(struct device *dev)
 				"(suspend_highfreq_check_reason=0x%x, "
 				"htc_batt_info.state=0x%x)",
 				suspend_highfreq_check_reason, htc_batt_info.state);
-		htc_batt_schedule_batt_info_update();
+		batt_schedule_update(BATT_UPDATE_RESUME);
 	}
 
 	return;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int htc_battery_wakeup_stats_show(struct seq_file *s, void *unused)
+{
+	int i;
+
+	for (i = 0; i < BATT_UPDATE_REASON_MAX; i++)
+		seq_printf(s, "%s: %u\n", batt_update_reason_str[i],
+				htc_batt_timer.update_count[i]);
+	seq_printf(s, "coalesced: %u\n", htc_batt_timer.coalesced_count);
+	seq_printf(s, "alarm: %u\n", htc_batt_timer.alarm_count);
+	seq_printf(s, "suspend_abort: %u\n", htc_batt_timer.suspend_abort_count);
+	seq_printf(s, "poll_interval: %u\n", htc_batt_timer.idle_time ?
+			htc_batt_timer.idle_time : htc_batt_timer.time_out);
+	return 0;
+}
+
+static int htc_battery_wakeup_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, htc_battery_wakeup_stats_show, NULL);
+}
+
+static const struct file_operations htc_battery_wakeup_stats_fops = {
+	.open		= htc_battery_wakeup_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void htc_battery_debugfs_init(void)
+{
+	struct dentry *dent;
+
+	dent = debugfs_create_dir("htc_battery", NULL);
+	if (IS_ERR_OR_NULL(dent))
+		return;
+	debugfs_create_file("wakeup_stats", S_IRUGO, dent, NULL,
+				&htc_battery_wakeup_stats_fops);
+}
+#else
+static inline void htc_battery_debugfs_init(void) {}
+#endif
+
 static struct dev_pm_ops htc_battery_8960_pm_ops = {
 	.prepare = htc_battery_prepare,
 	.complete = htc_battery_complete,
@@ -2160,10 +2294,13 @@ static int htc_battery_probe(struct platform_device *pdev)
 #endif
 
 	INIT_WORK(&htc_batt_timer.batt_work, batt_worker);
+	INIT_DELAYED_WORK(&htc_batt_timer.event_work, batt_event_worker);
 	INIT_DELAYED_WORK(&htc_batt_timer.unknown_usb_detect_work,
 							unknown_usb_detect_worker);
 	init_timer(&htc_batt_timer.batt_timer);
 	htc_batt_timer.batt_timer.function = batt_regular_timer_handler;
+	init_timer_deferrable(&htc_batt_timer.batt_idle_timer);
+	htc_batt_timer.batt_idle_timer.function = batt_regular_timer_handler;
 	alarm_init(&htc_batt_timer.batt_check_wakeup_alarm,
 			ANDROID_ALARM_ELAPSED_REALTIME_WAKEUP,
 			batt_check_alarm_handler);
@@ -2233,6 +2370,7 @@ static int htc_battery_probe(struct platform_device *pdev)
 
 htc_batt_timer.time_out = BATT_TIMER_UPDATE_TIME;
 batt_set_check_timer(htc_batt_timer.time_out);
+	htc_battery_debugfs_init();
 	BATT_LOG("htc_battery_probe(): finish");
 
 fail:
@@ -32,6 +32,7 @@ enum htc_charger_event {
 	HTC_CHARGER_EVENT_SRC_UNKNOWN_USB,
 	HTC_CHARGER_EVENT_SRC_UNDER_RATING,
 	HTC_CHARGER_EVENT_SAFETY_TIMEOUT,
+	HTC_CHARGER_EVENT_STATE_CHANGE,
 };
 
 enum htc_charging_cfg {
@@ -29,6 +29,8 @@
 #include <linux/wakelock.h>
 #include <linux/delay.h>
 #include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 
 #include <asm/uaccess.h>
 #include <asm/setup.h>
@@ -46,6 +48,28 @@ static const char *pil_states[] = {
 	[PIL_ONLINE] = "ONLINE",
 };
 
+struct pil_seg {
+	struct work_struct work;
+	struct pil_device *pil;
+	const struct elf32_phdr *phdr;
+	unsigned num;
+	bool loadable;
+	u32 paddr;
+	u32 filesz;
+	u32 memsz;
+	int ret;
+	s64 load_us;
+};
+
+struct pil_timing {
+	s64 mdt_us;
+	s64 segs_us;
+	s64 auth_us;
+	s64 total_us;
+	int nr_segs;
+	struct pil_seg *segs;
+};
+
 struct pil_device {
 	struct pil_desc *desc;
 	int count;
@@ -55,12 +79,18 @@ struct pil_device {
 	struct module *owner;
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *dentry;
+	struct dentry *timing_dentry;
 #endif
 	struct delayed_work proxy;
 	struct wake_lock wlock;
 	char wake_name[32];
+	struct pil_timing timing;
 };
 
+#define PIL_LOAD_WORKERS	4
+
+static struct workqueue_struct *pil_load_wq;
+
 #define to_pil_device(d) container_of(d, struct pil_device, dev)
 
 extern struct completion pil_work_finished;
@@ -137,13 +167,18 @@ static void pil_proxy_unvote(struct pil_device *pil, unsigned long timeout)
 
 #define IOMAP_SIZE SZ_4M
 
+#define segment_is_hash(flag) (((flag) & (0x7 << 24)) == (0x2 << 24))
+
+static int segment_is_loadable(const struct elf32_phdr *p)
+{
+	return (p->p_type == PT_LOAD) && !segment_is_hash(p->p_flags);
+}
+
 static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 		struct pil_device *pil)
 {
 	int ret = 0, count, paddr;
 	char fw_name[30];
-	const struct firmware *fw = NULL;
-	const u8 *data;
 
 	if (memblock_overlaps_memory(phdr->p_paddr, phdr->p_memsz)) {
 		dev_err(&pil->dev, "%s: kernel memory would be overwritten "
@@ -156,26 +191,26 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 	if (phdr->p_filesz) {
 		snprintf(fw_name, ARRAY_SIZE(fw_name), "%s.b%02d",
 				pil->desc->name, num);
-		ret = request_firmware(&fw, fw_name, &pil->dev);
-		if (ret) {
+		ret = request_firmware_direct(fw_name, &pil->dev,
+					      phdr->p_paddr, phdr->p_filesz);
+		if (ret < 0) {
 			dev_err(&pil->dev, "%s: Failed to locate blob %s\n",
 					pil->desc->name, fw_name);
 			return ret;
 		}
 
-		if (fw->size != phdr->p_filesz) {
+		if (ret != phdr->p_filesz) {
 			dev_err(&pil->dev, "%s: Blob size %u doesn't match "
-					"%u\n", pil->desc->name, fw->size,
+					"%u\n", pil->desc->name, ret,
 					phdr->p_filesz);
-			ret = -EPERM;
-			goto release_fw;
+			return -EPERM;
 		}
+		ret = 0;
 	}
 
 	
-	count = phdr->p_filesz;
-	paddr = phdr->p_paddr;
-	data = fw ? fw->data : NULL;
+	paddr = phdr->p_paddr + phdr->p_filesz;
+	count = phdr->p_memsz - phdr->p_filesz;
 	while (count > 0) {
 		int size;
 		u8 __iomem *buf;
@@ -185,70 +220,102 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 		if (!buf) {
 			dev_err(&pil->dev, "%s: Failed to map memory\n",
 					pil->desc->name);
-			ret = -ENOMEM;
-			goto release_fw;
+			return -ENOMEM;
 		}
-		memcpy(buf, data, size);
+		memset(buf, 0, size);
 		iounmap(buf);
 
 		count -= size;
 		paddr += size;
-		data += size;
 	}
 
-	
-	count = phdr->p_memsz - phdr->p_filesz;
-	while (count > 0) {
-		int size;
-		u8 __iomem *buf;
+	return ret;
+}
 
-		size = min_t(size_t, IOMAP_SIZE, count);
-		buf = ioremap(paddr, size);
-		if (!buf) {
-			dev_err(&pil->dev, "%s: Failed to map memory\n",
-					pil->desc->name);
-			ret = -ENOMEM;
-			goto release_fw;
-		}
-		memset(buf, 0, size);
-		iounmap(buf);
+static void pil_load_seg_work(struct work_struct *work)
+{
+	struct pil_seg *seg = container_of(work, struct pil_seg, work);
+	ktime_t start = ktime_get();
 
-		count -= size;
-		paddr += size;
+	seg->ret = load_segment(seg->phdr, seg->num, seg->pil);
+	seg->load_us = ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+static int load_segments(struct pil_device *pil, const struct elf32_phdr *phdr,
+			 int phnum)
+{
+	struct pil_seg *segs, *seg;
+	int i, ret = 0;
+
+	segs = kcalloc(phnum, sizeof(*segs), GFP_KERNEL);
+	if (!segs)
+		return -ENOMEM;
+
+	for (i = 0; i < phnum; i++, phdr++) {
+		seg = &segs[i];
+		seg->pil = pil;
+		seg->phdr = phdr;
+		seg->num = i;
+		seg->paddr = phdr->p_paddr;
+		seg->filesz = phdr->p_filesz;
+		seg->memsz = phdr->p_memsz;
+		seg->loadable = segment_is_loadable(phdr);
+		if (!seg->loadable)
+			continue;
+
+		INIT_WORK(&seg->work, pil_load_seg_work);
+		queue_work(pil_load_wq, &seg->work);
 	}
 
-	if (pil->desc->ops->verify_blob) {
-		ret = pil->desc->ops->verify_blob(pil->desc, phdr->p_paddr,
-					  phdr->p_memsz);
+	for (i = 0; i < phnum; i++) {
+		seg = &segs[i];
+		if (!seg->loadable)
+			continue;
+
+		flush_work(&seg->work);
 		if (ret)
-			dev_err(&pil->dev, "%s: Blob%u failed verification\n",
-				pil->desc->name, num);
+			continue;
+
+		ret = seg->ret;
+		if (ret) {
+			dev_err(&pil->dev, "%s: Failed to load segment %d\n",
+					pil->desc->name, i);
+			continue;
+		}
+
+		if (pil->desc->ops->verify_blob) {
+			ret = pil->desc->ops->verify_blob(pil->desc,
+					seg->paddr, seg->memsz);
+			if (ret)
+				dev_err(&pil->dev, "%s: Blob%u failed "
+					"verification\n", pil->desc->name, i);
+		}
 	}
 
-release_fw:
-	release_firmware(fw);
-	return ret;
-}
+	for (i = 0; i < phnum; i++)
+		segs[i].phdr = NULL;
 
-#define segment_is_hash(flag) (((flag) & (0x7 << 24)) == (0x2 << 24))
+	kfree(pil->timing.segs);
+	pil->timing.segs = segs;
+	pil->timing.nr_segs = phnum;
 
-static int segment_is_loadable(const struct elf32_phdr *p)
-{
-	return (p->p_type == PT_LOAD) && !segment_is_hash(p->p_flags);
+	return ret;
 }
 
 static DECLARE_RWSEM(pil_pm_rwsem);
 
 static int load_image(struct pil_device *pil)
 {
-	int i, ret;
+	int ret;
 	char fw_name[30];
 	struct elf32_hdr *ehdr;
 	const struct elf32_phdr *phdr;
 	const struct firmware *fw;
 	unsigned long proxy_timeout = pil->desc->proxy_timeout;
+	ktime_t start, t;
 
 	down_read(&pil_pm_rwsem);
+	start = ktime_get();
 	snprintf(fw_name, sizeof(fw_name), "%s.mdt", pil->desc->name);
 	ret = request_firmware(&fw, fw_name, &pil->dev);
 	if (ret) {
@@ -292,18 +359,14 @@ static int load_image(struct pil_device *pil)
 		goto release_fw;
 	}
 
-	phdr = (const struct elf32_phdr *)(fw->data + sizeof(struct elf32_hdr));
-	for (i = 0; i < ehdr->e_phnum; i++, phdr++) {
-		if (!segment_is_loadable(phdr))
-			continue;
+	t = ktime_get();
+	pil->timing.mdt_us = ktime_to_us(ktime_sub(t, start));
 
-		ret = load_segment(phdr, i, pil);
-		if (ret) {
-			dev_err(&pil->dev, "%s: Failed to load segment %d\n",
-					pil->desc->name, i);
-			goto release_fw;
-		}
-	}
+	phdr = (const struct elf32_phdr *)(fw->data + sizeof(struct elf32_hdr));
+	ret = load_segments(pil, phdr, ehdr->e_phnum);
+	pil->timing.segs_us = ktime_to_us(ktime_sub(ktime_get(), t));
+	if (ret)
+		goto release_fw;
 
 	ret = pil_proxy_vote(pil);
 	if (ret) {
@@ -312,7 +375,9 @@ static int load_image(struct pil_device *pil)
 		goto release_fw;
 	}
 
+	t = ktime_get();
 	ret = pil->desc->ops->auth_and_reset(pil->desc);
+	pil->timing.auth_us = ktime_to_us(ktime_sub(ktime_get(), t));
 	if (ret) {
 		dev_err(&pil->dev, "%s: Failed to bring out of reset\n",
 				pil->desc->name);
@@ -324,6 +389,7 @@ err_boot:
 	pil_proxy_unvote(pil, proxy_timeout);
 release_fw:
 	release_firmware(fw);
+	pil->timing.total_us = ktime_to_us(ktime_sub(ktime_get(), start));
 out:
 	up_read(&pil_pm_rwsem);
 	return ret;
@@ -547,7 +613,45 @@ static const struct file_operations msm_pil_debugfs_fops = {
 	.write	= msm_pil_debugfs_write,
 };
 
+static int msm_pil_timing_show(struct seq_file *m, void *unused)
+{
+	struct pil_device *pil = m->private;
+	struct pil_timing *t = &pil->timing;
+	int i;
+
+	mutex_lock(&pil->lock);
+	seq_printf(m, "mdt: %lld us\n", t->mdt_us);
+	seq_printf(m, "segments: %lld us\n", t->segs_us);
+	seq_printf(m, "auth_and_reset: %lld us\n", t->auth_us);
+	seq_printf(m, "total: %lld us\n", t->total_us);
+	for (i = 0; i < t->nr_segs; i++) {
+		struct pil_seg *seg = &t->segs[i];
+
+		if (!seg->loadable)
+			continue;
+		seq_printf(m, "seg %02d: paddr %08x filesz %8u memsz %8u "
+			   "%lld us%s\n", i, seg->paddr, seg->filesz,
+			   seg->memsz, seg->load_us, seg->ret ? " failed" : "");
+	}
+	mutex_unlock(&pil->lock);
+
+	return 0;
+}
+
+static int msm_pil_timing_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_pil_timing_show, inode->i_private);
+}
+
+static const struct file_operations msm_pil_timing_fops = {
+	.open		= msm_pil_timing_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct dentry *pil_base_dir;
+static struct dentry *pil_timing_dir;
 
 static int __init msm_pil_debugfs_init(void)
 {
@@ -557,6 +661,8 @@ static int __init msm_pil_debugfs_init(void)
 		return -ENOMEM;
 	}
 
+	pil_timing_dir = debugfs_create_dir("timing", pil_base_dir);
+
 	return 0;
 }
 
@@ -572,11 +678,19 @@ static int msm_pil_debugfs_add(struct pil_device *pil)
 
 	pil->dentry = debugfs_create_file(pil->desc->name, S_IRUGO | S_IWUSR,
 				pil_base_dir, pil, &msm_pil_debugfs_fops);
-	return !pil->dentry ? -ENOMEM : 0;
+	if (!pil->dentry)
+		return -ENOMEM;
+
+	if (pil_timing_dir)
+		pil->timing_dentry = debugfs_create_file(pil->desc->name,
+				S_IRUGO, pil_timing_dir, pil,
+				&msm_pil_timing_fops);
+	return 0;
 }
 
 static void msm_pil_debugfs_remove(struct pil_device *pil)
 {
+	debugfs_remove(pil->timing_dentry);
 	debugfs_remove(pil->dentry);
 }
 #else
@@ -603,6 +717,7 @@ static void pil_device_release(struct device *dev)
 	struct pil_device *pil = to_pil_device(dev);
 	wake_lock_destroy(&pil->wlock);
 	mutex_destroy(&pil->lock);
+	kfree(pil->timing.segs);
 	kfree(pil);
 }
 
@@ -692,9 +807,18 @@ static struct notifier_block pil_pm_notifier = {
 
 static int __init msm_pil_init(void)
 {
-	int ret = msm_pil_debugfs_init();
-	if (ret)
+	int ret;
+
+	pil_load_wq = alloc_workqueue("pil_load", WQ_UNBOUND,
+				      PIL_LOAD_WORKERS);
+	if (!pil_load_wq)
+		return -ENOMEM;
+
+	ret = msm_pil_debugfs_init();
+	if (ret) {
+		destroy_workqueue(pil_load_wq);
 		return ret;
+	}
 	register_pm_notifier(&pil_pm_notifier);
 	return bus_register(&pil_bus_type);
 }
@@ -704,6 +828,7 @@ static void __exit msm_pil_exit(void)
 {
 	bus_unregister(&pil_bus_type);
 	unregister_pm_notifier(&pil_pm_notifier);
+	destroy_workqueue(pil_load_wq);
 	msm_pil_debugfs_exit();
 }
 module_exit(msm_pil_exit);
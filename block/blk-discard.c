@@ -0,0 +1,414 @@
+/*
+ * Deferred discard: freed extents are merged and discarded in large
+ * chunks once the device has been idle for a while and, by default,
+ * the screen is off.  Any other I/O on the disk preempts a burst.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/slab.h>
+#include <linux/blk-discard.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
+
+#define BLK_DISCARD_MAX_EXTENTS	16384
+
+struct blk_discard_extent {
+	struct rb_node	node;
+	sector_t	start;
+	sector_t	len;
+};
+
+static unsigned int idle_ms = 2000;
+module_param(idle_ms, uint, 0644);
+
+static unsigned int max_kb = 16384;
+module_param(max_kb, uint, 0644);
+
+static bool screen_off_only = true;
+module_param(screen_off_only, bool, 0644);
+
+static LIST_HEAD(blk_discard_list);
+static DEFINE_MUTEX(blk_discard_list_lock);
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static bool blk_discard_screen_off;
+#else
+static bool blk_discard_screen_off = true;
+#endif
+
+static inline struct blk_discard_extent *bdd_entry(struct rb_node *n)
+{
+	return n ? rb_entry(n, struct blk_discard_extent, node) : NULL;
+}
+
+static struct blk_discard_extent *bdd_prev(struct blk_discard_defer *dd,
+					   sector_t sector)
+{
+	struct rb_node *n = dd->root.rb_node;
+	struct blk_discard_extent *ext, *prev = NULL;
+
+	while (n) {
+		ext = bdd_entry(n);
+		if (ext->start <= sector) {
+			prev = ext;
+			n = n->rb_right;
+		} else {
+			n = n->rb_left;
+		}
+	}
+	return prev;
+}
+
+static void bdd_link(struct blk_discard_defer *dd,
+		     struct blk_discard_extent *new)
+{
+	struct rb_node **p = &dd->root.rb_node, *parent = NULL;
+
+	while (*p) {
+		parent = *p;
+		if (new->start < bdd_entry(parent)->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&new->node, parent, p);
+	rb_insert_color(&new->node, &dd->root);
+	dd->nr_extents++;
+}
+
+static void bdd_erase(struct blk_discard_defer *dd,
+		      struct blk_discard_extent *ext)
+{
+	rb_erase(&ext->node, &dd->root);
+	dd->nr_extents--;
+	kfree(ext);
+}
+
+static void bdd_drop_all(struct blk_discard_defer *dd)
+{
+	struct blk_discard_extent *ext;
+
+	while ((ext = bdd_entry(rb_first(&dd->root))) != NULL)
+		bdd_erase(dd, ext);
+	dd->stats.pending = 0;
+}
+
+static bool bdd_may_run(struct blk_discard_defer *dd)
+{
+	return !dd->disabled && (!screen_off_only || blk_discard_screen_off);
+}
+
+static unsigned long bdd_ios(struct blk_discard_defer *dd)
+{
+	struct hd_struct *part = &dd->bdev->bd_disk->part0;
+
+	return part_stat_read(part, ios[READ]) +
+		part_stat_read(part, ios[WRITE]);
+}
+
+static bool bdd_busy(struct blk_discard_defer *dd)
+{
+	struct request_queue *q = bdev_get_queue(dd->bdev);
+
+	return part_in_flight(&dd->bdev->bd_disk->part0) ||
+		q->rq.count[BLK_RW_SYNC] || q->rq.count[BLK_RW_ASYNC];
+}
+
+static void bdd_kick(struct blk_discard_defer *dd)
+{
+	if (dd->stats.pending && bdd_may_run(dd))
+		queue_delayed_work(system_freezable_wq, &dd->work,
+				   msecs_to_jiffies(idle_ms));
+}
+
+static void blk_discard_work(struct work_struct *work)
+{
+	struct blk_discard_defer *dd = container_of(to_delayed_work(work),
+					struct blk_discard_defer, work);
+	struct blk_discard_extent *ext;
+	unsigned long ios = bdd_ios(dd);
+	sector_t start, len;
+	int ret;
+
+	if (!bdd_may_run(dd))
+		return;
+
+	if (ios != dd->last_ios || bdd_busy(dd)) {
+		dd->last_ios = ios;
+		goto resched;
+	}
+
+	dd->stats.bursts++;
+	for (;;) {
+		mutex_lock(&dd->lock);
+		ext = bdd_entry(rb_first(&dd->root));
+		if (!ext) {
+			mutex_unlock(&dd->lock);
+			break;
+		}
+		start = ext->start;
+		len = min_t(sector_t, ext->len, max(max_kb, 1U) << 1);
+		ext->start += len;
+		ext->len -= len;
+		if (!ext->len)
+			bdd_erase(dd, ext);
+		dd->stats.pending -= len << 9;
+		dd->inflight_start = start;
+		dd->inflight_len = len;
+		mutex_unlock(&dd->lock);
+
+		ret = blkdev_issue_discard(dd->bdev, start, len, GFP_NOFS, 0);
+
+		mutex_lock(&dd->lock);
+		dd->inflight_len = 0;
+		if (ret) {
+			dd->stats.errors++;
+			dd->stats.dropped += len << 9;
+		} else {
+			dd->stats.discarded += len << 9;
+		}
+		if (ret == -EOPNOTSUPP) {
+			dd->disabled = true;
+			dd->stats.dropped += dd->stats.pending;
+			bdd_drop_all(dd);
+		}
+		mutex_unlock(&dd->lock);
+		wake_up_all(&dd->wait);
+
+		if (ret == -EOPNOTSUPP)
+			return;
+		if (!bdd_may_run(dd) || bdd_busy(dd)) {
+			if (dd->stats.pending)
+				dd->stats.preempted++;
+			break;
+		}
+	}
+	dd->last_ios = bdd_ios(dd);
+resched:
+	bdd_kick(dd);
+}
+
+int blk_discard_defer_add(struct blk_discard_defer *dd, sector_t sector,
+			  sector_t nr_sects)
+{
+	struct blk_discard_extent *ext, *next, *new;
+	sector_t end = sector + nr_sects, old;
+	int ret = 0;
+
+	if (!nr_sects)
+		return 0;
+
+	new = kmalloc(sizeof(*new), GFP_NOFS);
+
+	mutex_lock(&dd->lock);
+	if (dd->disabled) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	ext = bdd_prev(dd, sector);
+	if (ext && ext->start + ext->len >= sector) {
+		old = ext->len;
+		if (ext->start + ext->len < end)
+			ext->len = end - ext->start;
+		dd->stats.pending += (ext->len - old) << 9;
+	} else {
+		if (!new || dd->nr_extents >= BLK_DISCARD_MAX_EXTENTS) {
+			dd->stats.dropped += nr_sects << 9;
+			ret = -ENOMEM;
+			goto out;
+		}
+		new->start = sector;
+		new->len = nr_sects;
+		bdd_link(dd, new);
+		dd->stats.pending += nr_sects << 9;
+		ext = new;
+		new = NULL;
+	}
+
+	while ((next = bdd_entry(rb_next(&ext->node))) != NULL &&
+	       next->start <= ext->start + ext->len) {
+		old = ext->len;
+		if (next->start + next->len > ext->start + ext->len)
+			ext->len = next->start + next->len - ext->start;
+		dd->stats.pending += (ext->len - old) << 9;
+		dd->stats.pending -= next->len << 9;
+		bdd_erase(dd, next);
+	}
+	dd->stats.deferred += nr_sects << 9;
+	bdd_kick(dd);
+out:
+	mutex_unlock(&dd->lock);
+	kfree(new);
+	return ret;
+}
+EXPORT_SYMBOL(blk_discard_defer_add);
+
+static bool bdd_inflight_overlaps(struct blk_discard_defer *dd,
+				  sector_t sector, sector_t end)
+{
+	return dd->inflight_len && dd->inflight_start < end &&
+		sector < dd->inflight_start + dd->inflight_len;
+}
+
+void blk_discard_defer_cancel(struct blk_discard_defer *dd, sector_t sector,
+			      sector_t nr_sects)
+{
+	struct blk_discard_extent *ext, *next, *right;
+	sector_t end = sector + nr_sects, eend, overlap;
+
+	mutex_lock(&dd->lock);
+	ext = bdd_prev(dd, sector);
+	if (!ext)
+		ext = bdd_entry(rb_first(&dd->root));
+	else if (ext->start + ext->len <= sector)
+		ext = bdd_entry(rb_next(&ext->node));
+
+	while (ext && ext->start < end) {
+		next = bdd_entry(rb_next(&ext->node));
+		eend = ext->start + ext->len;
+		if (ext->start < sector && eend > end) {
+			overlap = nr_sects;
+			ext->len = sector - ext->start;
+			right = kmalloc(sizeof(*right), GFP_NOFS);
+			if (right) {
+				right->start = end;
+				right->len = eend - end;
+				bdd_link(dd, right);
+			} else {
+				dd->stats.pending -= (eend - end) << 9;
+				dd->stats.dropped += (eend - end) << 9;
+			}
+		} else if (ext->start < sector) {
+			overlap = eend - sector;
+			ext->len = sector - ext->start;
+		} else if (eend > end) {
+			overlap = end - ext->start;
+			ext->start = end;
+			ext->len = eend - end;
+		} else {
+			overlap = ext->len;
+			bdd_erase(dd, ext);
+		}
+		dd->stats.pending -= overlap << 9;
+		dd->stats.cancelled += overlap << 9;
+		ext = next;
+	}
+
+	while (bdd_inflight_overlaps(dd, sector, end)) {
+		mutex_unlock(&dd->lock);
+		wait_event(dd->wait, !bdd_inflight_overlaps(dd, sector, end));
+		mutex_lock(&dd->lock);
+	}
+	mutex_unlock(&dd->lock);
+}
+EXPORT_SYMBOL(blk_discard_defer_cancel);
+
+ssize_t blk_discard_defer_show(struct blk_discard_defer *dd, char *buf)
+{
+	struct blk_discard_stats st;
+	unsigned int extents;
+
+	mutex_lock(&dd->lock);
+	st = dd->stats;
+	extents = dd->nr_extents;
+	mutex_unlock(&dd->lock);
+
+	return snprintf(buf, PAGE_SIZE,
+			"deferred_kb %llu\ndiscarded_kb %llu\n"
+			"cancelled_kb %llu\ndropped_kb %llu\n"
+			"pending_kb %llu\npending_extents %u\n"
+			"bursts %u\npreempted %u\nerrors %u\n",
+			st.deferred >> 10, st.discarded >> 10,
+			st.cancelled >> 10, st.dropped >> 10,
+			st.pending >> 10, extents,
+			st.bursts, st.preempted, st.errors);
+}
+EXPORT_SYMBOL(blk_discard_defer_show);
+
+struct blk_discard_defer *blk_discard_defer_create(struct block_device *bdev)
+{
+	struct blk_discard_defer *dd;
+
+	if (!blk_queue_discard(bdev_get_queue(bdev)))
+		return NULL;
+
+	dd = kzalloc(sizeof(*dd), GFP_KERNEL);
+	if (!dd)
+		return NULL;
+
+	dd->bdev = bdev;
+	dd->root = RB_ROOT;
+	mutex_init(&dd->lock);
+	init_waitqueue_head(&dd->wait);
+	INIT_DELAYED_WORK(&dd->work, blk_discard_work);
+
+	mutex_lock(&blk_discard_list_lock);
+	list_add_tail(&dd->list, &blk_discard_list);
+	mutex_unlock(&blk_discard_list_lock);
+
+	return dd;
+}
+EXPORT_SYMBOL(blk_discard_defer_create);
+
+void blk_discard_defer_destroy(struct blk_discard_defer *dd)
+{
+	if (!dd)
+		return;
+
+	mutex_lock(&blk_discard_list_lock);
+	list_del(&dd->list);
+	mutex_unlock(&blk_discard_list_lock);
+
+	mutex_lock(&dd->lock);
+	dd->disabled = true;
+	mutex_unlock(&dd->lock);
+	cancel_delayed_work_sync(&dd->work);
+
+	bdd_drop_all(dd);
+	kfree(dd);
+}
+EXPORT_SYMBOL(blk_discard_defer_destroy);
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void blk_discard_set_screen_off(bool off)
+{
+	struct blk_discard_defer *dd;
+
+	mutex_lock(&blk_discard_list_lock);
+	blk_discard_screen_off = off;
+	list_for_each_entry(dd, &blk_discard_list, list) {
+		mutex_lock(&dd->lock);
+		bdd_kick(dd);
+		mutex_unlock(&dd->lock);
+	}
+	mutex_unlock(&blk_discard_list_lock);
+}
+
+static void blk_discard_early_suspend(struct early_suspend *h)
+{
+	blk_discard_set_screen_off(true);
+}
+
+static void blk_discard_late_resume(struct early_suspend *h)
+{
+	blk_discard_set_screen_off(false);
+}
+
+static struct early_suspend blk_discard_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1,
+	.suspend = blk_discard_early_suspend,
+	.resume = blk_discard_late_resume,
+};
+
+static int __init blk_discard_init(void)
+{
+	register_early_suspend(&blk_discard_early_suspend_desc);
+	return 0;
+}
+late_initcall(blk_discard_init);
+#endif
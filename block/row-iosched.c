@@ -26,6 +26,7 @@
 #include <linux/compiler.h>
 #include <linux/blktrace_api.h>
 #include <linux/hrtimer.h>
+#include "blk-cgroup.h"
 
 /*
  * enum row_queue_prio - Priorities of the ROW queues
@@ -99,6 +100,46 @@ static const struct row_queue_params row_queues_def[] = {
 #define ROW_IDLE_TIME_MSEC 5
 #define ROW_READ_FREQ_MSEC 20
 
+/*
+ * Requests from tasks in a blkio cgroup whose weight is at or below
+ * this value are treated as background (Android bg_non_interactive).
+ */
+#define ROW_BG_WEIGHT 100
+
+/*
+ * enum row_group - cgroup based request groups
+ *
+ * Foreground requests are mapped to the ROW queues by their I/O
+ * priority class. Background requests of the regular (BE) class are
+ * mapped to the low priority queues instead.
+ */
+enum row_group {
+	ROW_GRP_FG = 0,
+	ROW_GRP_BG,
+	ROW_GRP_MAX,
+};
+
+/**
+ * struct row_grp_stats - per group request statistics
+ * @nr_req:		number of requests added to the scheduler
+ * @nr_dispatched:	number of requests dispatched
+ * @nr_completed:	number of requests completed
+ * @wait_total_ms:	time requests spent in the scheduler
+ * @wait_max_ms:	longest time a request spent in the scheduler
+ * @lat_total_ms:	time from request allocation to completion
+ * @lat_max_ms:		longest time from allocation to completion
+ *
+ */
+struct row_grp_stats {
+	unsigned long		nr_req;
+	unsigned long		nr_dispatched;
+	unsigned long		nr_completed;
+	unsigned long		wait_total_ms;
+	unsigned int		wait_max_ms;
+	unsigned long		lat_total_ms;
+	unsigned int		lat_max_ms;
+};
+
 /**
  * struct rowq_idling_data -  parameters for idling on the queue
  * @last_insert_time:	time the last request was inserted
@@ -187,6 +228,9 @@ struct starvation_data {
  * @reg_prio_starvation: starvation data for REGULAR priority queues
  * @low_prio_starvation: starvation data for LOW priority queues
  * @cycle_flags:	used for marking unserved queueus
+ * @bg_weight:		blkio weight at or below which requests are
+ *			classified as background, 0 disables
+ * @grp_stats:		per group request statistics
  *
  */
 struct row_data {
@@ -206,9 +250,13 @@ struct row_data {
 	struct starvation_data		low_prio_starvation;
 
 	unsigned int			cycle_flags;
+
+	int				bg_weight;
+	struct row_grp_stats		grp_stats[ROW_GRP_MAX];
 };
 
 #define RQ_ROWQ(rq) ((struct row_queue *) ((rq)->elv.priv[0]))
+#define RQ_ROWGRP(rq) ((enum row_group)(unsigned long)((rq)->elv.priv[1]))
 
 #define row_log(q, fmt, args...)   \
 	blk_add_trace_msg(q, "%s():" fmt , __func__, ##args)
@@ -335,6 +383,7 @@ static void row_add_request(struct request_queue *q,
 	list_add_tail(&rq->queuelist, &rqueue->fifo);
 	rd->nr_reqs[rq_data_dir(rq)]++;
 	rqueue->nr_req++;
+	rd->grp_stats[RQ_ROWGRP(rq)].nr_req++;
 	rq_set_fifo_time(rq, jiffies); /* for statistics*/
 
 	if (rq->cmd_flags & REQ_URGENT) {
@@ -450,6 +499,13 @@ static int row_reinsert_req(struct request_queue *q,
 static void row_completed_req(struct request_queue *q, struct request *rq)
 {
 	struct row_data *rd = q->elevator->elevator_data;
+	struct row_grp_stats *gs = &rd->grp_stats[RQ_ROWGRP(rq)];
+	unsigned int lat_ms = jiffies_to_msecs(jiffies - rq->start_time);
+
+	gs->nr_completed++;
+	gs->lat_total_ms += lat_ms;
+	if (lat_ms > gs->lat_max_ms)
+		gs->lat_max_ms = lat_ms;
 
 	 if (rq->cmd_flags & REQ_URGENT) {
 		if (!rd->urgent_in_flight) {
@@ -520,6 +576,13 @@ static void row_remove_request(struct row_data *rd,
 static void row_dispatch_insert(struct row_data *rd, struct request *rq)
 {
 	struct row_queue *rqueue = RQ_ROWQ(rq);
+	struct row_grp_stats *gs = &rd->grp_stats[RQ_ROWGRP(rq)];
+	unsigned int wait_ms = jiffies_to_msecs(jiffies - rq_fifo_time(rq));
+
+	gs->nr_dispatched++;
+	gs->wait_total_ms += wait_ms;
+	if (wait_ms > gs->wait_max_ms)
+		gs->wait_max_ms = wait_ms;
 
 	row_remove_request(rd, rq);
 	elv_dispatch_sort(rd->dispatch_queue, rq);
@@ -820,6 +883,7 @@ static void *row_init_queue(struct request_queue *q)
 	rdata->last_served_ioprio_class = IOPRIO_CLASS_NONE;
 	rdata->rd_idle_data.idling_queue_idx = ROWQ_MAX_PRIO;
 	rdata->dispatch_queue = q;
+	rdata->bg_weight = ROW_BG_WEIGHT;
 
 	return rdata;
 }
@@ -865,6 +929,33 @@ static void row_merged_requests(struct request_queue *q, struct request *rq,
 	rqueue->rdata->nr_reqs[rq_data_dir(rq)]--;
 }
 
+/*
+ * row_get_group() - Get the request group of the current task
+ * @rd:		pointer to struct row_data
+ *
+ * Tasks in a non root blkio cgroup with a weight at or below
+ * rd->bg_weight belong to the background group.
+ *
+ */
+static enum row_group row_get_group(struct row_data *rd)
+{
+	enum row_group grp = ROW_GRP_FG;
+#ifdef CONFIG_BLK_CGROUP
+	struct blkio_cgroup *blkcg;
+
+	if (!rd->bg_weight)
+		return grp;
+
+	rcu_read_lock();
+	blkcg = task_blkio_cgroup(current);
+	if (blkcg && blkcg != &blkio_root_cgroup &&
+	    blkcg->weight <= rd->bg_weight)
+		grp = ROW_GRP_BG;
+	rcu_read_unlock();
+#endif
+	return grp;
+}
+
 /*
  * row_get_queue_prio() - Get queue priority for a given request
  *
@@ -874,7 +965,7 @@ static void row_merged_requests(struct request_queue *q, struct request *rq,
  *
  */
 static enum row_queue_prio row_get_queue_prio(struct request *rq,
-				struct row_data *rd)
+				struct row_data *rd, enum row_group grp)
 {
 	const int data_dir = rq_data_dir(rq);
 	const bool is_sync = rq_is_sync(rq);
@@ -907,7 +998,11 @@ static enum row_queue_prio row_get_queue_prio(struct request *rq,
 	case IOPRIO_CLASS_NONE:
 	case IOPRIO_CLASS_BE:
 	default:
-		if (data_dir == READ)
+		if (grp == ROW_GRP_BG && data_dir == READ)
+			q_type = ROWQ_PRIO_LOW_READ;
+		else if (grp == ROW_GRP_BG && is_sync)
+			q_type = ROWQ_PRIO_LOW_SWRITE;
+		else if (data_dir == READ)
 			q_type = ROWQ_PRIO_REG_READ;
 		else if (is_sync)
 			q_type = ROWQ_PRIO_REG_SWRITE;
@@ -930,11 +1025,13 @@ static int
 row_set_request(struct request_queue *q, struct request *rq, gfp_t gfp_mask)
 {
 	struct row_data *rd = (struct row_data *)q->elevator->elevator_data;
+	enum row_group grp = row_get_group(rd);
 	unsigned long flags;
 
 	spin_lock_irqsave(q->queue_lock, flags);
 	rq->elv.priv[0] =
-		(void *)(&rd->row_queues[row_get_queue_prio(rq, rd)]);
+		(void *)(&rd->row_queues[row_get_queue_prio(rq, rd, grp)]);
+	rq->elv.priv[1] = (void *)(unsigned long)grp;
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
 	return 0;
@@ -981,6 +1078,7 @@ SHOW_FUNCTION(row_reg_starv_limit_show,
 	rowd->reg_prio_starvation.starvation_limit);
 SHOW_FUNCTION(row_low_starv_limit_show,
 	rowd->low_prio_starvation.starvation_limit);
+SHOW_FUNCTION(row_bg_weight_show, rowd->bg_weight);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX)			\
@@ -1027,12 +1125,42 @@ STORE_FUNCTION(row_reg_starv_limit_store,
 STORE_FUNCTION(row_low_starv_limit_store,
 			&rowd->low_prio_starvation.starvation_limit,
 			1, INT_MAX);
+STORE_FUNCTION(row_bg_weight_store, &rowd->bg_weight, 0, 1000);
 
 #undef STORE_FUNCTION
 
+static ssize_t row_grp_stats_show(struct row_grp_stats *gs, char *page)
+{
+	return snprintf(page, PAGE_SIZE,
+		"requests %lu\ndispatched %lu\ncompleted %lu\n"
+		"avg_wait_ms %lu\nmax_wait_ms %u\n"
+		"avg_lat_ms %lu\nmax_lat_ms %u\n",
+		gs->nr_req, gs->nr_dispatched, gs->nr_completed,
+		gs->nr_dispatched ? gs->wait_total_ms / gs->nr_dispatched : 0,
+		gs->wait_max_ms,
+		gs->nr_completed ? gs->lat_total_ms / gs->nr_completed : 0,
+		gs->lat_max_ms);
+}
+
+static ssize_t row_fg_stats_show(struct elevator_queue *e, char *page)
+{
+	struct row_data *rowd = e->elevator_data;
+
+	return row_grp_stats_show(&rowd->grp_stats[ROW_GRP_FG], page);
+}
+
+static ssize_t row_bg_stats_show(struct elevator_queue *e, char *page)
+{
+	struct row_data *rowd = e->elevator_data;
+
+	return row_grp_stats_show(&rowd->grp_stats[ROW_GRP_BG], page);
+}
+
 #define ROW_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, row_##name##_show, \
 				      row_##name##_store)
+#define ROW_ATTR_RO(name) \
+	__ATTR(name, S_IRUGO, row_##name##_show, NULL)
 
 static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(hp_read_quantum),
@@ -1046,6 +1174,9 @@ static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(rd_idle_data_freq),
 	ROW_ATTR(reg_starv_limit),
 	ROW_ATTR(low_starv_limit),
+	ROW_ATTR(bg_weight),
+	ROW_ATTR_RO(fg_stats),
+	ROW_ATTR_RO(bg_stats),
 	__ATTR_NULL
 };
 
@@ -1084,5 +1215,5 @@ static void __exit row_exit(void)
 module_init(row_init);
 module_exit(row_exit);
 
-MODULE_LICENSE("GPLv2");
+MODULE_LICENSE("GPL v2");
 MODULE_DESCRIPTION("Read Over Write IO scheduler");
@@ -0,0 +1,1074 @@
+/*
+ * Test I/O scheduler and scheduler benchmark harness
+ *
+ * The elevator itself is a duplicate of noop.  The module also creates a
+ * request based null block device, "test-iosched", whose service time is
+ * modelled on an eMMC part (one request in flight, per-request and
+ * per-KB cost, seek and cache flush penalties), and a debugfs harness
+ * that switches that device through a list of elevators and drives the
+ * same synthetic or replayed workload against each one.
+ *
+ * debugfs/test-iosched/
+ *   schedulers	elevators to compare, in order
+ *   trace	replay stream, one "<usec> <R|W|WS|F> <sector> <sectors>"
+ *		per line; when empty a synthetic mix is generated
+ *   start	write anything to run the comparison
+ *   results	per elevator and class ops, KB/s and latency percentiles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ */
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/genhd.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/random.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/log2.h>
+
+#define TIO_NAME		"test-iosched"
+#define TIO_DEV_SECTORS		(1024 * 1024 * 2)
+#define TIO_MAX_KB		128
+#define TIO_MAX_PAGES		(TIO_MAX_KB >> (PAGE_SHIFT - 10))
+#define TIO_MAX_WORKERS		32
+#define TIO_MAX_SCHEDS		8
+#define TIO_MAX_TRACE		(64 * 1024)
+#define TIO_SCHED_LIST_LEN	128
+#define TIO_HIST_SHIFT		3
+#define TIO_HIST_BUCKETS	(32 << TIO_HIST_SHIFT)
+
+struct noop_data {
+	struct list_head queue;
+};
+
+static void noop_merged_requests(struct request_queue *q, struct request *rq,
+				 struct request *next)
+{
+	list_del_init(&next->queuelist);
+}
+
+static int noop_dispatch(struct request_queue *q, int force)
+{
+	struct noop_data *nd = q->elevator->elevator_data;
+
+	if (!list_empty(&nd->queue)) {
+		struct request *rq;
+		rq = list_entry(nd->queue.next, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		elv_dispatch_sort(q, rq);
+		return 1;
+	}
+	return 0;
+}
+
+static void noop_add_request(struct request_queue *q, struct request *rq)
+{
+	struct noop_data *nd = q->elevator->elevator_data;
+
+	list_add_tail(&rq->queuelist, &nd->queue);
+}
+
+static struct request *
+noop_former_request(struct request_queue *q, struct request *rq)
+{
+	struct noop_data *nd = q->elevator->elevator_data;
+
+	if (rq->queuelist.prev == &nd->queue)
+		return NULL;
+	return list_entry(rq->queuelist.prev, struct request, queuelist);
+}
+
+static struct request *
+noop_latter_request(struct request_queue *q, struct request *rq)
+{
+	struct noop_data *nd = q->elevator->elevator_data;
+
+	if (rq->queuelist.next == &nd->queue)
+		return NULL;
+	return list_entry(rq->queuelist.next, struct request, queuelist);
+}
+
+static void *noop_init_queue(struct request_queue *q)
+{
+	struct noop_data *nd;
+
+	nd = kmalloc_node(sizeof(*nd), GFP_KERNEL, q->node);
+	if (!nd)
+		return NULL;
+	INIT_LIST_HEAD(&nd->queue);
+	return nd;
+}
+
+static void noop_exit_queue(struct elevator_queue *e)
+{
+	struct noop_data *nd = e->elevator_data;
+
+	BUG_ON(!list_empty(&nd->queue));
+	kfree(nd);
+}
+
+static struct elevator_type elevator_test_iosched = {
+	.ops = {
+		.elevator_merge_req_fn		= noop_merged_requests,
+		.elevator_dispatch_fn		= noop_dispatch,
+		.elevator_add_req_fn		= noop_add_request,
+		.elevator_former_req_fn		= noop_former_request,
+		.elevator_latter_req_fn		= noop_latter_request,
+		.elevator_init_fn		= noop_init_queue,
+		.elevator_exit_fn		= noop_exit_queue,
+	},
+	.elevator_name = TIO_NAME,
+	.elevator_owner = THIS_MODULE,
+};
+
+enum tio_class {
+	TIO_READ,
+	TIO_FSYNC,
+	TIO_BG,
+	TIO_NR_CLASSES,
+};
+
+static const char * const tio_class_name[TIO_NR_CLASSES] = {
+	"read", "fsync", "bg",
+};
+
+enum tio_op {
+	TIO_OP_READ,
+	TIO_OP_WRITE,
+	TIO_OP_WRITE_SYNC,
+	TIO_OP_FLUSH,
+};
+
+struct tio_trace_ent {
+	u32 time_us;
+	u32 nr_sectors;
+	u64 sector;
+	u8 op;
+};
+
+struct tio_class_stats {
+	u64 ops;
+	u64 bytes;
+	u32 max_us;
+	u32 hist[TIO_HIST_BUCKETS];
+};
+
+struct tio_class_result {
+	u64 ops;
+	u64 bytes;
+	u32 p50_us;
+	u32 p90_us;
+	u32 p99_us;
+	u32 max_us;
+};
+
+struct tio_result {
+	char sched[ELV_NAME_MAX];
+	int err;
+	u32 elapsed_ms;
+	u32 errors;
+	struct tio_class_result cls[TIO_NR_CLASSES];
+};
+
+struct tio_batch {
+	atomic_t pending;
+};
+
+struct tio_io {
+	ktime_t start;
+	unsigned int bytes;
+	int class;
+	bool timed;
+	struct tio_batch *batch;
+};
+
+struct tio_cfg {
+	u32 duration_ms;
+	u32 read_threads;
+	u32 read_kb;
+	u32 read_think_us;
+	u32 fsync_threads;
+	u32 fsync_burst;
+	u32 fsync_kb;
+	u32 fsync_interval_ms;
+	u32 bg_threads;
+	u32 bg_depth;
+	u32 bg_kb;
+	u32 dev_read_us;
+	u32 dev_write_us;
+	u32 dev_kb_us;
+	u32 dev_seek_us;
+	u32 dev_flush_us;
+};
+
+static struct {
+	spinlock_t lock;
+	int major;
+	struct gendisk *disk;
+	struct request_queue *queue;
+	struct hrtimer timer;
+	struct request *rq;
+	sector_t next_sector;
+
+	struct mutex run_lock;
+	struct block_device *bdev;
+	struct page *pages[TIO_MAX_PAGES];
+	struct task_struct *workers[TIO_MAX_WORKERS];
+	int nr_workers;
+	atomic_t inflight;
+	atomic_t errors;
+	wait_queue_head_t wait;
+	struct completion replay_done;
+
+	spinlock_t stats_lock;
+	struct tio_class_stats stats[TIO_NR_CLASSES];
+
+	struct tio_cfg cfg;
+	char sched_list[TIO_SCHED_LIST_LEN];
+	struct tio_trace_ent *trace;
+	unsigned int trace_len;
+	char trace_carry[80];
+	unsigned int trace_carry_len;
+
+	struct tio_result results[TIO_MAX_SCHEDS];
+	int nr_results;
+
+	struct dentry *dent;
+} tio = {
+	.cfg = {
+		.duration_ms		= 5000,
+		.read_threads		= 2,
+		.read_kb		= 16,
+		.read_think_us		= 500,
+		.fsync_threads		= 1,
+		.fsync_burst		= 8,
+		.fsync_kb		= 4,
+		.fsync_interval_ms	= 20,
+		.bg_threads		= 1,
+		.bg_depth		= 16,
+		.bg_kb			= 128,
+		.dev_read_us		= 150,
+		.dev_write_us		= 400,
+		.dev_kb_us		= 8,
+		.dev_seek_us		= 100,
+		.dev_flush_us		= 3000,
+	},
+	.sched_list = "row sio fiops bfq cfq deadline noop",
+};
+
+static u64 tio_service_ns(struct request *rq)
+{
+	u32 us;
+
+	if (!blk_rq_bytes(rq))
+		return (u64)tio.cfg.dev_flush_us * NSEC_PER_USEC;
+
+	us = rq_data_dir(rq) == READ ? tio.cfg.dev_read_us :
+		tio.cfg.dev_write_us;
+	us += (blk_rq_bytes(rq) >> 10) * tio.cfg.dev_kb_us;
+	if (blk_rq_pos(rq) != tio.next_sector)
+		us += tio.cfg.dev_seek_us;
+	if (rq->cmd_flags & REQ_FUA)
+		us += tio.cfg.dev_flush_us;
+	tio.next_sector = blk_rq_pos(rq) + blk_rq_sectors(rq);
+
+	return (u64)us * NSEC_PER_USEC;
+}
+
+static void tio_dev_request_fn(struct request_queue *q)
+{
+	struct request *rq;
+	struct bio *bio;
+
+	if (tio.rq)
+		return;
+
+	while ((rq = blk_fetch_request(q)) != NULL) {
+		if (rq->cmd_type != REQ_TYPE_FS) {
+			__blk_end_request_all(rq, -EIO);
+			continue;
+		}
+		if (rq_data_dir(rq) == READ)
+			__rq_for_each_bio(bio, rq)
+				zero_fill_bio(bio);
+
+		tio.rq = rq;
+		hrtimer_start(&tio.timer, ns_to_ktime(tio_service_ns(rq)),
+			      HRTIMER_MODE_REL);
+		break;
+	}
+}
+
+static enum hrtimer_restart tio_dev_timer_fn(struct hrtimer *timer)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&tio.lock, flags);
+	if (tio.rq) {
+		__blk_end_request_all(tio.rq, 0);
+		tio.rq = NULL;
+	}
+	spin_unlock_irqrestore(&tio.lock, flags);
+	blk_run_queue_async(tio.queue);
+
+	return HRTIMER_NORESTART;
+}
+
+static const struct block_device_operations tio_dev_fops = {
+	.owner		= THIS_MODULE,
+};
+
+static int tio_hist_bucket(u32 us)
+{
+	int l;
+
+	if (us < (1 << TIO_HIST_SHIFT))
+		return us;
+	l = ilog2(us);
+	return ((l - TIO_HIST_SHIFT + 1) << TIO_HIST_SHIFT) +
+		((us >> (l - TIO_HIST_SHIFT)) & ((1 << TIO_HIST_SHIFT) - 1));
+}
+
+static u32 tio_hist_upper(int idx)
+{
+	int l, m;
+
+	if (idx < (1 << TIO_HIST_SHIFT))
+		return idx;
+	l = (idx >> TIO_HIST_SHIFT) + TIO_HIST_SHIFT - 1;
+	m = idx & ((1 << TIO_HIST_SHIFT) - 1);
+	return (((1 << TIO_HIST_SHIFT) + m + 1) << (l - TIO_HIST_SHIFT)) - 1;
+}
+
+static void tio_account(int class, unsigned int bytes, s64 lat_us)
+{
+	struct tio_class_stats *st = &tio.stats[class];
+	unsigned long flags;
+
+	spin_lock_irqsave(&tio.stats_lock, flags);
+	st->bytes += bytes;
+	if (lat_us >= 0) {
+		if (lat_us > UINT_MAX)
+			lat_us = UINT_MAX;
+		st->ops++;
+		st->hist[tio_hist_bucket(lat_us)]++;
+		if (lat_us > st->max_us)
+			st->max_us = lat_us;
+	}
+	spin_unlock_irqrestore(&tio.stats_lock, flags);
+}
+
+static u32 tio_percentile(struct tio_class_stats *st, unsigned int pct)
+{
+	u64 want, seen = 0;
+	int i;
+
+	if (!st->ops)
+		return 0;
+	want = div_u64(st->ops * pct + 99, 100);
+	for (i = 0; i < TIO_HIST_BUCKETS; i++) {
+		seen += st->hist[i];
+		if (seen >= want)
+			return min(tio_hist_upper(i), st->max_us);
+	}
+	return st->max_us;
+}
+
+static void tio_end_io(struct bio *bio, int err)
+{
+	struct tio_io *io = bio->bi_private;
+
+	if (err)
+		atomic_inc(&tio.errors);
+	tio_account(io->class, io->bytes, io->timed ?
+		    ktime_us_delta(ktime_get(), io->start) : -1);
+	if (io->batch)
+		atomic_dec(&io->batch->pending);
+	kfree(io);
+	bio_put(bio);
+
+	atomic_dec(&tio.inflight);
+	wake_up(&tio.wait);
+}
+
+static int tio_submit(int rw, sector_t sector, unsigned int sectors,
+		      int class, bool timed, struct tio_batch *batch)
+{
+	unsigned int nr_pages = DIV_ROUND_UP(sectors << 9, PAGE_SIZE);
+	struct tio_io *io;
+	struct bio *bio;
+	unsigned int i;
+
+	io = kmalloc(sizeof(*io), GFP_NOIO);
+	if (!io)
+		return -ENOMEM;
+	bio = bio_alloc(GFP_NOIO, nr_pages);
+	if (!bio) {
+		kfree(io);
+		return -ENOMEM;
+	}
+
+	bio->bi_sector = sector;
+	bio->bi_bdev = tio.bdev;
+	bio->bi_end_io = tio_end_io;
+	bio->bi_private = io;
+	for (i = 0; i < nr_pages; i++) {
+		unsigned int len = min_t(unsigned int, PAGE_SIZE,
+					 (sectors << 9) - i * PAGE_SIZE);
+		if (!bio_add_page(bio, tio.pages[i], len, 0))
+			break;
+	}
+
+	io->bytes = sectors << 9;
+	io->class = class;
+	io->timed = timed;
+	io->batch = batch;
+	if (batch)
+		atomic_inc(&batch->pending);
+	atomic_inc(&tio.inflight);
+	io->start = ktime_get();
+	submit_bio(rw, bio);
+
+	return 0;
+}
+
+static void tio_wait_batch(struct tio_batch *batch, int below)
+{
+	wait_event(tio.wait, atomic_read(&batch->pending) < below ||
+		   (below > 1 && kthread_should_stop()));
+}
+
+static sector_t tio_random_sector(sector_t base, sector_t span,
+				  unsigned int sectors)
+{
+	u32 slots = div_u64(span, sectors);
+
+	if (!slots)
+		return base;
+	return base + (sector_t)(random32() % slots) * sectors;
+}
+
+static unsigned int tio_kb_to_sectors(u32 kb)
+{
+	return clamp_t(u32, kb, 1, TIO_MAX_KB) << 1;
+}
+
+static void tio_park(void)
+{
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+}
+
+static int tio_read_worker(void *unused)
+{
+	unsigned int sectors = tio_kb_to_sectors(tio.cfg.read_kb);
+	struct tio_batch batch = { .pending = ATOMIC_INIT(0) };
+
+	while (!kthread_should_stop()) {
+		if (tio_submit(READ_SYNC, tio_random_sector(0, TIO_DEV_SECTORS,
+				sectors), sectors, TIO_READ, true, &batch))
+			break;
+		tio_wait_batch(&batch, 1);
+		if (tio.cfg.read_think_us)
+			usleep_range(tio.cfg.read_think_us,
+				     tio.cfg.read_think_us + 50);
+	}
+	tio_wait_batch(&batch, 1);
+	tio_park();
+	return 0;
+}
+
+static int tio_fsync_worker(void *data)
+{
+	unsigned int sectors = tio_kb_to_sectors(tio.cfg.fsync_kb);
+	sector_t base = (TIO_DEV_SECTORS / 8) * (1 + (long)data % 3);
+	sector_t pos = 0, span = TIO_DEV_SECTORS / 8;
+	struct tio_batch batch = { .pending = ATOMIC_INIT(0) };
+	ktime_t start;
+	unsigned int i;
+
+	while (!kthread_should_stop()) {
+		start = ktime_get();
+		for (i = 0; i < max_t(u32, tio.cfg.fsync_burst, 1); i++) {
+			if (tio_submit(WRITE_SYNC, base + pos, sectors,
+				       TIO_FSYNC, false, &batch))
+				break;
+			pos = (pos + sectors) % span;
+		}
+		tio_wait_batch(&batch, 1);
+		if (!tio_submit(WRITE_FLUSH, 0, 0, TIO_FSYNC, false, &batch))
+			tio_wait_batch(&batch, 1);
+		tio_account(TIO_FSYNC, 0, ktime_us_delta(ktime_get(), start));
+
+		if (tio.cfg.fsync_interval_ms)
+			msleep_interruptible(tio.cfg.fsync_interval_ms);
+	}
+	tio_park();
+	return 0;
+}
+
+static int tio_bg_worker(void *data)
+{
+	unsigned int sectors = tio_kb_to_sectors(tio.cfg.bg_kb);
+	sector_t span = TIO_DEV_SECTORS / 2 / max_t(u32, tio.cfg.bg_threads, 1);
+	sector_t base = TIO_DEV_SECTORS / 2 + span * (long)data;
+	sector_t pos = 0;
+	struct tio_batch batch = { .pending = ATOMIC_INIT(0) };
+	int depth = max_t(u32, tio.cfg.bg_depth, 1);
+
+	while (!kthread_should_stop()) {
+		tio_wait_batch(&batch, depth);
+		if (kthread_should_stop())
+			break;
+		if (tio_submit(WRITE, base + pos, sectors, TIO_BG, true,
+			       &batch))
+			break;
+		pos += sectors;
+		if (pos + sectors > span)
+			pos = 0;
+	}
+	tio_wait_batch(&batch, 1);
+	tio_park();
+	return 0;
+}
+
+static int tio_replay_worker(void *unused)
+{
+	static const int op_rw[] = {
+		[TIO_OP_READ]		= READ_SYNC,
+		[TIO_OP_WRITE]		= WRITE,
+		[TIO_OP_WRITE_SYNC]	= WRITE_SYNC,
+		[TIO_OP_FLUSH]		= WRITE_FLUSH,
+	};
+	static const int op_class[] = {
+		[TIO_OP_READ]		= TIO_READ,
+		[TIO_OP_WRITE]		= TIO_BG,
+		[TIO_OP_WRITE_SYNC]	= TIO_FSYNC,
+		[TIO_OP_FLUSH]		= TIO_FSYNC,
+	};
+	struct tio_trace_ent *ent;
+	ktime_t start = ktime_get();
+	unsigned int i, sectors;
+	u64 sector;
+	s64 delta;
+
+	for (i = 0; i < tio.trace_len && !kthread_should_stop(); i++) {
+		ent = &tio.trace[i];
+		delta = ent->time_us - ktime_us_delta(ktime_get(), start);
+		if (delta > 0)
+			usleep_range(delta, delta + 50);
+
+		sector = 0;
+		sectors = 0;
+		if (ent->op != TIO_OP_FLUSH) {
+			sectors = clamp_t(u32, ent->nr_sectors, 1,
+					  TIO_MAX_KB << 1);
+			sector = ent->sector;
+			sector = do_div(sector, TIO_DEV_SECTORS - sectors);
+		}
+		if (tio_submit(op_rw[ent->op], sector, sectors,
+			       op_class[ent->op], true, NULL))
+			break;
+	}
+	complete(&tio.replay_done);
+	tio_park();
+	return 0;
+}
+
+static void tio_start_worker(int (*fn)(void *), long idx, const char *what)
+{
+	struct task_struct *task;
+
+	if (tio.nr_workers >= TIO_MAX_WORKERS)
+		return;
+	task = kthread_run(fn, (void *)idx, "tio_%s/%ld", what, idx);
+	if (IS_ERR(task)) {
+		pr_err("%s: %s worker failed %ld\n", TIO_NAME, what,
+		       PTR_ERR(task));
+		return;
+	}
+	tio.workers[tio.nr_workers++] = task;
+}
+
+static void tio_start_workers(void)
+{
+	long i;
+
+	tio.nr_workers = 0;
+	if (tio.trace_len) {
+		init_completion(&tio.replay_done);
+		tio_start_worker(tio_replay_worker, 0, "replay");
+		return;
+	}
+	for (i = 0; i < tio.cfg.read_threads; i++)
+		tio_start_worker(tio_read_worker, i, "read");
+	for (i = 0; i < tio.cfg.fsync_threads; i++)
+		tio_start_worker(tio_fsync_worker, i, "fsync");
+	for (i = 0; i < tio.cfg.bg_threads; i++)
+		tio_start_worker(tio_bg_worker, i, "bg");
+}
+
+static void tio_stop_workers(void)
+{
+	int i;
+
+	for (i = 0; i < tio.nr_workers; i++)
+		kthread_stop(tio.workers[i]);
+	tio.nr_workers = 0;
+	wait_event(tio.wait, !atomic_read(&tio.inflight));
+}
+
+static void tio_run_one(const char *name, struct tio_result *res)
+{
+	struct tio_class_stats *st;
+	ktime_t start;
+	int i;
+
+	memset(res, 0, sizeof(*res));
+	strlcpy(res->sched, name, sizeof(res->sched));
+
+	res->err = elevator_change(tio.queue, name);
+	if (res->err)
+		return;
+
+	spin_lock_irq(&tio.stats_lock);
+	memset(tio.stats, 0, sizeof(tio.stats));
+	spin_unlock_irq(&tio.stats_lock);
+	atomic_set(&tio.errors, 0);
+
+	start = ktime_get();
+	tio_start_workers();
+	if (tio.trace_len)
+		wait_for_completion_interruptible(&tio.replay_done);
+	else
+		msleep_interruptible(tio.cfg.duration_ms);
+	tio_stop_workers();
+	res->elapsed_ms = ktime_to_ms(ktime_sub(ktime_get(), start));
+	res->errors = atomic_read(&tio.errors);
+
+	for (i = 0; i < TIO_NR_CLASSES; i++) {
+		st = &tio.stats[i];
+		res->cls[i].ops = st->ops;
+		res->cls[i].bytes = st->bytes;
+		res->cls[i].p50_us = tio_percentile(st, 50);
+		res->cls[i].p90_us = tio_percentile(st, 90);
+		res->cls[i].p99_us = tio_percentile(st, 99);
+		res->cls[i].max_us = st->max_us;
+	}
+}
+
+static int tio_run(void)
+{
+	char list[TIO_SCHED_LIST_LEN], *p, *name;
+	int ret = 0;
+
+	tio.bdev = blkdev_get_by_dev(disk_devt(tio.disk),
+				     FMODE_READ | FMODE_WRITE, NULL);
+	if (IS_ERR(tio.bdev)) {
+		ret = PTR_ERR(tio.bdev);
+		tio.bdev = NULL;
+		return ret;
+	}
+
+	strlcpy(list, tio.sched_list, sizeof(list));
+	p = list;
+	tio.nr_results = 0;
+	while ((name = strsep(&p, " \t\n,")) != NULL) {
+		if (!*name)
+			continue;
+		if (tio.nr_results >= TIO_MAX_SCHEDS)
+			break;
+		tio_run_one(name, &tio.results[tio.nr_results++]);
+		if (signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+	}
+
+	blkdev_put(tio.bdev, FMODE_READ | FMODE_WRITE);
+	tio.bdev = NULL;
+	return ret;
+}
+
+static ssize_t tio_start_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	int ret;
+
+	if (mutex_lock_interruptible(&tio.run_lock))
+		return -EINTR;
+	ret = tio_run();
+	mutex_unlock(&tio.run_lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations tio_start_fops = {
+	.write	= tio_start_write,
+};
+
+static int tio_results_show(struct seq_file *s, void *unused)
+{
+	struct tio_class_result *cr;
+	struct tio_result *res;
+	int i, c;
+
+	mutex_lock(&tio.run_lock);
+	seq_printf(s, "%-12s %-6s %10s %8s %8s %8s %8s %8s\n", "sched",
+		   "class", "ops", "KB/s", "p50_us", "p90_us", "p99_us",
+		   "max_us");
+	for (i = 0; i < tio.nr_results; i++) {
+		res = &tio.results[i];
+		if (res->err) {
+			seq_printf(s, "%-12s unavailable (%d)\n", res->sched,
+				   res->err);
+			continue;
+		}
+		for (c = 0; c < TIO_NR_CLASSES; c++) {
+			cr = &res->cls[c];
+			if (!cr->ops && !cr->bytes)
+				continue;
+			seq_printf(s, "%-12s %-6s %10llu %8llu %8u %8u %8u "
+				   "%8u\n", res->sched, tio_class_name[c],
+				   cr->ops, res->elapsed_ms ?
+				   div_u64(cr->bytes * 1000 >> 10,
+					   res->elapsed_ms) : 0,
+				   cr->p50_us, cr->p90_us, cr->p99_us,
+				   cr->max_us);
+		}
+		if (res->errors)
+			seq_printf(s, "%-12s errors %u\n", res->sched,
+				   res->errors);
+	}
+	mutex_unlock(&tio.run_lock);
+
+	return 0;
+}
+
+static int tio_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tio_results_show, NULL);
+}
+
+static const struct file_operations tio_results_fops = {
+	.open		= tio_results_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t tio_sched_read(struct file *file, char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	char tmp[TIO_SCHED_LIST_LEN + 1];
+	int len;
+
+	len = scnprintf(tmp, sizeof(tmp), "%s\n", tio.sched_list);
+	return simple_read_from_buffer(buf, count, ppos, tmp, len);
+}
+
+static ssize_t tio_sched_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	char tmp[TIO_SCHED_LIST_LEN];
+
+	if (count >= sizeof(tmp))
+		return -EINVAL;
+	if (copy_from_user(tmp, buf, count))
+		return -EFAULT;
+	tmp[count] = '\0';
+
+	mutex_lock(&tio.run_lock);
+	strlcpy(tio.sched_list, strstrip(tmp), sizeof(tio.sched_list));
+	mutex_unlock(&tio.run_lock);
+
+	return count;
+}
+
+static const struct file_operations tio_sched_fops = {
+	.read	= tio_sched_read,
+	.write	= tio_sched_write,
+};
+
+static int tio_trace_parse(char *line)
+{
+	struct tio_trace_ent *ent;
+	unsigned long long sector = 0;
+	unsigned int usec, sectors = 0;
+	char op[4];
+
+	line = strstrip(line);
+	if (!*line || *line == '#')
+		return 0;
+	if (sscanf(line, "%u %3s %llu %u", &usec, op, &sector, &sectors) < 2)
+		return -EINVAL;
+	if (tio.trace_len >= TIO_MAX_TRACE)
+		return -ENOSPC;
+
+	ent = &tio.trace[tio.trace_len];
+	if (!strcmp(op, "R"))
+		ent->op = TIO_OP_READ;
+	else if (!strcmp(op, "W"))
+		ent->op = TIO_OP_WRITE;
+	else if (!strcmp(op, "WS"))
+		ent->op = TIO_OP_WRITE_SYNC;
+	else if (!strcmp(op, "F"))
+		ent->op = TIO_OP_FLUSH;
+	else
+		return -EINVAL;
+	ent->time_us = usec;
+	ent->sector = sector;
+	ent->nr_sectors = sectors;
+	tio.trace_len++;
+
+	return 0;
+}
+
+static int tio_trace_open(struct inode *inode, struct file *file)
+{
+	if (!(file->f_mode & FMODE_WRITE))
+		return -EINVAL;
+
+	mutex_lock(&tio.run_lock);
+	if (file->f_flags & O_TRUNC)
+		tio.trace_len = 0;
+	tio.trace_carry_len = 0;
+	mutex_unlock(&tio.run_lock);
+
+	return nonseekable_open(inode, file);
+}
+
+static ssize_t tio_trace_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	char *kbuf, *line, *p;
+	size_t len;
+	int ret = 0;
+
+	if (count > PAGE_SIZE)
+		count = PAGE_SIZE;
+	kbuf = kmalloc(count + sizeof(tio.trace_carry) + 1, GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
+
+	mutex_lock(&tio.run_lock);
+	if (!tio.trace) {
+		tio.trace = vmalloc(TIO_MAX_TRACE * sizeof(*tio.trace));
+		if (!tio.trace) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	memcpy(kbuf, tio.trace_carry, tio.trace_carry_len);
+	if (copy_from_user(kbuf + tio.trace_carry_len, buf, count)) {
+		ret = -EFAULT;
+		goto out;
+	}
+	len = tio.trace_carry_len + count;
+	kbuf[len] = '\0';
+	tio.trace_carry_len = 0;
+
+	p = kbuf;
+	while ((line = strsep(&p, "\n")) != NULL) {
+		if (!p) {
+			if (strlen(line) >= sizeof(tio.trace_carry)) {
+				ret = -EINVAL;
+				break;
+			}
+			tio.trace_carry_len = strlen(line);
+			memcpy(tio.trace_carry, line, tio.trace_carry_len);
+			break;
+		}
+		ret = tio_trace_parse(line);
+		if (ret)
+			break;
+	}
+out:
+	mutex_unlock(&tio.run_lock);
+	kfree(kbuf);
+
+	return ret ? ret : count;
+}
+
+static int tio_trace_release(struct inode *inode, struct file *file)
+{
+	int ret = 0;
+
+	mutex_lock(&tio.run_lock);
+	if (tio.trace_carry_len) {
+		tio.trace_carry[tio.trace_carry_len] = '\0';
+		ret = tio_trace_parse(tio.trace_carry);
+		tio.trace_carry_len = 0;
+	}
+	mutex_unlock(&tio.run_lock);
+
+	return ret;
+}
+
+static const struct file_operations tio_trace_fops = {
+	.open		= tio_trace_open,
+	.write		= tio_trace_write,
+	.release	= tio_trace_release,
+	.llseek		= no_llseek,
+};
+
+static int tio_create_debugfs(void)
+{
+	static const struct {
+		const char *name;
+		u32 *val;
+	} knobs[] = {
+		{ "duration_ms",	&tio.cfg.duration_ms },
+		{ "read_threads",	&tio.cfg.read_threads },
+		{ "read_kb",		&tio.cfg.read_kb },
+		{ "read_think_us",	&tio.cfg.read_think_us },
+		{ "fsync_threads",	&tio.cfg.fsync_threads },
+		{ "fsync_burst",	&tio.cfg.fsync_burst },
+		{ "fsync_kb",		&tio.cfg.fsync_kb },
+		{ "fsync_interval_ms",	&tio.cfg.fsync_interval_ms },
+		{ "bg_threads",		&tio.cfg.bg_threads },
+		{ "bg_depth",		&tio.cfg.bg_depth },
+		{ "bg_kb",		&tio.cfg.bg_kb },
+		{ "dev_read_us",	&tio.cfg.dev_read_us },
+		{ "dev_write_us",	&tio.cfg.dev_write_us },
+		{ "dev_kb_us",		&tio.cfg.dev_kb_us },
+		{ "dev_seek_us",	&tio.cfg.dev_seek_us },
+		{ "dev_flush_us",	&tio.cfg.dev_flush_us },
+	};
+	int i;
+
+	tio.dent = debugfs_create_dir(TIO_NAME, NULL);
+	if (IS_ERR_OR_NULL(tio.dent))
+		return -ENODEV;
+
+	for (i = 0; i < ARRAY_SIZE(knobs); i++)
+		debugfs_create_u32(knobs[i].name, 0644, tio.dent,
+				   knobs[i].val);
+	debugfs_create_file("schedulers", 0644, tio.dent, NULL,
+			    &tio_sched_fops);
+	debugfs_create_file("trace", 0200, tio.dent, NULL, &tio_trace_fops);
+	debugfs_create_file("start", 0200, tio.dent, NULL, &tio_start_fops);
+	debugfs_create_file("results", 0444, tio.dent, NULL,
+			    &tio_results_fops);
+
+	return 0;
+}
+
+static int tio_create_dev(void)
+{
+	int i;
+
+	for (i = 0; i < TIO_MAX_PAGES; i++) {
+		tio.pages[i] = alloc_page(GFP_KERNEL | __GFP_ZERO);
+		if (!tio.pages[i])
+			return -ENOMEM;
+	}
+
+	hrtimer_init(&tio.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	tio.timer.function = tio_dev_timer_fn;
+
+	tio.major = register_blkdev(0, TIO_NAME);
+	if (tio.major < 0)
+		return tio.major;
+
+	tio.queue = blk_init_queue(tio_dev_request_fn, &tio.lock);
+	if (!tio.queue)
+		return -ENOMEM;
+	blk_queue_logical_block_size(tio.queue, 512);
+	blk_queue_max_hw_sectors(tio.queue, TIO_MAX_KB << 1);
+	blk_queue_flush(tio.queue, REQ_FLUSH | REQ_FUA);
+
+	tio.disk = alloc_disk(1);
+	if (!tio.disk)
+		return -ENOMEM;
+	tio.disk->major = tio.major;
+	tio.disk->first_minor = 0;
+	tio.disk->fops = &tio_dev_fops;
+	tio.disk->queue = tio.queue;
+	tio.disk->flags |= GENHD_FL_NO_PART_SCAN;
+	strlcpy(tio.disk->disk_name, TIO_NAME, sizeof(tio.disk->disk_name));
+	set_capacity(tio.disk, TIO_DEV_SECTORS);
+	add_disk(tio.disk);
+
+	return 0;
+}
+
+static void tio_destroy_dev(void)
+{
+	int i;
+
+	if (tio.disk) {
+		if (tio.disk->flags & GENHD_FL_UP)
+			del_gendisk(tio.disk);
+		put_disk(tio.disk);
+	}
+	if (tio.queue)
+		blk_cleanup_queue(tio.queue);
+	hrtimer_cancel(&tio.timer);
+	if (tio.major > 0)
+		unregister_blkdev(tio.major, TIO_NAME);
+	for (i = 0; i < TIO_MAX_PAGES; i++)
+		if (tio.pages[i])
+			__free_page(tio.pages[i]);
+}
+
+static int __init test_iosched_init(void)
+{
+	int ret;
+
+	spin_lock_init(&tio.lock);
+	spin_lock_init(&tio.stats_lock);
+	mutex_init(&tio.run_lock);
+	init_waitqueue_head(&tio.wait);
+
+	ret = elv_register(&elevator_test_iosched);
+	if (ret)
+		return ret;
+
+	ret = tio_create_dev();
+	if (ret) {
+		pr_err("%s: null device setup failed %d\n", TIO_NAME, ret);
+		goto fail;
+	}
+
+	ret = tio_create_debugfs();
+	if (ret) {
+		pr_err("%s: debugfs setup failed %d\n", TIO_NAME, ret);
+		goto fail;
+	}
+
+	return 0;
+fail:
+	tio_destroy_dev();
+	elv_unregister(&elevator_test_iosched);
+	return ret;
+}
+
+static void __exit test_iosched_exit(void)
+{
+	debugfs_remove_recursive(tio.dent);
+	tio_destroy_dev();
+	vfree(tio.trace);
+	elv_unregister(&elevator_test_iosched);
+}
+
+module_init(test_iosched_init);
+module_exit(test_iosched_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Test IO scheduler and scheduler benchmark harness");
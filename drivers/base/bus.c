@@ -597,7 +597,7 @@ int bus_add_driver(struct device_driver *drv)
 		goto out_unregister;
 
 	if (drv->bus->p->drivers_autoprobe) {
-		error = driver_attach(drv);
+		error = driver_attach_maybe_async(drv);
 		if (error)
 			goto out_unregister;
 	}
@@ -24,6 +24,7 @@
 #include <linux/wait.h>
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
+#include <linux/boot_timeline.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -171,6 +172,9 @@ static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
+	int probe_ret;
+
+	ktime_t start = boot_timeline_begin();
 
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
@@ -178,7 +182,8 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	WARN_ON(!list_empty(&dev->devres_head));
 
 	dev->driver = drv;
-	if (driver_sysfs_add(dev)) {
+	ret = driver_sysfs_add(dev);
+	if (ret) {
 		printk(KERN_ERR "%s: driver_sysfs_add(%s) failed\n",
 			__func__, dev_name(dev));
 		goto probe_failed;
@@ -198,9 +203,11 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	ret = 1;
 	pr_debug("bus: '%s': %s: bound device %s to driver %s\n",
 		 drv->bus->name, __func__, dev_name(dev), drv->name);
+	probe_ret = 0;
 	goto done;
 
 probe_failed:
+	probe_ret = ret;
 	devres_release_all(dev);
 	driver_sysfs_remove(dev);
 	dev->driver = NULL;
@@ -220,6 +227,8 @@ probe_failed:
 	}
 	ret = 0;
 done:
+	boot_timeline_add(BOOT_TL_PROBE, start, probe_ret, "%s:%s", drv->name,
+			  dev_name(dev));
 	atomic_dec(&probe_count);
 	wake_up(&probe_waitqueue);
 	return ret;
@@ -324,6 +333,97 @@ int driver_attach(struct device_driver *drv)
 }
 EXPORT_SYMBOL_GPL(driver_attach);
 
+DEFINE_DEVICE_ASYNC_DOMAIN(device_async_storage, "storage");
+DEFINE_DEVICE_ASYNC_DOMAIN(device_async_display, "display");
+DEFINE_DEVICE_ASYNC_DOMAIN(device_async_audio, "audio");
+DEFINE_DEVICE_ASYNC_DOMAIN(device_async_sensors, "sensors");
+EXPORT_SYMBOL_GPL(device_async_storage);
+EXPORT_SYMBOL_GPL(device_async_display);
+EXPORT_SYMBOL_GPL(device_async_audio);
+EXPORT_SYMBOL_GPL(device_async_sensors);
+
+static struct device_async_domain *device_async_domains[] = {
+	&device_async_storage,
+	&device_async_display,
+	&device_async_audio,
+	&device_async_sensors,
+};
+
+static bool driver_async_probe = true;
+core_param(driver_async_probe, driver_async_probe, bool, 0644);
+
+int device_async_depend(struct device_async_domain *domain,
+			struct device_async_domain *dep)
+{
+	int i;
+
+	if (domain == dep)
+		return -EINVAL;
+
+	for (i = 0; i < DEVICE_ASYNC_MAX_DEPS; i++) {
+		if (domain->depends[i] == dep)
+			return 0;
+		if (!domain->depends[i]) {
+			domain->depends[i] = dep;
+			return 0;
+		}
+	}
+	return -ENOSPC;
+}
+EXPORT_SYMBOL_GPL(device_async_depend);
+
+void device_async_synchronize(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(device_async_domains); i++)
+		async_synchronize_full_domain(&device_async_domains[i]->domain);
+}
+EXPORT_SYMBOL_GPL(device_async_synchronize);
+
+static void driver_attach_async(void *data, async_cookie_t cookie)
+{
+	struct device_driver *drv = data;
+	struct device_async_domain *d = drv->async_domain;
+	int i, ret;
+
+	/*
+	 * async entries start in any order, so wait for our turn in the
+	 * domain explicitly rather than by cookie
+	 */
+	wait_event(d->wait, d->done == drv->p->async_seq);
+	for (i = 0; i < DEVICE_ASYNC_MAX_DEPS && d->depends[i]; i++)
+		async_synchronize_full_domain(&d->depends[i]->domain);
+
+	ret = driver_attach(drv);
+	if (ret)
+		pr_err("%s: async attach of %s failed: %d\n", __func__,
+		       drv->name, ret);
+
+	spin_lock_irq(&d->wait.lock);
+	d->done++;
+	spin_unlock_irq(&d->wait.lock);
+	wake_up_all(&d->wait);
+}
+
+int driver_attach_maybe_async(struct device_driver *drv)
+{
+	struct device_async_domain *d = drv->async_domain;
+
+	if (!d || !driver_async_probe || system_state != SYSTEM_BOOTING)
+		return driver_attach(drv);
+
+	spin_lock_irq(&d->wait.lock);
+	drv->p->async_seq = d->queued++;
+	spin_unlock_irq(&d->wait.lock);
+
+	pr_debug("bus: '%s': %s: async probe of %s in domain %s\n",
+		 drv->bus->name, __func__, drv->name, drv->async_domain->name);
+	async_schedule_domain(driver_attach_async, drv,
+			      &drv->async_domain->domain);
+	return 0;
+}
+
 static void __device_release_driver(struct device *dev)
 {
 	struct device_driver *drv;
@@ -15,6 +15,7 @@
 #include <linux/errno.h>
 #include <linux/slab.h>
 #include <linux/string.h>
+#include <linux/async.h>
 #include "base.h"
 
 static struct device *next_device(struct klist_iter *i)
@@ -155,6 +156,8 @@ void driver_unregister(struct device_driver *drv)
 		WARN(1, "Unexpected driver unregister!\n");
 		return;
 	}
+	if (drv->async_domain)
+		async_synchronize_full_domain(&drv->async_domain->domain);
 	driver_remove_groups(drv, drv->groups);
 	bus_remove_driver(drv);
 }
@@ -21,6 +21,7 @@
 #include <linux/firmware.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/io.h>
 
 #define to_dev(obj) container_of(obj, struct device, kobj)
 
@@ -98,6 +99,12 @@ struct firmware_priv {
 	struct timer_list timeout;
 	struct device dev;
 	bool nowait;
+	bool direct;
+	phys_addr_t dest_addr;
+	size_t dest_size;
+	void __iomem *dest_buf;
+	size_t dest_buf_off;
+	size_t dest_buf_size;
 	char fw_id[];
 };
 
@@ -113,6 +120,38 @@ static void fw_load_abort(struct firmware_priv *fw_priv)
 	complete(&fw_priv->completion);
 }
 
+#define FW_DIRECT_MAP_SIZE	(4 << 20)
+
+static void fw_direct_unmap(struct firmware_priv *fw_priv)
+{
+	if (fw_priv->dest_buf) {
+		iounmap(fw_priv->dest_buf);
+		fw_priv->dest_buf = NULL;
+	}
+}
+
+static void __iomem *fw_direct_map(struct firmware_priv *fw_priv,
+				   size_t offset, size_t count)
+{
+	size_t size;
+
+	if (fw_priv->dest_buf && offset >= fw_priv->dest_buf_off &&
+	    offset + count <= fw_priv->dest_buf_off + fw_priv->dest_buf_size)
+		return fw_priv->dest_buf + (offset - fw_priv->dest_buf_off);
+
+	fw_direct_unmap(fw_priv);
+
+	size = max_t(size_t, FW_DIRECT_MAP_SIZE, count);
+	size = min_t(size_t, size, fw_priv->dest_size - offset);
+	fw_priv->dest_buf = ioremap(fw_priv->dest_addr + offset, size);
+	if (!fw_priv->dest_buf)
+		return NULL;
+	fw_priv->dest_buf_off = offset;
+	fw_priv->dest_buf_size = size;
+
+	return fw_priv->dest_buf;
+}
+
 static ssize_t firmware_timeout_show(struct class *class,
 				     struct class_attribute *attr,
 				     char *buf)
@@ -222,6 +261,7 @@ static ssize_t firmware_loading_store(struct device *dev,
 
 	switch (loading) {
 	case 1:
+		fw_direct_unmap(fw_priv);
 		firmware_free_data(fw_priv->fw);
 		memset(fw_priv->fw, 0, sizeof(struct firmware));
 		
@@ -234,6 +274,13 @@ static ssize_t firmware_loading_store(struct device *dev,
 		set_bit(FW_STATUS_LOADING, &fw_priv->status);
 		break;
 	case 0:
+		if (test_bit(FW_STATUS_LOADING, &fw_priv->status) &&
+		    fw_priv->direct) {
+			fw_direct_unmap(fw_priv);
+			complete(&fw_priv->completion);
+			clear_bit(FW_STATUS_LOADING, &fw_priv->status);
+			break;
+		}
 		if (test_bit(FW_STATUS_LOADING, &fw_priv->status)) {
 			vunmap(fw_priv->fw->data);
 			fw_priv->fw->data = vmap(fw_priv->pages,
@@ -280,7 +327,8 @@ static ssize_t firmware_data_read(struct file *filp, struct kobject *kobj,
 
 	mutex_lock(&fw_lock);
 	fw = fw_priv->fw;
-	if (!fw || test_bit(FW_STATUS_DONE, &fw_priv->status)) {
+	if (!fw || fw_priv->direct ||
+	    test_bit(FW_STATUS_DONE, &fw_priv->status)) {
 		ret_count = -ENODEV;
 		goto out;
 	}
@@ -351,6 +399,28 @@ static int fw_realloc_buffer(struct firmware_priv *fw_priv, int min_size)
 	return 0;
 }
 
+static ssize_t firmware_direct_write(struct firmware_priv *fw_priv,
+				     char *buffer, loff_t offset, size_t count)
+{
+	void __iomem *dest;
+
+	if (offset + count > fw_priv->dest_size) {
+		fw_load_abort(fw_priv);
+		return -EFBIG;
+	}
+
+	dest = fw_direct_map(fw_priv, offset, count);
+	if (!dest) {
+		fw_load_abort(fw_priv);
+		return -ENOMEM;
+	}
+
+	memcpy((void __force *)dest, buffer, count);
+	fw_priv->fw->size = max_t(size_t, offset + count, fw_priv->fw->size);
+
+	return count;
+}
+
 /**
  * firmware_data_write - write method for firmware
  * @filp: open sysfs file
@@ -381,6 +451,10 @@ static ssize_t firmware_data_write(struct file *filp, struct kobject *kobj,
 		retval = -ENODEV;
 		goto out;
 	}
+	if (fw_priv->direct) {
+		retval = firmware_direct_write(fw_priv, buffer, offset, count);
+		goto out;
+	}
 	retval = fw_realloc_buffer(fw_priv, offset + count);
 	if (retval)
 		goto out;
@@ -536,6 +610,7 @@ static int _request_firmware_load(struct firmware_priv *fw_priv, bool uevent,
 	mutex_lock(&fw_lock);
 	if (!fw_priv->fw->size || test_bit(FW_STATUS_ABORT, &fw_priv->status))
 		retval = -ENOENT;
+	fw_direct_unmap(fw_priv);
 	fw_priv->fw = NULL;
 	mutex_unlock(&fw_lock);
 
@@ -575,6 +650,66 @@ request_firmware(const struct firmware **firmware_p, const char *name,
 	return ret;
 }
 
+/**
+ * request_firmware_direct: - load firmware straight into device memory
+ * @name: name of firmware file
+ * @device: device for which firmware is being loaded
+ * @dest_addr: physical address the image is copied to
+ * @dest_size: size of the region at @dest_addr
+ *
+ *	Like request_firmware(), but the data written by the loader is
+ *	copied directly into the ioremapped destination instead of being
+ *	staged in an intermediate page buffer.  Returns the number of
+ *	bytes loaded or a negative errno; images larger than @dest_size
+ *	are rejected.
+ **/
+int request_firmware_direct(const char *name, struct device *device,
+			    phys_addr_t dest_addr, size_t dest_size)
+{
+	const struct firmware *fw;
+	struct firmware_priv *fw_priv;
+	void __iomem *buf;
+	int ret;
+
+	fw_priv = _request_firmware_prepare(&fw, name, device, true, false);
+	if (IS_ERR(fw_priv))
+		return PTR_ERR(fw_priv);
+
+	if (!fw_priv) {
+		if (fw->size > dest_size) {
+			ret = -EFBIG;
+			goto out;
+		}
+		buf = ioremap(dest_addr, fw->size);
+		if (!buf) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		memcpy((void __force *)buf, fw->data, fw->size);
+		iounmap(buf);
+		ret = fw->size;
+		goto out;
+	}
+
+	fw_priv->direct = true;
+	fw_priv->dest_addr = dest_addr;
+	fw_priv->dest_size = dest_size;
+
+	ret = usermodehelper_read_trylock();
+	if (WARN_ON(ret)) {
+		dev_err(device, "firmware: %s will not be loaded\n", name);
+	} else {
+		ret = _request_firmware_load(fw_priv, true,
+					firmware_loading_timeout());
+		usermodehelper_read_unlock();
+	}
+	if (!ret)
+		ret = fw->size;
+out:
+	release_firmware(fw);
+	return ret;
+}
+
 void release_firmware(const struct firmware *fw)
 {
 	if (fw) {
@@ -673,4 +808,5 @@ module_exit(firmware_class_exit);
 
 EXPORT_SYMBOL(release_firmware);
 EXPORT_SYMBOL(request_firmware);
+EXPORT_SYMBOL(request_firmware_direct);
 EXPORT_SYMBOL(request_firmware_nowait);
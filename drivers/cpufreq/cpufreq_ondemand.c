@@ -23,6 +23,7 @@
 #include <linux/ktime.h>
 #include <linux/sched.h>
 #include <linux/input.h>
+#include <linux/input/touch_boost.h>
 #include <linux/workqueue.h>
 #include <linux/kthread.h>
 #include <linux/slab.h>
@@ -1193,8 +1194,7 @@ static int should_io_be_busy(void)
 }
 
 
-static void dbs_input_event(struct input_handle *handle, unsigned int type,
-		unsigned int code, int value)
+static void dbs_input_boost(void)
 {
 	int i;
 	struct cpu_dbs_info_s *dbs_info;
@@ -1207,30 +1207,46 @@ static void dbs_input_event(struct input_handle *handle, unsigned int type,
 		return;
 	}
 
-	if (type == EV_SYN && code == SYN_REPORT) {
+	
+	spin_lock_irqsave(&input_boost_lock, flags);
+	input_event_boost = true;
+	ui_sampling_expired = jiffies + msecs_to_jiffies(dbs_tuners_ins.ui_timeout);
+	spin_unlock_irqrestore(&input_boost_lock, flags);
 
+	input_event_min_freq = input_event_min_freq_array[num_online_cpus() - 1];
+	for_each_online_cpu(i) {
 		
-		spin_lock_irqsave(&input_boost_lock, flags);
-		input_event_boost = true;
-		ui_sampling_expired = jiffies + msecs_to_jiffies(dbs_tuners_ins.ui_timeout);
-		spin_unlock_irqrestore(&input_boost_lock, flags);
-
-		input_event_min_freq = input_event_min_freq_array[num_online_cpus() - 1];
-		for_each_online_cpu(i) {
-			
-			if (likely(per_cpu(cpufreq_init_done, i))) {
-				dbs_info = &per_cpu(od_cpu_dbs_info, i);
-				if (dbs_info->cur_policy &&		
-					dbs_info->cur_policy->cur < input_event_min_freq) {
-					wake_up_process(per_cpu(up_task, i));
-				}
-			} else {
-				pr_info("dbs_input_event: cpu%d not init done...\n", i);
+		if (likely(per_cpu(cpufreq_init_done, i))) {
+			dbs_info = &per_cpu(od_cpu_dbs_info, i);
+			if (dbs_info->cur_policy &&		
+				dbs_info->cur_policy->cur < input_event_min_freq) {
+				wake_up_process(per_cpu(up_task, i));
 			}
+		} else {
+			pr_info("dbs_input_event: cpu%d not init done...\n", i);
 		}
 	}
 }
 
+static void dbs_input_event(struct input_handle *handle, unsigned int type,
+		unsigned int code, int value)
+{
+	if (type == EV_SYN && code == SYN_REPORT)
+		dbs_input_boost();
+}
+
+static int dbs_touch_boost_notify(struct notifier_block *nb,
+		unsigned long event, void *data)
+{
+	if (event == TOUCH_BOOST_FINGER_DOWN)
+		dbs_input_boost();
+	return NOTIFY_OK;
+}
+
+static struct notifier_block dbs_touch_boost_nb = {
+	.notifier_call = dbs_touch_boost_notify,
+};
+
 static int input_dev_filter(const char *input_dev_name)
 {
 	if (strstr(input_dev_name, "touchscreen") ||
@@ -1369,8 +1385,10 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 			if (dbs_tuners_ins.sync_freq == 0)
 				dbs_tuners_ins.sync_freq = policy->min;
 		}
-		if (!cpu)
+		if (!cpu) {
 			rc = input_register_handler(&dbs_input_handler);
+			touch_boost_register_notifier(&dbs_touch_boost_nb);
+		}
 		mutex_unlock(&dbs_mutex);
 
 		mutex_init(&this_dbs_info->timer_mutex);
@@ -1389,8 +1407,10 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		mutex_lock(&dbs_mutex);
 		dbs_enable--;
 		this_dbs_info->cur_policy = NULL;
-		if (!cpu)
+		if (!cpu) {
+			touch_boost_unregister_notifier(&dbs_touch_boost_nb);
 			input_unregister_handler(&dbs_input_handler);
+		}
 		if (!dbs_enable)
 			sysfs_remove_group(cpufreq_global_kobject,
 					   &dbs_attr_group);
@@ -20,6 +20,14 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
+#include <linux/gcd.h>
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+#include <linux/hash.h>
+#include <linux/proc_fs.h>
+#include <linux/rculist.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#endif
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
@@ -55,6 +63,12 @@ struct cpufreq_stats {
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	unsigned int *uid_index;
+#endif
+	unsigned int freq_gcd;
+	unsigned int map_size;
+	u8 *freq_map;
 };
 
 static DEFINE_PER_CPU(struct cpufreq_stats *, cpufreq_stats_table);
@@ -178,6 +192,215 @@ static ssize_t show_overall_time_in_state(struct kobject *kobj,
 	return len;
 }
 
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+#define UID_HASH_BITS	7
+
+struct uid_entry {
+	uid_t uid;
+	struct hlist_node hash;
+	atomic64_t time_in_state[CPU_FREQ_LEVEL_NUMBER];
+};
+
+struct uid_cpu_stats {
+	u64 mark;
+	u64 updates;
+	u64 overhead_ns;
+	u64 dropped_ns;
+	uid_t pending_uid;
+	bool pending;
+};
+
+static DEFINE_SPINLOCK(uid_lock);
+static struct hlist_head uid_hash[1 << UID_HASH_BITS];
+static unsigned int uid_nr;
+static unsigned int uid_freqs[CPU_FREQ_LEVEL_NUMBER];
+static unsigned int uid_nr_freqs;
+
+static DEFINE_PER_CPU(struct uid_cpu_stats, uid_cpu_stats);
+static DEFINE_PER_CPU(int, uid_freq_index) = -1;
+
+static unsigned int uid_freq_get_index(unsigned int freq)
+{
+	unsigned int i;
+
+	for (i = 0; i < uid_nr_freqs; i++)
+		if (uid_freqs[i] == freq)
+			return i;
+	if (uid_nr_freqs < CPU_FREQ_LEVEL_NUMBER)
+		uid_freqs[uid_nr_freqs++] = freq;
+	return i;
+}
+
+static void uid_set_freq_index(struct cpufreq_stats *stat, unsigned int cpu,
+			       int index)
+{
+	if (index < 0 || stat->uid_index[index] >= CPU_FREQ_LEVEL_NUMBER)
+		per_cpu(uid_freq_index, cpu) = -1;
+	else
+		per_cpu(uid_freq_index, cpu) = stat->uid_index[index];
+}
+
+static struct uid_entry *uid_entry_find(uid_t uid)
+{
+	struct uid_entry *e;
+	struct hlist_node *node;
+
+	hlist_for_each_entry_rcu(e, node,
+				 &uid_hash[hash_32(uid, UID_HASH_BITS)], hash)
+		if (e->uid == uid)
+			return e;
+	return NULL;
+}
+
+static struct uid_entry *uid_entry_add(uid_t uid)
+{
+	struct uid_entry *e, *new;
+
+	new = kzalloc(sizeof(*new), GFP_ATOMIC | __GFP_NOWARN);
+	if (!new)
+		return NULL;
+	new->uid = uid;
+
+	spin_lock(&uid_lock);
+	e = uid_entry_find(uid);
+	if (!e) {
+		hlist_add_head_rcu(&new->hash,
+				   &uid_hash[hash_32(uid, UID_HASH_BITS)]);
+		uid_nr++;
+		e = new;
+		new = NULL;
+	}
+	spin_unlock(&uid_lock);
+
+	kfree(new);
+	return e;
+}
+
+/*
+ * Called with interrupts off, from the context switch with the runqueue
+ * locked and from the tick without it.  Entries are never removed, so
+ * the lookup needs no lock and uid_lock only serializes insertion.
+ * Entries are never allocated on the switch path: a UID seen there for
+ * the first time is left for the next tick to add.
+ */
+static void uid_account(struct uid_cpu_stats *c, struct task_struct *p,
+			bool tick)
+{
+	int index = __this_cpu_read(uid_freq_index);
+	u64 runtime = p->se.sum_exec_runtime;
+	u64 delta = runtime - c->mark;
+	struct uid_entry *e;
+	uid_t uid;
+
+	if (is_idle_task(p) || runtime <= c->mark)
+		return;
+
+	if (index < 0) {
+		c->dropped_ns += delta;
+		return;
+	}
+
+	uid = task_uid(p);
+	rcu_read_lock();
+	e = uid_entry_find(uid);
+	rcu_read_unlock();
+	if (!e && tick)
+		e = uid_entry_add(uid);
+
+	if (e) {
+		atomic64_add(delta, &e->time_in_state[index]);
+		c->updates++;
+	} else {
+		c->dropped_ns += delta;
+		c->pending_uid = uid;
+		c->pending = true;
+	}
+}
+
+void cpufreq_stats_task_switch(struct task_struct *prev,
+			       struct task_struct *next)
+{
+	struct uid_cpu_stats *c = &__get_cpu_var(uid_cpu_stats);
+	u64 start = sched_clock();
+
+	uid_account(c, prev, false);
+	c->mark = next->se.sum_exec_runtime;
+	c->overhead_ns += sched_clock() - start;
+}
+
+void cpufreq_stats_tick(struct task_struct *curr)
+{
+	struct uid_cpu_stats *c = &__get_cpu_var(uid_cpu_stats);
+	u64 start = sched_clock();
+
+	if (c->pending) {
+		c->pending = false;
+		uid_entry_add(c->pending_uid);
+	}
+	uid_account(c, curr, true);
+	c->mark = curr->se.sum_exec_runtime;
+	c->overhead_ns += sched_clock() - start;
+}
+
+static int uid_time_in_state_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *e;
+	struct hlist_node *node;
+	unsigned int i, nr = uid_nr_freqs;
+
+	seq_puts(m, "uid:");
+	for (i = 0; i < nr; i++)
+		seq_printf(m, " %u", uid_freqs[i]);
+	seq_putc(m, '\n');
+
+	rcu_read_lock();
+	for (i = 0; i < ARRAY_SIZE(uid_hash); i++) {
+		hlist_for_each_entry_rcu(e, node, &uid_hash[i], hash) {
+			unsigned int j;
+
+			seq_printf(m, "%u:", e->uid);
+			for (j = 0; j < nr; j++)
+				seq_printf(m, " %llu",
+					   nsec_to_clock_t(atomic64_read(
+					   &e->time_in_state[j])));
+			seq_putc(m, '\n');
+		}
+	}
+	rcu_read_unlock();
+	return 0;
+}
+
+static int uid_time_in_state_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_time_in_state_show, NULL);
+}
+
+static const struct file_operations uid_time_in_state_fops = {
+	.open		= uid_time_in_state_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t show_uid_stats(struct kobject *kobj,
+			      struct attribute *attr, char *buf)
+{
+	u64 updates = 0, overhead_ns = 0, dropped_ns = 0;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct uid_cpu_stats *c = &per_cpu(uid_cpu_stats, cpu);
+
+		updates += c->updates;
+		overhead_ns += c->overhead_ns;
+		dropped_ns += c->dropped_ns;
+	}
+	return sprintf(buf, "uids %u\nupdates %llu\noverhead_ns %llu\n"
+		       "dropped_ns %llu\n", uid_nr, updates, overhead_ns,
+		       dropped_ns);
+}
+#endif
+
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
@@ -232,6 +455,9 @@ CPUFREQ_STATDEVICE_ATTR(time_in_state, 0444, show_time_in_state);
 typedef ssize_t (*show)(struct cpufreq_policy *, char *);
 CPUFREQ_STATDEVICE_ATTR(overall_time_in_state, 0444, (show)show_overall_time_in_state);
 CPUFREQ_STATDEVICE_ATTR(overall_total_trans, 0444, (show)show_overall_total_trans);
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+CPUFREQ_STATDEVICE_ATTR(uid_stats, 0444, (show)show_uid_stats);
+#endif
 
 static struct attribute *default_attrs[] = {
 	&_attr_total_trans.attr,
@@ -245,6 +471,9 @@ static struct attribute *default_attrs[] = {
 static struct attribute *overall_attrs[] = {
 	&_attr_overall_time_in_state.attr,
 	&_attr_overall_total_trans.attr,
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	&_attr_uid_stats.attr,
+#endif
 	NULL
 };
 
@@ -258,15 +487,60 @@ static struct attribute_group overall_stats_attr_group = {
         .name = "overall_stats"
 };
 
+#define FREQ_MAP_INVALID	0xff
+#define FREQ_MAP_MAX_SIZE	4096
+
 static int freq_table_get_index(struct cpufreq_stats *stat, unsigned int freq)
 {
 	int index;
+
+	if (stat->freq_map) {
+		if (freq % stat->freq_gcd)
+			return -1;
+		freq /= stat->freq_gcd;
+		if (freq >= stat->map_size)
+			return -1;
+		index = stat->freq_map[freq];
+		return index == FREQ_MAP_INVALID ? -1 : index;
+	}
+
 	for (index = 0; index < stat->max_state; index++)
 		if (stat->freq_table[index] == freq)
 			return index;
 	return -1;
 }
 
+/*
+ * Frequency tables are short and their entries share a large common
+ * divisor, so map freq / gcd straight to the state index instead of
+ * scanning the table on every transition.
+ */
+static void freq_table_build_map(struct cpufreq_stats *stat)
+{
+	unsigned int i, div = 0, top = 0;
+	u8 *map;
+
+	if (stat->state_num >= FREQ_MAP_INVALID)
+		return;
+	for (i = 0; i < stat->state_num; i++) {
+		div = gcd(div, stat->freq_table[i]);
+		top = max(top, stat->freq_table[i]);
+	}
+	if (!div || top / div >= FREQ_MAP_MAX_SIZE)
+		return;
+
+	map = kmalloc(top / div + 1, GFP_KERNEL);
+	if (!map)
+		return;
+	memset(map, FREQ_MAP_INVALID, top / div + 1);
+	for (i = 0; i < stat->state_num; i++)
+		map[stat->freq_table[i] / div] = i;
+
+	stat->freq_gcd = div;
+	stat->map_size = top / div + 1;
+	stat->freq_map = map;
+}
+
 /* should be called late in the CPU removal sequence so that the stats
  * memory is still available in case someone tries to use it.
  */
@@ -281,6 +555,7 @@ static void cpufreq_stats_free_table(unsigned int cpu)
 
 	if (stat) {
 		cpufreq_stats_update(cpu);
+		kfree(stat->freq_map);
 		kfree(stat->time_in_state);
 		kfree(stat);
 	}
@@ -336,6 +611,9 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	alloc_size += count * count * sizeof(int);
+#endif
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	alloc_size += count * sizeof(int);
 #endif
 	stat->max_state = count;
 	stat->time_in_state = kzalloc(alloc_size, GFP_KERNEL);
@@ -347,6 +625,12 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	stat->trans_table = stat->freq_table + count;
+#endif
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	stat->uid_index = stat->freq_table + count;
+#ifdef CONFIG_CPU_FREQ_STAT_DETAILS
+	stat->uid_index += count * count;
+#endif
 #endif
 	j = 0;
 	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
@@ -357,9 +641,17 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 			stat->freq_table[j++] = freq;
 	}
 	stat->state_num = j;
+	freq_table_build_map(stat);
 	spin_lock(&cpufreq_stats_lock);
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	for (i = 0; i < stat->state_num; i++)
+		stat->uid_index[i] = uid_freq_get_index(stat->freq_table[i]);
+#endif
 	stat->last_time = get_jiffies_64();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	uid_set_freq_index(stat, cpu, stat->last_index);
+#endif
 	spin_unlock(&cpufreq_stats_lock);
 	cpufreq_cpu_put(data);
 	return 0;
@@ -412,8 +704,10 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	new_index = freq_table_get_index(stat, freq->new);
 
 	/* We can't do stat->time_in_state[-1]= .. */
-	if (old_index == -1 || new_index == -1)
+	if (old_index == -1 || new_index == -1) {
+		spin_unlock(&cpufreq_stats_lock);
 		return 0;
+	}
 
 	if (old_index == new_index) {
 		spin_unlock(&cpufreq_stats_lock);
@@ -421,6 +715,9 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	}
 
 	stat->last_index = new_index;
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	uid_set_freq_index(stat, freq->cpu, new_index);
+#endif
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	stat->trans_table[old_index * stat->max_state + new_index]++;
 #endif
@@ -501,6 +798,9 @@ static int __init cpufreq_stats_init(void)
 	}
 
 	ret = sysfs_create_group(cpufreq_global_kobject, &overall_stats_attr_group);
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	proc_create("uid_time_in_state", S_IRUGO, NULL, &uid_time_in_state_fops);
+#endif
 
 	return 0;
 }
@@ -28,6 +28,8 @@
 #include <linux/seq_file.h>
 #include <linux/fmem.h>
 #include <linux/iommu.h>
+#include <linux/dma-mapping.h>
+#include <linux/ktime.h>
 
 #include <asm/mach/map.h>
 
@@ -66,6 +68,13 @@ struct ion_cp_heap {
 	int iommu_2x_map_domain;
 	unsigned int has_outer_cache;
 	atomic_t protect_cnt;
+	struct device *cma_dev;
+	void *cma_vaddr;
+	unsigned long cma_allocs;
+	unsigned long cma_fails;
+	unsigned long cma_last_us;
+	unsigned long cma_max_us;
+	u64 cma_total_us;
 };
 
 enum {
@@ -87,6 +96,62 @@ static unsigned long ion_cp_get_total_kmap_count(
 	return cp_heap->kmap_cached_count + cp_heap->kmap_uncached_count;
 }
 
+/*
+ * Heaps backed by a CMA area take the whole area when the first buffer
+ * is allocated (or the heap is secured) and give it back to the page
+ * allocator once the heap is empty and unprotected again.
+ */
+static int ion_cp_cma_get(struct ion_cp_heap *cp_heap)
+{
+	dma_addr_t handle;
+	ktime_t start;
+	unsigned long us;
+
+	if (!cp_heap->cma_dev || cp_heap->cma_vaddr)
+		return 0;
+
+	start = ktime_get();
+	cp_heap->cma_vaddr = dma_alloc_coherent(cp_heap->cma_dev,
+				cp_heap->total_size, &handle, GFP_KERNEL);
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	if (cp_heap->cma_vaddr && handle != cp_heap->base) {
+		pr_err("%s: heap %s got %lx from CMA instead of %lx\n",
+			__func__, cp_heap->heap.name, (unsigned long)handle,
+			cp_heap->base);
+		dma_free_coherent(cp_heap->cma_dev, cp_heap->total_size,
+				  cp_heap->cma_vaddr, handle);
+		cp_heap->cma_vaddr = NULL;
+	}
+	if (!cp_heap->cma_vaddr) {
+		cp_heap->cma_fails++;
+		pr_err("%s: unable to claim CMA area for heap %s (%lu us)\n",
+			__func__, cp_heap->heap.name, us);
+		return -ENOMEM;
+	}
+
+	cp_heap->cma_allocs++;
+	cp_heap->cma_last_us = us;
+	cp_heap->cma_total_us += us;
+	if (us > cp_heap->cma_max_us)
+		cp_heap->cma_max_us = us;
+	pr_debug("%s: heap %s claimed CMA area in %lu us\n", __func__,
+		cp_heap->heap.name, us);
+	return 0;
+}
+
+static void ion_cp_cma_put(struct ion_cp_heap *cp_heap)
+{
+	if (!cp_heap->cma_vaddr)
+		return;
+
+	dma_free_coherent(cp_heap->cma_dev, cp_heap->total_size,
+			  cp_heap->cma_vaddr, cp_heap->base);
+	cp_heap->cma_vaddr = NULL;
+	pr_debug("%s: heap %s released CMA area\n", __func__,
+		cp_heap->heap.name);
+}
+
 static int ion_cp_protect(struct ion_heap *heap, int version, void *data)
 {
 	struct ion_cp_heap *cp_heap =
@@ -101,6 +166,12 @@ static int ion_cp_protect(struct ion_heap *heap, int version, void *data)
 				goto out;
 		}
 
+		ret_value = ion_cp_cma_get(cp_heap);
+		if (ret_value) {
+			atomic_dec(&cp_heap->protect_cnt);
+			goto out;
+		}
+
 		ret_value = ion_cp_protect_mem(cp_heap->secure_base,
 				cp_heap->secure_size, cp_heap->permission_type,
 				version, data);
@@ -113,6 +184,8 @@ static int ion_cp_protect(struct ion_heap *heap, int version, void *data)
 					pr_err("%s: unable to transition heap to T-state\n",
 						__func__);
 			}
+			if (!cp_heap->allocated_bytes)
+				ion_cp_cma_put(cp_heap);
 			atomic_dec(&cp_heap->protect_cnt);
 		} else {
 			cp_heap->heap_protected = HEAP_PROTECTED;
@@ -149,6 +222,8 @@ static void ion_cp_unprotect(struct ion_heap *heap, int version, void *data)
 					pr_err("%s: unable to transition heap to T-state",
 						__func__);
 			}
+			if (!cp_heap->allocated_bytes)
+				ion_cp_cma_put(cp_heap);
 		}
 	}
 	pr_debug("%s: protect count is %d\n", __func__,
@@ -192,6 +267,11 @@ ion_phys_addr_t ion_cp_allocate(struct ion_heap *heap,
 		}
 	}
 
+	if (ion_cp_cma_get(cp_heap)) {
+		mutex_unlock(&cp_heap->lock);
+		return ION_CP_ALLOCATE_FAIL;
+	}
+
 	cp_heap->allocated_bytes += size;
 	mutex_unlock(&cp_heap->lock);
 
@@ -216,6 +296,9 @@ ion_phys_addr_t ion_cp_allocate(struct ion_heap *heap,
 				pr_err("%s: unable to transition heap to T-state\n",
 					__func__);
 		}
+		if (!cp_heap->allocated_bytes &&
+		    cp_heap->heap_protected == HEAP_NOT_PROTECTED)
+			ion_cp_cma_put(cp_heap);
 		mutex_unlock(&cp_heap->lock);
 
 		return ION_CP_ALLOCATE_FAIL;
@@ -285,6 +368,8 @@ void ion_cp_free(struct ion_heap *heap, ion_phys_addr_t addr,
 			cp_heap->iommu_iova[i] = 0;
 			cp_heap->iommu_partition[i] = 0;
 		}
+		if (cp_heap->heap_protected == HEAP_NOT_PROTECTED)
+			ion_cp_cma_put(cp_heap);
 	}
 	mutex_unlock(&cp_heap->lock);
 }
@@ -413,6 +498,9 @@ void *ion_cp_heap_map_kernel(struct ion_heap *heap, struct ion_buffer *buffer)
 			ret_value = ion_map_fmem_buffer(buffer, cp_heap->base,
 				cp_heap->reserved_vrange, buffer->flags);
 
+		} else if (cp_heap->cma_dev) {
+			ret_value = cp_heap->cma_vaddr +
+				(buffer->priv_phys - cp_heap->base);
 		} else {
 			if (ION_IS_CACHED(buffer->flags))
 				ret_value = ioremap_cached(buffer->priv_phys,
@@ -443,7 +531,7 @@ void ion_cp_heap_unmap_kernel(struct ion_heap *heap,
 
 	if (cp_heap->reusable)
 		unmap_kernel_range((unsigned long)buffer->vaddr, buffer->size);
-	else
+	else if (!cp_heap->cma_dev)
 		__arm_iounmap(buffer->vaddr);
 
 	buffer->vaddr = NULL;
@@ -560,6 +648,19 @@ static int ion_cp_print_debug(struct ion_heap *heap, struct seq_file *s,
 	seq_printf(s, "kmapping count: %lx\n", kmap_count);
 	seq_printf(s, "heap protected: %s\n", heap_protected ? "Yes" : "No");
 	seq_printf(s, "reusable: %s\n", cp_heap->reusable  ? "Yes" : "No");
+	if (cp_heap->cma_dev) {
+		mutex_lock(&cp_heap->lock);
+		seq_printf(s, "cma: %s\n", cp_heap->cma_vaddr ?
+			   "claimed" : "released");
+		seq_printf(s, "cma claims: %lu\n", cp_heap->cma_allocs);
+		seq_printf(s, "cma claim failures: %lu\n", cp_heap->cma_fails);
+		seq_printf(s, "cma claim latency last/max/avg (us): "
+			   "%lu/%lu/%llu\n", cp_heap->cma_last_us,
+			   cp_heap->cma_max_us, cp_heap->cma_allocs ?
+			   div_u64(cp_heap->cma_total_us, cp_heap->cma_allocs) :
+			   0);
+		mutex_unlock(&cp_heap->lock);
+	}
 
 	if (mem_map) {
 		unsigned long base = cp_heap->base;
@@ -894,6 +995,7 @@ struct ion_heap *ion_cp_heap_create(struct ion_platform_heap *heap_data)
 				extra_data->iommu_map_all;
 		cp_heap->iommu_2x_map_domain =
 				extra_data->iommu_2x_map_domain;
+		cp_heap->cma_dev = extra_data->cma_dev;
 
 	}
 
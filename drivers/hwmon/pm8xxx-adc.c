@@ -122,6 +122,13 @@
 #define PM8XXX_ADC_PA_THERM_VREG_UA_LOAD		100000
 #define PM8XXX_ADC_HWMON_NAME_LENGTH			32
 #define PM8XXX_ADC_BTM_INTERVAL_MAX			0x14
+#define PM8XXX_ADC_CACHE_MS				200
+
+struct pm8xxx_adc_cache {
+	struct pm8xxx_adc_chan_result		result;
+	unsigned long				stamp;
+	bool					valid;
+};
 
 struct pm8xxx_adc {
 	struct device				*dev;
@@ -143,6 +150,10 @@ struct pm8xxx_adc {
 	struct wake_lock			adc_wakelock;
 	int					msm_suspend_check;
 	struct pm8xxx_adc_amux_properties	*conv;
+	struct pm8xxx_adc_cache			*cache;
+	u32					cache_ms;
+	u32					conversions;
+	u32					coalesced;
 	struct pm8xxx_adc_arb_btm_param		batt[0];
 	struct sensor_device_attribute		sens_attr[0];
 };
@@ -655,8 +666,9 @@ calib_fail:
 	return rc;
 }
 
-uint32_t pm8xxx_adc_read(enum pm8xxx_adc_channels channel,
-				struct pm8xxx_adc_chan_result *result)
+static uint32_t __pm8xxx_adc_read(enum pm8xxx_adc_channels channel,
+				struct pm8xxx_adc_chan_result *result,
+				bool cached)
 {
 	struct pm8xxx_adc *adc_pmic = pmic_adc;
 	int i = 0, rc = 0, rc_fail, amux_prescaling, scale_type;
@@ -685,6 +697,15 @@ uint32_t pm8xxx_adc_read(enum pm8xxx_adc_channels channel,
 		goto fail_unlock;
 	}
 
+	if (cached && adc_pmic->cache && adc_pmic->cache[i].valid &&
+		time_before(jiffies, adc_pmic->cache[i].stamp +
+				msecs_to_jiffies(adc_pmic->cache_ms))) {
+		*result = adc_pmic->cache[i].result;
+		adc_pmic->coalesced++;
+		mutex_unlock(&adc_pmic->adc_lock);
+		return 0;
+	}
+
 	if (channel < PM8XXX_CHANNEL_MPP_SCALE1_IDX) {
 		mpp_scale = PREMUX_MPP_SCALE_0;
 		adc_pmic->conv->amux_channel = channel;
@@ -760,6 +781,13 @@ uint32_t pm8xxx_adc_read(enum pm8xxx_adc_channels channel,
 		goto fail_unlock;
 	}
 
+	adc_pmic->conversions++;
+	if (cached && adc_pmic->cache) {
+		adc_pmic->cache[i].result = *result;
+		adc_pmic->cache[i].stamp = jiffies;
+		adc_pmic->cache[i].valid = true;
+	}
+
 	mutex_unlock(&adc_pmic->adc_lock);
 
 	return 0;
@@ -772,6 +800,12 @@ fail_unlock:
 	pr_err("pm8xxx adc error with %d\n", rc);
 	return rc;
 }
+
+uint32_t pm8xxx_adc_read(enum pm8xxx_adc_channels channel,
+				struct pm8xxx_adc_chan_result *result)
+{
+	return __pm8xxx_adc_read(channel, result, true);
+}
 EXPORT_SYMBOL_GPL(pm8xxx_adc_read);
 
 uint32_t pm8xxx_adc_mpp_config_read(uint32_t mpp_num,
@@ -801,7 +835,7 @@ uint32_t pm8xxx_adc_mpp_config_read(uint32_t mpp_num,
 	usleep_range(PM8XXX_ADC_MPP_SETTLE_TIME_MIN,
 					PM8XXX_ADC_MPP_SETTLE_TIME_MAX);
 
-	rc = pm8xxx_adc_read(channel, result);
+	rc = __pm8xxx_adc_read(channel, result, false);
 	if (rc < 0)
 		pr_err("pm8xxx adc read error with %d\n", rc);
 
@@ -1079,6 +1113,13 @@ static void create_debugfs_entries(void)
 			0644, pmic_adc->dent,
 			(void *)pmic_adc->adc_channel[i].channel_name,
 			&reg_fops);
+
+	debugfs_create_u32("cache_ms", 0644, pmic_adc->dent,
+			&pmic_adc->cache_ms);
+	debugfs_create_u32("conversions", 0444, pmic_adc->dent,
+			&pmic_adc->conversions);
+	debugfs_create_u32("coalesced", 0444, pmic_adc->dent,
+			&pmic_adc->coalesced);
 }
 #else
 static inline void create_debugfs_entries(void)
@@ -1208,6 +1249,13 @@ static int __devinit pm8xxx_adc_probe(struct platform_device *pdev)
 	adc_pmic->adc_num_board_channel = pdata->adc_num_board_channel;
 	adc_pmic->mpp_base = pdata->adc_mpp_base;
 
+	adc_pmic->cache = devm_kzalloc(&pdev->dev,
+				sizeof(struct pm8xxx_adc_cache) *
+				pdata->adc_num_board_channel, GFP_KERNEL);
+	if (!adc_pmic->cache)
+		pr_warn("adc result cache not allocated\n");
+	adc_pmic->cache_ms = PM8XXX_ADC_CACHE_MS;
+
 	if (pdata->adc_map_btm_table)
 		pm8xxx_adc_set_adcmap_btm_table(pdata->adc_map_btm_table);
 	else
@@ -26,6 +26,8 @@
 #include <linux/earlysuspend.h>
 #endif
 #include <linux/wakelock.h>
+#include <linux/ktime.h>
+#include <linux/sensor_batch.h>
 
 #include <linux/bma250.h>
 #define D(x...) printk(KERN_DEBUG "[GSNR][BMA250_BOSCH] " x)
@@ -34,6 +36,8 @@
 
 #define HTC_ATTR 1
 
+#define BMA250_BATCH_SIZE	1024
+
 struct bma250acc{
 	s16	x,
 		y,
@@ -70,6 +74,8 @@ struct bma250_data {
 	struct bma250_platform_data *pdata;
 	short offset_buf[3];
 
+	struct sensor_batch batch;
+
 #ifdef CONFIG_SIG_MOTION
 	struct input_dev *input_sig_motion;
 	atomic_t en_sig_motion;
@@ -1565,8 +1571,10 @@ static void bma250_work_func(struct work_struct *work)
 	unsigned long delay = msecs_to_jiffies(atomic_read(&bma250->delay));
 	s16 data_x = 0, data_y = 0, data_z = 0;
 	s16 hw_d[3] = {0};
+	s64 timestamp;
 
 	bma250_read_accel_xyz(bma250->bma250_client, &acc);
+	timestamp = ktime_to_ns(ktime_get());
 
 	hw_d[0] = acc.x + bma250->offset_buf[0];
 	hw_d[1] = acc.y + bma250->offset_buf[1];
@@ -1579,10 +1587,17 @@ static void bma250_work_func(struct work_struct *work)
 	data_z = ((bma250->pdata->negate_z) ? (-hw_d[bma250->pdata->axis_map_z])
 		   : (hw_d[bma250->pdata->axis_map_z]));
 
-	input_report_abs(bma250->input, ABS_X, data_x);
-	input_report_abs(bma250->input, ABS_Y, data_y);
-	input_report_abs(bma250->input, ABS_Z, data_z);
-	input_sync(bma250->input);
+	if (sensor_batch_active(&bma250->batch)) {
+		sensor_batch_push(&bma250->batch, timestamp,
+				  data_x, data_y, data_z);
+		sensor_batch_commit(&bma250->batch,
+				    atomic_read(&bma250->delay));
+	} else {
+		input_report_abs(bma250->input, ABS_X, data_x);
+		input_report_abs(bma250->input, ABS_Y, data_y);
+		input_report_abs(bma250->input, ABS_Z, data_z);
+		input_sync(bma250->input);
+	}
 	mutex_lock(&bma250->value_mutex);
 	bma250->value = acc;
 	mutex_unlock(&bma250->value_mutex);
@@ -3479,6 +3494,9 @@ static int bma250_probe(struct i2c_client *client,
 
 #endif 
 
+	if (sensor_batch_register(&data->batch, "accel", BMA250_BATCH_SIZE))
+		E("%s: accel batch device failed\n", __func__);
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	data->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
 	data->early_suspend.suspend = bma250_early_suspend;
@@ -3581,6 +3599,7 @@ static int __devexit bma250_remove(struct i2c_client *client)
 	unregister_early_suspend(&data->early_suspend);
 #endif
 	sysfs_remove_group(&data->input->dev.kobj, &bma250_attribute_group);
+	sensor_batch_unregister(&data->batch);
 	input_unregister_device(data->input);
 	kfree(data);
 
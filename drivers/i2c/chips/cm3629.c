@@ -2872,6 +2872,7 @@ static struct i2c_driver cm3629_driver = {
 	.driver = {
 		.name = CM3629_I2C_NAME,
 		.owner = THIS_MODULE,
+		.async_domain = &device_async_sensors,
 	},
 };
 
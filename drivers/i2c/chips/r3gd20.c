@@ -47,6 +47,8 @@
 #include <linux/slab.h>
 
 #include <linux/r3gd20.h>
+#include <linux/sensor_batch.h>
+#include <linux/ktime.h>
 #include <linux/delay.h>
 #include <linux/export.h>
 #include <linux/module.h>
@@ -110,6 +112,10 @@
 #define	FIFO_WATERMARK_MASK	0x1F
 
 #define FIFO_STORED_DATA_MASK	0x1F
+#define FIFO_DEPTH		32
+#define FIFO_SAMPLE_BYTES	6
+
+#define R3GD20_BATCH_SIZE	512
 
 
 #define FUZZ			0
@@ -220,6 +226,9 @@ struct r3gd20_data {
 	int cali_data_z;
 
 	int is_suspended;
+
+	struct sensor_batch batch;
+	u8 fifo_buf[FIFO_DEPTH * FIFO_SAMPLE_BYTES];
 };
 
 #ifdef HTC_WQ
@@ -604,21 +613,11 @@ static int r3gd20_get_status(struct r3gd20_data *gyro ,unsigned char *status)
 #endif
 
 
-static int r3gd20_get_data(struct r3gd20_data *gyro,
-			     struct r3gd20_triple *data)
+static void r3gd20_convert(struct r3gd20_data *gyro, const u8 *gyro_out,
+			   struct r3gd20_triple *data)
 {
-	int err;
-	unsigned char gyro_out[6];
-	
 	s16 hw_d[3] = { 0 };
 
-	gyro_out[0] = (I2C_AUTO_INCREMENT | AXISDATA_REG);
-
-	err = r3gd20_i2c_read(gyro, gyro_out, 6);
-
-	if (err < 0)
-		return err;
-
 	hw_d[0] = (s16) (((gyro_out[1]) << 8) | gyro_out[0]);
 	hw_d[1] = (s16) (((gyro_out[3]) << 8) | gyro_out[2]);
 	hw_d[2] = (s16) (((gyro_out[5]) << 8) | gyro_out[4]);
@@ -629,6 +628,22 @@ static int r3gd20_get_data(struct r3gd20_data *gyro,
 		   : (hw_d[gyro->pdata->axis_map_y]));
 	data->z = ((gyro->pdata->negate_z) ? (-hw_d[gyro->pdata->axis_map_z])
 		   : (hw_d[gyro->pdata->axis_map_z]));
+}
+
+static int r3gd20_get_data(struct r3gd20_data *gyro,
+			     struct r3gd20_triple *data)
+{
+	int err;
+	unsigned char gyro_out[6];
+
+	gyro_out[0] = (I2C_AUTO_INCREMENT | AXISDATA_REG);
+
+	err = r3gd20_i2c_read(gyro, gyro_out, 6);
+
+	if (err < 0)
+		return err;
+
+	r3gd20_convert(gyro, gyro_out, data);
 
 	DIF("gyro_out: x = %d, y = %d, z = %d\n",
 		data->x, data->y, data->z);
@@ -652,12 +667,85 @@ static void r3gd20_report_values(struct r3gd20_data *gyr,
 }
 
 #ifdef HTC_WQ
+static unsigned int r3gd20_odr_hz(struct r3gd20_data *gyro)
+{
+#ifdef cywee
+	return (gyro->input_poll_dev->poll_interval > 20) ? 95 : 190;
+#else
+	switch (gyro->resume_state[RES_CTRL_REG1] & ODR760) {
+	case ODR760:
+		return 760;
+	case ODR380:
+		return 380;
+	case ODR190:
+		return 190;
+	default:
+		return 95;
+	}
+#endif
+}
+
+static unsigned int r3gd20_poll_ms(struct r3gd20_data *gyro)
+{
+	unsigned int ms = gyro->input_poll_dev->poll_interval;
+	unsigned int fifo_ms;
+
+	if (!sensor_batch_active(&gyro->batch))
+		return ms;
+
+#ifdef cywee
+	fifo_ms = (FIFO_DEPTH * 3 / 4) * 1000 / r3gd20_odr_hz(gyro);
+#else
+	fifo_ms = ms;
+#endif
+	return max(ms, min(gyro->batch.max_latency_ms, fifo_ms));
+}
+
+static void r3gd20_push_values(struct r3gd20_data *gyro,
+			       struct r3gd20_triple *data, s64 timestamp)
+{
+	if (sensor_batch_active(&gyro->batch))
+		sensor_batch_push(&gyro->batch, timestamp,
+				  data->x, data->y, data->z);
+	else
+		r3gd20_report_values(gyro, data);
+}
+
+#ifdef cywee
+static int r3gd20_drain_fifo(struct r3gd20_data *gyro, int count)
+{
+	struct r3gd20_triple data_out;
+	s64 now, period;
+	int err, i;
+
+	gyro->fifo_buf[0] = (I2C_AUTO_INCREMENT | AXISDATA_REG);
+	err = r3gd20_i2c_read(gyro, gyro->fifo_buf,
+			      count * FIFO_SAMPLE_BYTES);
+	if (err < 0)
+		return err;
+
+	now = ktime_to_ns(ktime_get());
+	period = NSEC_PER_SEC / r3gd20_odr_hz(gyro);
+	for (i = 0; i < count; i++) {
+		r3gd20_convert(gyro, &gyro->fifo_buf[i * FIFO_SAMPLE_BYTES],
+			       &data_out);
+		r3gd20_push_values(gyro, &data_out,
+				   now - (count - 1 - i) * period);
+	}
+	return err;
+}
+#endif
+
 static void polling_do_work(struct work_struct *w)
 {
 	struct r3gd20_data *gyro = g_gyro;
-	struct r3gd20_triple data_out;
+	unsigned int poll_ms;
 	int err;
+#ifdef cywee
 	unsigned char status = 0;
+#else
+	struct r3gd20_triple data_out;
+#endif
 
 	mutex_lock(&gyro->lock);
 
@@ -665,37 +753,46 @@ static void polling_do_work(struct work_struct *w)
 	err = r3gd20_get_status(gyro, &status);
 	if (err < 0)
 		dev_err(&gyro->client->dev, "get_gyroscope_status failed\n");
-	else {
-		while(status > 0){
-			err = r3gd20_get_data(gyro, &data_out);
-			if (err < 0)
-				dev_err(&gyro->client->dev, "get_gyroscope_data failed\n");
-			else
-				r3gd20_report_values(gyro, &data_out);
-			status --;
-		}
+	else if (status > 0) {
+		err = r3gd20_drain_fifo(gyro, status);
+		if (err < 0)
+			dev_err(&gyro->client->dev, "get_gyroscope_data failed\n");
 	}
 #else
 	err = r3gd20_get_data(gyro, &data_out);
 	if (err < 0)
 		dev_err(&gyro->client->dev, "get_gyroscope_data failed\n");
 	else
-		r3gd20_report_values(gyro, &data_out);
+		r3gd20_push_values(gyro, &data_out,
+				   ktime_to_ns(ktime_get()));
 
 
 #endif
+	poll_ms = r3gd20_poll_ms(gyro);
 
 	mutex_unlock(&gyro->lock);
 
-	DIF("interval = %d, gyro->is_suspended = %d\n", gyro->input_poll_dev->
-					 poll_interval, gyro->is_suspended);
+	sensor_batch_commit(&gyro->batch, poll_ms);
+
+	DIF("interval = %d, gyro->is_suspended = %d\n", poll_ms,
+					 gyro->is_suspended);
 
 	if (gyro->is_suspended != 1) {
 		queue_delayed_work(gyro->gyro_wq, &polling_work,
-			msecs_to_jiffies(gyro->input_poll_dev->
-						 poll_interval));
+			msecs_to_jiffies(poll_ms));
 	}
 }
+
+static void r3gd20_batch_latency_changed(struct sensor_batch *batch)
+{
+	struct r3gd20_data *gyro = batch->priv;
+
+	I("%s: max latency %u ms\n", __func__, batch->max_latency_ms);
+	if (!atomic_read(&gyro->enabled) || gyro->is_suspended)
+		return;
+	cancel_delayed_work_sync(&polling_work);
+	queue_delayed_work(gyro->gyro_wq, &polling_work, 0);
+}
 #endif 
 
 #ifdef cywee
@@ -1789,6 +1886,12 @@ static int r3gd20_probe(struct i2c_client *client,
 		err = -ENOMEM;
 		goto err_create_singlethread_workqueue;
 	}
+
+	gyro->batch.priv = gyro;
+	gyro->batch.latency_changed = r3gd20_batch_latency_changed;
+	err = sensor_batch_register(&gyro->batch, "gyro", R3GD20_BATCH_SIZE);
+	if (err < 0)
+		E("%s: gyro batch device failed, err = %d\n", __func__, err);
 #endif 
 	debug_flag = 0;
 
@@ -1836,6 +1939,7 @@ static int r3gd20_remove(struct i2c_client *client)
 		destroy_workqueue(gyro->irq2_work_queue);
 	}
 
+	sensor_batch_unregister(&gyro->batch);
 	r3gd20_input_cleanup(gyro);
 	r3gd20_device_power_off(gyro);
 	remove_sysfs_interfaces(&client->dev);
@@ -0,0 +1,298 @@
+/* drivers/i2c/chips/sensor_batch.c
+ *
+ * Batched, timestamped delivery of motion sensor samples.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/device.h>
+#include <linux/fs.h>
+#include <linux/hrtimer.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/log2.h>
+#include <linux/sensor_batch.h>
+
+#define D(x...) printk(KERN_DEBUG "[SBATCH] " x)
+#define E(x...) printk(KERN_ERR "[SBATCH] " x)
+
+static inline unsigned int batch_count(struct sensor_batch *batch)
+{
+	return batch->head - batch->tail;
+}
+
+void sensor_batch_push(struct sensor_batch *batch, s64 timestamp,
+		       int x, int y, int z)
+{
+	struct sensor_batch_event *ev;
+	unsigned long flags;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	if (batch_count(batch) == batch->size) {
+		batch->tail++;
+		batch->dropped++;
+	}
+	ev = &batch->ring[batch->head & (batch->size - 1)];
+	ev->timestamp = timestamp;
+	ev->data[0] = x;
+	ev->data[1] = y;
+	ev->data[2] = z;
+	ev->reserved = 0;
+	batch->head++;
+	batch->events++;
+	spin_unlock_irqrestore(&batch->lock, flags);
+}
+EXPORT_SYMBOL(sensor_batch_push);
+
+void sensor_batch_commit(struct sensor_batch *batch, unsigned int next_ms)
+{
+	unsigned long flags;
+	bool wake = false;
+	s64 deadline;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	if (!batch->users || !batch_count(batch) || batch->ready)
+		goto out;
+
+	if (!batch->max_latency_ms || batch_count(batch) >= batch->size / 2) {
+		wake = true;
+	} else {
+		deadline = batch->ring[batch->tail & (batch->size - 1)].timestamp
+			+ (s64)batch->max_latency_ms * NSEC_PER_MSEC;
+		if (ktime_to_ns(ktime_get()) + (s64)next_ms * NSEC_PER_MSEC
+				> deadline)
+			wake = true;
+	}
+	if (wake) {
+		batch->ready = true;
+		batch->wakeups++;
+	}
+out:
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	if (wake)
+		wake_up_interruptible(&batch->wait);
+}
+EXPORT_SYMBOL(sensor_batch_commit);
+
+static void sensor_batch_flush(struct sensor_batch *batch)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	batch->ready = true;
+	spin_unlock_irqrestore(&batch->lock, flags);
+	wake_up_interruptible(&batch->wait);
+}
+
+static void sensor_batch_set_latency(struct sensor_batch *batch,
+				     unsigned int ms)
+{
+	unsigned long flags;
+
+	if (ms > SENSOR_BATCH_MAX_LATENCY_MS)
+		ms = SENSOR_BATCH_MAX_LATENCY_MS;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	batch->max_latency_ms = ms;
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	if (batch->latency_changed)
+		batch->latency_changed(batch);
+}
+
+static int sensor_batch_open(struct inode *inode, struct file *file)
+{
+	struct sensor_batch *batch = container_of(file->private_data,
+					struct sensor_batch, misc);
+	unsigned long flags;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	if (!batch->users++) {
+		batch->tail = batch->head;
+		batch->ready = false;
+	}
+	spin_unlock_irqrestore(&batch->lock, flags);
+	file->private_data = batch;
+
+	return nonseekable_open(inode, file);
+}
+
+static int sensor_batch_release(struct inode *inode, struct file *file)
+{
+	struct sensor_batch *batch = file->private_data;
+	unsigned long flags;
+	bool last;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	last = !--batch->users;
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	if (last && batch->max_latency_ms)
+		sensor_batch_set_latency(batch, 0);
+
+	return 0;
+}
+
+static ssize_t sensor_batch_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct sensor_batch *batch = file->private_data;
+	struct sensor_batch_event ev;
+	unsigned long flags;
+	size_t copied = 0;
+	int ret;
+
+	if (count < sizeof(ev))
+		return -EINVAL;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		ret = wait_event_interruptible(batch->wait, batch->ready);
+		if (ret)
+			return ret;
+	}
+
+	while (copied + sizeof(ev) <= count) {
+		spin_lock_irqsave(&batch->lock, flags);
+		if (!batch_count(batch)) {
+			batch->ready = false;
+			spin_unlock_irqrestore(&batch->lock, flags);
+			break;
+		}
+		ev = batch->ring[batch->tail & (batch->size - 1)];
+		batch->tail++;
+		if (!batch_count(batch))
+			batch->ready = false;
+		spin_unlock_irqrestore(&batch->lock, flags);
+
+		if (copy_to_user(buf + copied, &ev, sizeof(ev)))
+			return copied ? copied : -EFAULT;
+		copied += sizeof(ev);
+	}
+
+	if (!copied && (file->f_flags & O_NONBLOCK))
+		return -EAGAIN;
+	return copied;
+}
+
+static unsigned int sensor_batch_poll(struct file *file, poll_table *wait)
+{
+	struct sensor_batch *batch = file->private_data;
+
+	poll_wait(file, &batch->wait, wait);
+	return batch->ready ? POLLIN | POLLRDNORM : 0;
+}
+
+static long sensor_batch_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	struct sensor_batch *batch = file->private_data;
+	void __user *argp = (void __user *)arg;
+	u32 ms;
+
+	switch (cmd) {
+	case SENSOR_BATCH_IOCTL_SET_LATENCY:
+		if (copy_from_user(&ms, argp, sizeof(ms)))
+			return -EFAULT;
+		D("%s: %s max latency %u ms\n", __func__, batch->name, ms);
+		sensor_batch_set_latency(batch, ms);
+		return 0;
+	case SENSOR_BATCH_IOCTL_GET_LATENCY:
+		ms = batch->max_latency_ms;
+		if (copy_to_user(argp, &ms, sizeof(ms)))
+			return -EFAULT;
+		return 0;
+	case SENSOR_BATCH_IOCTL_FLUSH:
+		sensor_batch_flush(batch);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static ssize_t sensor_batch_stats_show(struct device *dev,
+				       struct device_attribute *attr, char *buf)
+{
+	struct sensor_batch *batch = container_of(dev_get_drvdata(dev),
+					struct sensor_batch, misc);
+
+	return sprintf(buf, "latency_ms %u\nevents %u\nwakeups %u\n"
+		       "dropped %u\n", batch->max_latency_ms, batch->events,
+		       batch->wakeups, batch->dropped);
+}
+
+static DEVICE_ATTR(batch_stats, S_IRUGO, sensor_batch_stats_show, NULL);
+
+static const struct file_operations sensor_batch_fops = {
+	.owner		= THIS_MODULE,
+	.open		= sensor_batch_open,
+	.release	= sensor_batch_release,
+	.read		= sensor_batch_read,
+	.poll		= sensor_batch_poll,
+	.unlocked_ioctl	= sensor_batch_ioctl,
+	.llseek		= no_llseek,
+};
+
+int sensor_batch_register(struct sensor_batch *batch, const char *name,
+			  unsigned int size)
+{
+	int ret;
+
+	if (!is_power_of_2(size))
+		size = roundup_pow_of_two(size);
+
+	batch->ring = kcalloc(size, sizeof(*batch->ring), GFP_KERNEL);
+	if (!batch->ring)
+		return -ENOMEM;
+
+	spin_lock_init(&batch->lock);
+	init_waitqueue_head(&batch->wait);
+	batch->size = size;
+	batch->head = batch->tail = 0;
+	batch->users = 0;
+	batch->max_latency_ms = 0;
+	batch->ready = false;
+
+	snprintf(batch->name, sizeof(batch->name), "%s_batch", name);
+	batch->misc.minor = MISC_DYNAMIC_MINOR;
+	batch->misc.name = batch->name;
+	batch->misc.fops = &sensor_batch_fops;
+
+	ret = misc_register(&batch->misc);
+	if (ret < 0) {
+		E("%s: misc_register %s failed, ret = %d\n", __func__,
+		  batch->name, ret);
+		kfree(batch->ring);
+		batch->ring = NULL;
+		return ret;
+	}
+	if (device_create_file(batch->misc.this_device, &dev_attr_batch_stats))
+		E("%s: create batch_stats for %s failed\n", __func__,
+		  batch->name);
+
+	return 0;
+}
+EXPORT_SYMBOL(sensor_batch_register);
+
+void sensor_batch_unregister(struct sensor_batch *batch)
+{
+	if (!batch->ring)
+		return;
+	device_remove_file(batch->misc.this_device, &dev_attr_batch_stats);
+	misc_deregister(&batch->misc);
+	kfree(batch->ring);
+	batch->ring = NULL;
+}
+EXPORT_SYMBOL(sensor_batch_unregister);
@@ -0,0 +1,42 @@
+/*
+ * drivers/input/touch_boost.c
+ *
+ * Early notification of touch activity, so that cpufreq and GPU
+ * governors can ramp up before the first input event of a gesture
+ * reaches userspace.  Notifiers run in the caller's context, which
+ * is usually a touchscreen interrupt thread, and must not sleep.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/input/touch_boost.h>
+
+static ATOMIC_NOTIFIER_HEAD(touch_boost_chain);
+
+int touch_boost_register_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&touch_boost_chain, nb);
+}
+EXPORT_SYMBOL(touch_boost_register_notifier);
+
+int touch_boost_unregister_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&touch_boost_chain, nb);
+}
+EXPORT_SYMBOL(touch_boost_unregister_notifier);
+
+void touch_boost_notify(unsigned long event)
+{
+	atomic_notifier_call_chain(&touch_boost_chain, event, NULL);
+}
+EXPORT_SYMBOL(touch_boost_notify);
@@ -38,6 +38,10 @@
 #include <linux/firmware.h>
 #include <linux/kthread.h>
 #include <linux/wait.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/input/touch_boost.h>
 
 #ifdef CONFIG_TOUCHSCREEN_SYNAPTICS_SWEEP2WAKE
 #include <linux/ctype.h>
@@ -50,6 +54,10 @@
 #define SHIFT_BITS 10
 #define SYN_WIRELESS_DEBUG
 #define SYN_CALIBRATION_CONTROL
+#define SYN_MAX_FINGER 10
+#define SYN_FINGER_DATA_SIZE 8
+#define SYN_BLOCK_READ_SIZE 128
+#define SYN_LATENCY_BUCKETS 16
 
 #define SYN_FW_NAME "tp_SYN.img"
 #define SYN_FW_TIMEOUT (30000)
@@ -142,6 +150,17 @@ struct synaptics_ts_data {
 	struct synaptics_virtual_key *button;
 	wait_queue_head_t syn_fw_wait;
 	atomic_t syn_fw_condition;
+	uint8_t block_buf[SYN_BLOCK_READ_SIZE];
+	uint16_t block_addr;
+	uint8_t block_len;
+	uint8_t finger_offset;
+	uint8_t noise_index[10];
+	ktime_t irq_time;
+	uint32_t latency_hist[SYN_LATENCY_BUCKETS];
+	uint32_t latency_count;
+	uint32_t latency_max;
+	uint64_t latency_sum;
+	struct dentry *debugfs_dir;
 };
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
@@ -160,7 +179,9 @@ static int i2c_syn_write_byte_data(struct i2c_client *client, uint16_t addr, uin
 static int syn_pdt_scan(struct synaptics_ts_data *ts, int num_page);
 static int synaptics_init_panel(struct synaptics_ts_data *ts);
 
+static irqreturn_t synaptics_irq_handler(int irq, void *ptr);
 static irqreturn_t synaptics_irq_thread(int irq, void *ptr);
+static void synaptics_ts_setup_block_read(struct synaptics_ts_data *ts);
 
 extern unsigned int get_tamper_sf(void);
 
@@ -1912,7 +1933,7 @@ static ssize_t syn_int_status_store(struct device *dev,
 		return -EINVAL;
 
 	if (value) {
-		ret = request_threaded_irq(ts->client->irq, NULL, synaptics_irq_thread,
+		ret = request_threaded_irq(ts->client->irq, synaptics_irq_handler, synaptics_irq_thread,
 			IRQF_TRIGGER_LOW | IRQF_ONESHOT, ts->client->name, ts);
 		if (ret == 0) {
 			ts->irq_enabled = 1;
@@ -2457,6 +2478,7 @@ static int synaptics_init_panel(struct synaptics_ts_data *ts)
 {
 	int ret = 0;
 
+	synaptics_ts_setup_block_read(ts);
 	
 	ret = i2c_syn_write_byte_data(ts->client,
 			get_address_base(ts, 0x01, CONTROL_BASE), 0x80);
@@ -2675,38 +2697,229 @@ static void synaptics_ts_s2w_check_wake(void)
 		}
 }
 
+static void synaptics_ts_release_gesture(int release_x, int release_y)
+{
+	int report_ret;
+
+	printk(KERN_INFO "[home2wake/S2W]: Finger released, reseting vars. Last post %d %d\n", release_x, release_y);
+	if (s2w_switch > 0 && scr_suspended == true)
+	{
+		if (release_y > 2750)
+		{
+			synaptics_ts_s2w_check_wake();
+			s2w_back_swept_time = 0;
+			s2w_home_swept_time = 0;
+		}
+	} else
+	if (!between_screen_off_from_longtap_and_touch_release && dt2w_switch > 0 && scr_suspended == true) {
+		// not a release after screen switching off, doubletap2wake is on, and screen is off, check dt2wake
+		check_doubletapwake(release_x,release_y);
+	} else
+	{
+		between_screen_off_from_longtap_and_touch_release = 0; // touch released after screen off from long tap, set variable to 0 (false)
+		report_ret = report_htc_logo_area(release_x,release_y);
+		// reseting logo_press_state, so long press count in report_htc_logo_area start again
+		logo_press_state = 0;
+		if (report_ret)
+		{
+			// printk(KERN_INFO "[sweep2wake]: POWER ON/OFF.\n");
+			if (scr_suspended == false)
+			{
+				if (l2m_switch > 0) // logo2menu active
+				{
+					if (report_ret == 3)
+					{
+						// long press logo, power off
+						// OFF
+						//sweep2wake_pwrtrigger(); // commented - long tap time count worker used instead
+					} else
+					{
+						if ((l2m_2_phase == 1 || !is_wake_option_set()) && menu_pressed == 1) // two phase menu input sync (or no longtap menu sleep == no wake set), and was pressed, trigger menu 0
+						{
+							// MENU
+							sweep2wake_menutrigger();
+						} else
+						if (l2m_2_phase == 0) // no two phase menu input sync, just trigger menu
+						{
+							// MENU
+							sweep2wake_menutrigger();
+						}
+					}
+				} else
+				{
+					// no logo2menu branch...
+					if (h2w_switch >= 2)
+					{ //  logo to wake (h2w_switch 3) or at least logo to sleep (h2w_switch 2) enabled. screen is on, switch it off
+						if (report_ret >= 2 && logo_delay_switch == 0) // 2 or 3 = enough time passed for non-accidental tap and logo delay is off
+						{
+							// OFF
+							sweep2wake_pwrtrigger();
+						}
+					}
+				}
+			} else
+			{
+				if (h2w_switch == 3)
+				{ // logo to wake enabled. screen is off, switch it on
+					if (report_ret >= 2 && logo_delay_switch == 0) // 2 or 3 = enough time passed for non-accidental tap, power on
+					{
+						// ON
+						sweep2wake_pwrtrigger();
+					}
+				}
+			}
+		}
+	}
+}
+
 #endif
-static void synaptics_ts_finger_func(struct synaptics_ts_data *ts)
+
+static void synaptics_ts_setup_block_read(struct synaptics_ts_data *ts)
+{
+	int status, finger, len;
+
+	status = get_address_base(ts, 0x01, DATA_BASE) + 1;
+	if (ts->package_id < 3400)
+		finger = status + 1;
+	else
+		finger = get_address_base(ts, ts->finger_func_idx, DATA_BASE);
+	len = ts->finger_support * SYN_FINGER_DATA_SIZE;
+
+	ts->block_len = 0;
+	if (finger <= status || (finger >> 8) != (status >> 8) ||
+		finger - status + len > SYN_BLOCK_READ_SIZE) {
+		printk(KERN_INFO "[TP] %s: finger data at %x not adjacent to status %x\n",
+			__func__, finger, status);
+		return;
+	}
+	ts->block_addr = status;
+	ts->finger_offset = finger - status;
+	ts->block_len = ts->finger_offset + len;
+}
+
+static void synaptics_ts_noise_func(struct synaptics_ts_data *ts)
 {
 	int ret;
-	uint8_t buf[ts->finger_support * 8 ], noise_index[10], noise_state = 0;
+	uint8_t noise_state = 0;
+
+	ret = i2c_syn_read(ts->client,
+		get_address_base(ts, 0x54, DATA_BASE) + 8, &noise_state, 1);
+	if (ret < 0)
+		return;
+	if (noise_state == 2) {
+		ret = i2c_syn_read(ts->client,
+			get_address_base(ts, 0x54, DATA_BASE) + 4, ts->noise_index, sizeof(ts->noise_index));
+		ts->debug_log_level |= BIT(17);
+	} else {
+		memset(ts->noise_index, 0x0, sizeof(ts->noise_index));
+		if (!ts->enable_noise_log)
+			ts->debug_log_level &= ~BIT(17);
+	}
+}
+
+static void synaptics_ts_latency_record(struct synaptics_ts_data *ts)
+{
+	uint32_t us;
+	int idx;
+
+	us = ktime_us_delta(ktime_get(), ts->irq_time);
+	idx = fls(us);
+	if (idx >= SYN_LATENCY_BUCKETS)
+		idx = SYN_LATENCY_BUCKETS - 1;
+
+	ts->latency_hist[idx]++;
+	ts->latency_count++;
+	ts->latency_sum += us;
+	if (us > ts->latency_max)
+		ts->latency_max = us;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int synaptics_latency_show(struct seq_file *s, void *unused)
+{
+	struct synaptics_ts_data *ts = s->private;
+	int i;
+
+	seq_printf(s, "count %u\n", ts->latency_count);
+	seq_printf(s, "avg_us %llu\n", ts->latency_count ?
+		div_u64(ts->latency_sum, ts->latency_count) : 0);
+	seq_printf(s, "max_us %u\n", ts->latency_max);
+	for (i = 0; i < SYN_LATENCY_BUCKETS; i++)
+		seq_printf(s, "<%u us: %u\n", 1U << i, ts->latency_hist[i]);
+
+	return 0;
+}
+
+static int synaptics_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, synaptics_latency_show, inode->i_private);
+}
+
+static ssize_t synaptics_latency_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct synaptics_ts_data *ts = ((struct seq_file *)file->private_data)->private;
+
+	memset(ts->latency_hist, 0, sizeof(ts->latency_hist));
+	ts->latency_count = 0;
+	ts->latency_max = 0;
+	ts->latency_sum = 0;
+
+	return count;
+}
+
+static const struct file_operations synaptics_latency_fops = {
+	.open		= synaptics_latency_open,
+	.read		= seq_read,
+	.write		= synaptics_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void synaptics_ts_debugfs_init(struct synaptics_ts_data *ts)
+{
+	ts->debugfs_dir = debugfs_create_dir("synaptics_3200", NULL);
+	if (IS_ERR_OR_NULL(ts->debugfs_dir)) {
+		ts->debugfs_dir = NULL;
+		return;
+	}
+	debugfs_create_file("touch_latency", S_IRUGO | S_IWUSR, ts->debugfs_dir,
+		ts, &synaptics_latency_fops);
+}
+
+static void synaptics_ts_debugfs_remove(struct synaptics_ts_data *ts)
+{
+	debugfs_remove_recursive(ts->debugfs_dir);
+}
+#else
+static void synaptics_ts_debugfs_init(struct synaptics_ts_data *ts) {}
+static void synaptics_ts_debugfs_remove(struct synaptics_ts_data *ts) {}
+#endif
+
+static void synaptics_ts_finger_func(struct synaptics_ts_data *ts, uint8_t *buf)
+{
+	int ret = 0;
+	int len = ts->finger_support * SYN_FINGER_DATA_SIZE;
+	uint8_t *noise_index = ts->noise_index;
 	static int x_pos[10] = {0}, y_pos[10] = {0};
 #ifdef CONFIG_TOUCHSCREEN_SYNAPTICS_SWEEP2WAKE
 	int report_ret = 0;
+	int release_gesture = 0;
+	int release_x = 0, release_y = 0;
 	int ts_is_on = 0;
 	ts_is_on = touchscreen_is_on() ? 1:0;
 	if (!is_wake_option_set()) ts_is_on = 1; // this line is to avoid setting -10/-10 for coordinates, when wake option is not set, so we shouldn't modify coordinates
 	// should help with ScreenStandby root app
 #endif
 
-	memset(buf, 0x0, sizeof(buf));
-	memset(noise_index, 0x0, sizeof(noise_index));
-	if (ts->package_id < 3400)
-		ret = i2c_syn_read(ts->client,
-			get_address_base(ts, 0x01, DATA_BASE) + 2, buf, sizeof(buf));
-	else {
-		ret = i2c_syn_read(ts->client,
-			get_address_base(ts, ts->finger_func_idx, DATA_BASE), buf, sizeof(buf));
-		ret = i2c_syn_read(ts->client,
-			get_address_base(ts, 0x54, DATA_BASE) + 8, &noise_state, 1);
-		if (noise_state == 2) {
+	if (!buf) {
+		buf = ts->block_buf;
+		if (ts->package_id < 3400)
 			ret = i2c_syn_read(ts->client,
-				get_address_base(ts, 0x54, DATA_BASE) + 4, noise_index, sizeof(noise_index));
-			ts->debug_log_level |= BIT(17);
-		} else {
-			if (!ts->enable_noise_log)
-				ts->debug_log_level &= ~BIT(17);
-		}
+				get_address_base(ts, 0x01, DATA_BASE) + 2, buf, len);
+		else
+			ret = i2c_syn_read(ts->client,
+				get_address_base(ts, ts->finger_func_idx, DATA_BASE), buf, len);
 	}
 	if (ret < 0) {
 		i2c_syn_error_handler(ts, ts->i2c_err_handler_en, "r:1", __func__);
@@ -2721,7 +2934,7 @@ static void synaptics_ts_finger_func(struct synaptics_ts_data *ts)
 		ts->finger_count = 0;
 		if (ts->debug_log_level & BIT(0)) {
 			printk(KERN_INFO "[TP] Touch:");
-			for (i = 0; i < sizeof(buf); i++)
+			for (i = 0; i < len; i++)
 				printk(KERN_INFO " %2x", buf[i]);
 			printk(KERN_INFO "\n");
 		}
@@ -2755,6 +2968,8 @@ static void synaptics_ts_finger_func(struct synaptics_ts_data *ts)
 			finger_press_changed &= finger_pressed;
 			ts->finger_pressed = finger_pressed;
 		}
+		if (finger_press_changed)
+			touch_boost_notify(TOUCH_BOOST_FINGER_DOWN);
 
 		if(ts->debug_log_level & BIT(3)) {
 			for(i = 0; i < ts->finger_support; i++) {
@@ -2853,77 +3068,9 @@ static void synaptics_ts_finger_func(struct synaptics_ts_data *ts)
 				break_longtap_count = 1;
 				// released, should allow logo long tap counting again...
 				allow_longtap_count = 1;
-				printk(KERN_INFO "[home2wake/S2W]: Finger released, reseting vars. Last post %d %d\n",last_touch_position_x, last_touch_position_y);
-				{
-				    if (s2w_switch > 0 && scr_suspended == true)
-				    {
-					if (last_touch_position_y > 2750)
-					{
-						synaptics_ts_s2w_check_wake();
-						s2w_back_swept_time = 0;
-						s2w_home_swept_time = 0;
-					}
-				    } else
-				    if (!between_screen_off_from_longtap_and_touch_release && dt2w_switch > 0 && scr_suspended == true) {
-					// not a release after screen switching off, doubletap2wake is on, and screen is off, check dt2wake
-					check_doubletapwake(last_touch_position_x,last_touch_position_y);
-				    } else
-				    {
-				    between_screen_off_from_longtap_and_touch_release = 0; // touch released after screen off from long tap, set variable to 0 (false)
-				    report_ret = report_htc_logo_area(last_touch_position_x,last_touch_position_y);
-				    // reseting logo_press_state, so long press count in report_htc_logo_area start again 
-				    logo_press_state = 0;
-				    if (report_ret)
-				    {
-						// printk(KERN_INFO "[sweep2wake]: POWER ON/OFF.\n");
-						if (scr_suspended == false)
-						{
-							if (l2m_switch > 0) // logo2menu active
-							{
-								if (report_ret == 3)
-								{
-									// long press logo, power off
-									// OFF
-									//sweep2wake_pwrtrigger(); // commented - long tap time count worker used instead
-								} else
-								{
-									if ((l2m_2_phase == 1 || !is_wake_option_set()) && menu_pressed == 1) // two phase menu input sync (or no longtap menu sleep == no wake set), and was pressed, trigger menu 0
-									{
-										// MENU
-										sweep2wake_menutrigger();
-									} else
-									if (l2m_2_phase == 0) // no two phase menu input sync, just trigger menu
-									{
-										// MENU
-										sweep2wake_menutrigger();
-									}
-								}
-							} else
-							{
-								// no logo2menu branch...
-								if (h2w_switch >= 2)
-								{ //  logo to wake (h2w_switch 3) or at least logo to sleep (h2w_switch 2) enabled. screen is on, switch it off
-									if (report_ret >= 2 && logo_delay_switch == 0) // 2 or 3 = enough time passed for non-accidental tap and logo delay is off
-									{
-										// OFF
-										sweep2wake_pwrtrigger();
-									}
-								}
-							}
-						} else
-						{
-							if (h2w_switch == 3)
-							{ // logo to wake enabled. screen is off, switch it on
-								if (report_ret >= 2 && logo_delay_switch == 0) // 2 or 3 = enough time passed for non-accidental tap, power on
-								{
-									// ON
-									sweep2wake_pwrtrigger();
-								}
-							}
-						}
-				    }
-				    }
-				}
+				release_x = last_touch_position_x;
+				release_y = last_touch_position_y;
+				release_gesture = 1;
 			}
 #endif
 		}
@@ -3381,7 +3528,14 @@ static void synaptics_ts_finger_func(struct synaptics_ts_data *ts)
 		}
 	}
 	input_sync(ts->input_dev);
-
+	if (ts->use_irq)
+		synaptics_ts_latency_record(ts);
+#ifdef CONFIG_TOUCHSCREEN_SYNAPTICS_SWEEP2WAKE
+	if (release_gesture)
+		synaptics_ts_release_gesture(release_x, release_y);
+#endif
+	if (ts->package_id >= 3400)
+		synaptics_ts_noise_func(ts);
 }
 
 static void synaptics_ts_report_func(struct synaptics_ts_data *ts)
@@ -3693,7 +3847,7 @@ static void synaptics_ts_work_func(struct work_struct *work)
 		i2c_syn_error_handler(ts, ts->i2c_err_handler_en, "r", __func__);
 	} else {
 		if (buf & get_address_base(ts, ts->finger_func_idx, INTR_SOURCE))
-			synaptics_ts_finger_func(ts);
+			synaptics_ts_finger_func(ts, NULL);
 		if (buf & get_address_base(ts, 0x01, INTR_SOURCE))
 			synaptics_ts_status_func(ts);
 		if (buf & get_address_base(ts, 0x54, INTR_SOURCE))
@@ -3702,18 +3856,31 @@ static void synaptics_ts_work_func(struct work_struct *work)
 
 }
 
+static irqreturn_t synaptics_irq_handler(int irq, void *ptr)
+{
+	struct synaptics_ts_data *ts = ptr;
+
+	ts->irq_time = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t synaptics_irq_thread(int irq, void *ptr)
 {
 	struct synaptics_ts_data *ts = ptr;
 	int ret;
-	uint8_t buf = 0;
+	uint8_t buf = 0, *finger = NULL;
 	struct timespec timeStart, timeEnd, timeDelta;
 
 	if (ts->debug_log_level & BIT(2)) {
 			getnstimeofday(&timeStart);
 	}
 
-	ret = i2c_syn_read(ts->client, get_address_base(ts, 0x01, DATA_BASE) + 1, &buf, 1);
+	if (ts->block_len) {
+		ret = i2c_syn_read(ts->client, ts->block_addr, ts->block_buf, ts->block_len);
+		buf = ts->block_buf[0];
+		finger = ts->block_buf + ts->finger_offset;
+	} else
+		ret = i2c_syn_read(ts->client, get_address_base(ts, 0x01, DATA_BASE) + 1, &buf, 1);
 
 	if (ret < 0) {
 		i2c_syn_error_handler(ts, ts->i2c_err_handler_en, "r", __func__);
@@ -3734,7 +3901,7 @@ static irqreturn_t synaptics_irq_thread(int irq, void *ptr)
 		}
 		if (buf & get_address_base(ts, ts->finger_func_idx, INTR_SOURCE)) {
 			if (!vk_press) {
-				synaptics_ts_finger_func(ts);
+				synaptics_ts_finger_func(ts, finger);
 				if(ts->debug_log_level & BIT(2)) {
 					getnstimeofday(&timeEnd);
 					timeDelta.tv_nsec = (timeEnd.tv_sec*1000000000+timeEnd.tv_nsec)
@@ -3979,6 +4146,8 @@ static int syn_get_information(struct synaptics_ts_data *ts)
 			return i2c_syn_error_handler(ts, ts->i2c_err_handler_en, "r:1", __func__);
 		ts->finger_support = data[1];
 	}
+	if (ts->finger_support > SYN_MAX_FINGER)
+		ts->finger_support = SYN_MAX_FINGER;
 
 	printk(KERN_INFO "[TP] %s: finger_support: %d\n", __func__, ts->finger_support);
 
@@ -4377,7 +4546,7 @@ static int syn_probe_init(void *arg)
 	ts->irq_enabled = 0;
 	if (ts->client->irq) {
 		ts->use_irq = 1;
-		ret = request_threaded_irq(ts->client->irq, NULL, synaptics_irq_thread,
+		ret = request_threaded_irq(ts->client->irq, synaptics_irq_handler, synaptics_irq_thread,
 			IRQF_TRIGGER_LOW | IRQF_ONESHOT, ts->client->name, ts);
 		if (ret == 0) {
 			ts->irq_enabled = 1;
@@ -4432,6 +4601,8 @@ static int syn_probe_init(void *arg)
 #endif
 	register_notifier_by_psensor(&psensor_status_handler);
 	synaptics_touch_sysfs_init();
+	if (ts->use_irq)
+		synaptics_ts_debugfs_init(ts);
 #ifdef SYN_WIRELESS_DEBUG
 	if (rmi_char_dev_register())
 		printk(KERN_INFO "[TP] %s: error register char device", __func__);
@@ -4549,6 +4720,7 @@ static int synaptics_ts_remove(struct i2c_client *client)
 	input_unregister_device(ts->input_dev);
 
 	synaptics_touch_sysfs_remove();
+	synaptics_ts_debugfs_remove(ts);
 
 	if(ts->report_data != NULL)
 		kfree(ts->report_data);
@@ -1464,6 +1464,7 @@ static struct i2c_driver mpu3050_driver = {
 	.driver = {
 		   .owner = THIS_MODULE,
 		   .name = MPU_NAME,
+		   .async_domain = &device_async_sensors,
 		   },
 	.address_list = normal_i2c,
 	.shutdown = mpu_shutdown,	
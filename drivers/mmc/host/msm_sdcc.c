@@ -6949,6 +6949,7 @@ static struct platform_driver msmsdcc_driver = {
 		.name	= "msm_sdcc",
 		.pm	= &msmsdcc_dev_pm_ops,
 		.of_match_table = msmsdcc_dt_match,
+		.async_domain = &device_async_storage,
 	},
 };
 
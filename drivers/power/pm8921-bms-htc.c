@@ -34,6 +34,7 @@
 
 #ifdef CONFIG_HTC_BATT_8960
 #include "mach/htc_battery_cell.h"
+#include <mach/htc_gauge.h>
 #endif
 
 #if defined(pr_debug)
@@ -2180,6 +2181,9 @@ static irqreturn_t pm8921_bms_good_ocv_handler(int irq, void *data)
 
 	pr_debug("irq = %d triggered", irq);
 	schedule_work(&chip->calib_hkadc_work);
+#ifdef CONFIG_HTC_BATT_8960
+	htc_gauge_event_notify(HTC_GAUGE_EVENT_OCV_UPDATE);
+#endif
 	return IRQ_HANDLED;
 }
 
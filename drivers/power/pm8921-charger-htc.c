@@ -3716,6 +3716,7 @@ static irqreturn_t chgstate_irq_handler(int irq, void *data)
 
 	pr_debug("state_changed_to=%d\n", pm_chg_get_fsm_state(data));
 	bms_notify_check(chip);
+	htc_charger_event_notify(HTC_CHARGER_EVENT_STATE_CHANGE);
 
 	return IRQ_HANDLED;
 }
@@ -27,6 +27,12 @@
 #include <linux/personality.h>
 #include <linux/bitops.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/percpu.h>
 #include <linux/shmem_fs.h>
 #include <linux/ashmem.h>
 #include <asm/cacheflush.h>
@@ -42,6 +48,8 @@ struct ashmem_area {
 	size_t size;			 
 	unsigned long vm_start;		 
 	unsigned long prot_mask;	 
+	struct mutex mutex;
+	unsigned int purge_pending;
 };
 
 struct ashmem_range {
@@ -51,13 +59,40 @@ struct ashmem_range {
 	size_t pgstart;			
 	size_t pgend;			
 	unsigned int purged;		
+	unsigned int purge_pending;
+	ktime_t purge_start;
 };
 
 static LIST_HEAD(ashmem_lru_list);
 
+static LIST_HEAD(ashmem_purge_list);
+
 static unsigned long lru_count;
 
-static DEFINE_MUTEX(ashmem_mutex);
+static DEFINE_SPINLOCK(ashmem_lru_lock);
+
+struct ashmem_stats {
+	atomic_t area_contended;
+	atomic_t shrink_scans;
+	atomic_t shrink_skipped;
+	atomic_t shrink_purged;
+	atomic_t purge_ranges;
+	atomic_t purge_sync;
+	atomic_t purge_batches;
+	atomic_long_t purge_bytes;
+	atomic_long_t purge_lat_total_us;
+	unsigned long purge_lat_max_us;
+};
+
+static struct ashmem_stats ashmem_stats;
+
+/* taken on every ioctl, so kept off the shared stats cacheline */
+static DEFINE_PER_CPU(unsigned long, ashmem_area_locks);
+
+static struct workqueue_struct *ashmem_purge_wq;
+
+static void ashmem_purge_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ashmem_purge_dwork, ashmem_purge_work);
 
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
@@ -86,16 +121,39 @@ static struct kmem_cache *ashmem_range_cachep __read_mostly;
 
 #define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
 
+static inline void ashmem_area_lock(struct ashmem_area *asma)
+{
+	this_cpu_inc(ashmem_area_locks);
+	if (!mutex_trylock(&asma->mutex)) {
+		atomic_inc(&ashmem_stats.area_contended);
+		mutex_lock(&asma->mutex);
+	}
+}
+
+static inline void ashmem_area_unlock(struct ashmem_area *asma)
+{
+	mutex_unlock(&asma->mutex);
+}
+
+static inline void __lru_del(struct ashmem_range *range)
+{
+	list_del(&range->lru);
+	lru_count -= range_size(range);
+}
+
 static inline void lru_add(struct ashmem_range *range)
 {
+	spin_lock(&ashmem_lru_lock);
 	list_add_tail(&range->lru, &ashmem_lru_list);
 	lru_count += range_size(range);
+	spin_unlock(&ashmem_lru_lock);
 }
 
 static inline void lru_del(struct ashmem_range *range)
 {
-	list_del(&range->lru);
-	lru_count -= range_size(range);
+	spin_lock(&ashmem_lru_lock);
+	__lru_del(range);
+	spin_unlock(&ashmem_lru_lock);
 }
 
 static int range_alloc(struct ashmem_area *asma,
@@ -138,11 +196,96 @@ static inline void range_shrink(struct ashmem_range *range,
 {
 	size_t pre = range_size(range);
 
-	range->pgstart = start;
-	range->pgend = end;
-
-	if (range_on_lru(range))
+	if (range_on_lru(range)) {
+		spin_lock(&ashmem_lru_lock);
+		range->pgstart = start;
+		range->pgend = end;
 		lru_count -= pre - range_size(range);
+		spin_unlock(&ashmem_lru_lock);
+	} else {
+		range->pgstart = start;
+		range->pgend = end;
+	}
+}
+
+static void range_purge(struct ashmem_range *range)
+{
+	struct ashmem_area *asma = range->asma;
+	struct inode *inode = asma->file->f_dentry->d_inode;
+	loff_t start = range->pgstart * PAGE_SIZE;
+	loff_t end = (range->pgend + 1) * PAGE_SIZE - 1;
+	unsigned long lat;
+
+	vmtruncate_range(inode, start, end);
+
+	range->purge_pending = 0;
+	asma->purge_pending--;
+
+	lat = ktime_to_us(ktime_sub(ktime_get(), range->purge_start));
+	atomic_inc(&ashmem_stats.purge_ranges);
+	atomic_long_add(range_size(range) * PAGE_SIZE,
+			&ashmem_stats.purge_bytes);
+	atomic_long_add(lat, &ashmem_stats.purge_lat_total_us);
+	if (lat > ashmem_stats.purge_lat_max_us)
+		ashmem_stats.purge_lat_max_us = lat;
+}
+
+static void ashmem_purge_area(struct ashmem_area *asma)
+{
+	struct ashmem_range *range;
+
+	list_for_each_entry(range, &asma->unpinned_list, unpinned) {
+		if (!asma->purge_pending)
+			break;
+		if (!range->purge_pending)
+			continue;
+
+		spin_lock(&ashmem_lru_lock);
+		list_del(&range->lru);
+		spin_unlock(&ashmem_lru_lock);
+
+		range_purge(range);
+		atomic_inc(&ashmem_stats.purge_sync);
+	}
+}
+
+static void ashmem_purge_work(struct work_struct *work)
+{
+	struct ashmem_range *range;
+	struct ashmem_area *asma;
+	LIST_HEAD(busy);
+	unsigned int batch = 0;
+	bool requeue;
+
+	spin_lock(&ashmem_lru_lock);
+	while (!list_empty(&ashmem_purge_list)) {
+		range = list_first_entry(&ashmem_purge_list,
+					 struct ashmem_range, lru);
+		asma = range->asma;
+
+		
+		if (!mutex_trylock(&asma->mutex)) {
+			list_move_tail(&range->lru, &busy);
+			continue;
+		}
+
+		list_del(&range->lru);
+		spin_unlock(&ashmem_lru_lock);
+
+		range_purge(range);
+		batch++;
+
+		spin_lock(&ashmem_lru_lock);
+		mutex_unlock(&asma->mutex);
+	}
+	list_splice(&busy, &ashmem_purge_list);
+	requeue = !list_empty(&ashmem_purge_list);
+	spin_unlock(&ashmem_lru_lock);
+
+	if (batch)
+		atomic_inc(&ashmem_stats.purge_batches);
+	if (requeue)
+		queue_delayed_work(ashmem_purge_wq, &ashmem_purge_dwork, 1);
 }
 
 static int ashmem_open(struct inode *inode, struct file *file)
@@ -163,6 +306,7 @@ static int ashmem_open(struct inode *inode, struct file *file)
 	}
 
 	INIT_LIST_HEAD(&asma->unpinned_list);
+	mutex_init(&asma->mutex);
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -175,10 +319,15 @@ static int ashmem_release(struct inode *ignored, struct file *file)
 	struct ashmem_area *asma = file->private_data;
 	struct ashmem_range *range, *next;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
+	ashmem_purge_area(asma);
 	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
 		range_del(range);
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
+
+	
+	spin_lock(&ashmem_lru_lock);
+	spin_unlock(&ashmem_lru_lock);
 
 	if (asma->file)
 		fput(asma->file);
@@ -193,7 +342,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	
 	if (asma->size == 0)
@@ -212,7 +361,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	asma->file->f_pos = *pos;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
@@ -221,7 +370,7 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	struct ashmem_area *asma = file->private_data;
 	int ret;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	if (asma->size == 0) {
 		ret = -EINVAL;
@@ -241,7 +390,7 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	file->f_pos = asma->file->f_pos;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
@@ -257,7 +406,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	
 	if (unlikely(!asma->size)) {
@@ -301,13 +450,16 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	asma->vm_start = vma->vm_start;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
 static int ashmem_shrink(struct shrinker *s, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
+	struct ashmem_area *asma;
+	unsigned long budget;
+	bool queued = false;
 
 	
 	if (sc->nr_to_scan && !(sc->gfp_mask & __GFP_FS))
@@ -315,24 +467,47 @@ static int ashmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	if (!sc->nr_to_scan)
 		return lru_count;
 
-	
-	if (!mutex_trylock(&ashmem_mutex)) {
-                return -1;
-	}
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		struct inode *inode = range->asma->file->f_dentry->d_inode;
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE - 1;
+	atomic_inc(&ashmem_stats.shrink_scans);
+
+	spin_lock(&ashmem_lru_lock);
+	budget = lru_count;
+	while (budget && !list_empty(&ashmem_lru_list)) {
+		size_t size;
+
+		range = list_first_entry(&ashmem_lru_list,
+					 struct ashmem_range, lru);
+		asma = range->asma;
+		size = range_size(range);
+		budget -= min_t(unsigned long, budget, size);
 
-		vmtruncate_range(inode, start, end);
+		
+		if (!mutex_trylock(&asma->mutex)) {
+			list_move_tail(&range->lru, &ashmem_lru_list);
+			atomic_inc(&ashmem_stats.shrink_skipped);
+			continue;
+		}
+
+		__lru_del(range);
 		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+		range->purge_pending = 1;
+		range->purge_start = ktime_get();
+		asma->purge_pending++;
+		list_add_tail(&range->lru, &ashmem_purge_list);
+		mutex_unlock(&asma->mutex);
+
+		atomic_add(size, &ashmem_stats.shrink_purged);
+		queued = true;
 
-		sc->nr_to_scan -= range_size(range);
-		if (sc->nr_to_scan <= 0)
+		if (sc->nr_to_scan <= size) {
+			sc->nr_to_scan = 0;
 			break;
+		}
+		sc->nr_to_scan -= size;
 	}
-	mutex_unlock(&ashmem_mutex);
+	spin_unlock(&ashmem_lru_lock);
+
+	if (queued)
+		queue_delayed_work(ashmem_purge_wq, &ashmem_purge_dwork, 0);
 
 	return lru_count;
 }
@@ -346,7 +521,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	
 	if (unlikely((asma->prot_mask & prot) != prot)) {
@@ -361,7 +536,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 	asma->prot_mask = prot;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
@@ -369,7 +544,7 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	
 	if (unlikely(asma->file)) {
@@ -383,7 +558,7 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 	asma->name[ASHMEM_FULL_NAME_LEN-1] = '\0';
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 
 	return ret;
 }
@@ -392,7 +567,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 	if (asma->name[ASHMEM_NAME_PREFIX_LEN] != '\0') {
 		size_t len;
 
@@ -405,7 +580,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 					  sizeof(ASHMEM_NAME_DEF))))
 			ret = -EFAULT;
 	}
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 
 	return ret;
 }
@@ -523,7 +698,10 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	pgstart = pin.offset / PAGE_SIZE;
 	pgend = pgstart + (pin.len / PAGE_SIZE) - 1;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
+
+	if (cmd != ASHMEM_GET_PIN_STATUS)
+		ashmem_purge_area(asma);
 
 	switch (cmd) {
 	case ASHMEM_PIN:
@@ -537,7 +715,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 		break;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 
 	return ret;
 }
@@ -648,10 +826,12 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 	case ASHMEM_SET_SIZE:
 		ret = -EINVAL;
+		ashmem_area_lock(asma);
 		if (!asma->file) {
 			ret = 0;
 			asma->size = (size_t) arg;
 		}
+		ashmem_area_unlock(asma);
 		break;
 	case ASHMEM_GET_SIZE:
 		ret = asma->size;
@@ -677,6 +857,7 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			ret = ashmem_shrink(&ashmem_shrinker, &sc);
 			sc.nr_to_scan = ret;
 			ashmem_shrink(&ashmem_shrinker, &sc);
+			flush_delayed_work(&ashmem_purge_dwork);
 		}
 		break;
 	case ASHMEM_CACHE_FLUSH_RANGE:
@@ -746,6 +927,53 @@ void put_ashmem_file(struct file *file)
 }
 EXPORT_SYMBOL(put_ashmem_file);
 
+static int ashmem_stats_show(struct seq_file *m, void *unused)
+{
+	unsigned long area_locks = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		area_locks += per_cpu(ashmem_area_locks, cpu);
+
+	seq_printf(m, "lru_pages: %lu\n", lru_count);
+	seq_printf(m, "area_lock: %lu\n", area_locks);
+	seq_printf(m, "area_contended: %u\n",
+		   atomic_read(&ashmem_stats.area_contended));
+	seq_printf(m, "shrink_scans: %u\n",
+		   atomic_read(&ashmem_stats.shrink_scans));
+	seq_printf(m, "shrink_skipped: %u\n",
+		   atomic_read(&ashmem_stats.shrink_skipped));
+	seq_printf(m, "shrink_purged_pages: %u\n",
+		   atomic_read(&ashmem_stats.shrink_purged));
+	seq_printf(m, "purge_ranges: %u\n",
+		   atomic_read(&ashmem_stats.purge_ranges));
+	seq_printf(m, "purge_sync: %u\n",
+		   atomic_read(&ashmem_stats.purge_sync));
+	seq_printf(m, "purge_batches: %u\n",
+		   atomic_read(&ashmem_stats.purge_batches));
+	seq_printf(m, "purge_bytes: %ld\n",
+		   atomic_long_read(&ashmem_stats.purge_bytes));
+	seq_printf(m, "purge_latency_total_us: %ld\n",
+		   atomic_long_read(&ashmem_stats.purge_lat_total_us));
+	seq_printf(m, "purge_latency_max_us: %lu\n",
+		   ashmem_stats.purge_lat_max_us);
+	return 0;
+}
+
+static int ashmem_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ashmem_stats_show, NULL);
+}
+
+static const struct file_operations ashmem_stats_fops = {
+	.open = ashmem_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static struct dentry *ashmem_debugfs;
+
 static const struct file_operations ashmem_fops = {
 	.owner = THIS_MODULE,
 	.open = ashmem_open,
@@ -783,14 +1011,24 @@ static int __init ashmem_init(void)
 		return -ENOMEM;
 	}
 
+	ashmem_purge_wq = create_singlethread_workqueue("ashmem_purge");
+	if (unlikely(!ashmem_purge_wq)) {
+		printk(KERN_ERR "ashmem: failed to create workqueue\n");
+		return -ENOMEM;
+	}
+
 	ret = misc_register(&ashmem_misc);
 	if (unlikely(ret)) {
 		printk(KERN_ERR "ashmem: failed to register misc device!\n");
+		destroy_workqueue(ashmem_purge_wq);
 		return ret;
 	}
 
 	register_shrinker(&ashmem_shrinker);
 
+	ashmem_debugfs = debugfs_create_file("ashmem_stats", S_IRUGO, NULL,
+					     NULL, &ashmem_stats_fops);
+
 	printk(KERN_INFO "ashmem: initialized\n");
 
 	return 0;
@@ -800,7 +1038,10 @@ static void __exit ashmem_exit(void)
 {
 	int ret;
 
+	debugfs_remove(ashmem_debugfs);
 	unregister_shrinker(&ashmem_shrinker);
+	cancel_delayed_work_sync(&ashmem_purge_dwork);
+	destroy_workqueue(ashmem_purge_wq);
 
 	ret = misc_deregister(&ashmem_misc);
 	if (unlikely(ret))
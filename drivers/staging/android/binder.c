@@ -1467,6 +1467,15 @@ static void binder_transaction(struct binder_proc *proc,
 			return_error = BR_FAILED_REPLY;
 			goto err_invalid_target_handle;
 		}
+		if (cgroup_freezer_ipc(target_proc->tsk,
+				       tr->flags & TF_ONE_WAY)) {
+			binder_debug(BINDER_DEBUG_FAILED_TRANSACTION,
+				     "binder: %d:%d transaction to frozen "
+				     "process %d\n", proc->pid, thread->pid,
+				     target_proc->pid);
+			return_error = BR_FAILED_REPLY;
+			goto err_invalid_target_handle;
+		}
 		if (!(tr->flags & TF_ONE_WAY) && thread->transaction_stack) {
 			struct binder_transaction *tmp;
 			tmp = thread->transaction_stack;
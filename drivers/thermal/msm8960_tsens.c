@@ -158,6 +158,7 @@ struct tsens_tm_device {
 	enum platform_type		hw_type;
 	int				pm_tsens_thr_data;
 	int				pm_tsens_cntl;
+	bool				threshold_ready;
 	struct work_struct		tsens_work;
 	struct tsens_tm_device_sensor	sensor[0];
 };
@@ -167,6 +168,9 @@ static struct workqueue_struct *monitor_tsense_wq = NULL;
 struct delayed_work monitor_tsens_status_worker;
 static void monitor_tsens_status(struct work_struct *work);
 
+static DEFINE_SPINLOCK(tsens_th_lock);
+static struct tsens_threshold *tsens_th_client;
+
 static int tsens_tz_code_to_degC(int adc_code, int sensor_num)
 {
 	int degcbeforefactor, degc;
@@ -261,6 +265,98 @@ int tsens_get_temp(struct tsens_device *device, unsigned long *temp)
 }
 EXPORT_SYMBOL(tsens_get_temp);
 
+static unsigned int tsens_status_cntl_read(void)
+{
+	if (tmdev->hw_type == APQ_8064)
+		return readl_relaxed(TSENS_8064_STATUS_CNTL);
+	return readl_relaxed(TSENS_CNTL_ADDR);
+}
+
+static void tsens_status_cntl_write(unsigned int reg)
+{
+	if (tmdev->hw_type == APQ_8064)
+		writel_relaxed(reg, TSENS_8064_STATUS_CNTL);
+	else
+		writel_relaxed(reg, TSENS_CNTL_ADDR);
+}
+
+int tsens_set_threshold(struct tsens_threshold *th)
+{
+	unsigned int reg_th, reg_cntl;
+	int code;
+
+	if (!tmdev || !tmdev->threshold_ready)
+		return -ENODEV;
+
+	if (!th || !th->notify || th->sensor_num >= tmdev->tsens_num_sensor)
+		return -EINVAL;
+
+	if (th->low_degC != TSENS_THRESHOLD_OFF &&
+	    th->high_degC != TSENS_THRESHOLD_OFF &&
+	    th->low_degC >= th->high_degC)
+		return -EINVAL;
+
+	spin_lock(&tsens_th_lock);
+	if (tsens_th_client && tsens_th_client != th) {
+		spin_unlock(&tsens_th_lock);
+		return -EBUSY;
+	}
+	tsens_th_client = th;
+
+	reg_cntl = tsens_status_cntl_read();
+	reg_cntl |= TSENS_LOWER_STATUS_CLR | TSENS_UPPER_STATUS_CLR;
+	tsens_status_cntl_write(reg_cntl);
+
+	reg_th = readl_relaxed(TSENS_THRESHOLD_ADDR);
+	if (th->low_degC != TSENS_THRESHOLD_OFF) {
+		code = tsens_tz_degC_to_code(th->low_degC, th->sensor_num);
+		reg_th &= ~TSENS_THRESHOLD_LOWER_LIMIT_MASK;
+		reg_th |= code << TSENS_THRESHOLD_LOWER_LIMIT_SHIFT;
+		reg_cntl &= ~TSENS_LOWER_STATUS_CLR;
+	}
+	if (th->high_degC != TSENS_THRESHOLD_OFF) {
+		code = tsens_tz_degC_to_code(th->high_degC, th->sensor_num);
+		reg_th &= ~TSENS_THRESHOLD_UPPER_LIMIT_MASK;
+		reg_th |= code << TSENS_THRESHOLD_UPPER_LIMIT_SHIFT;
+		reg_cntl &= ~TSENS_UPPER_STATUS_CLR;
+	}
+	writel_relaxed(reg_th, TSENS_THRESHOLD_ADDR);
+	tsens_status_cntl_write(reg_cntl);
+	mb();
+	spin_unlock(&tsens_th_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(tsens_set_threshold);
+
+void tsens_cancel_threshold(struct tsens_threshold *th)
+{
+	bool owner;
+
+	if (!tmdev)
+		return;
+
+	spin_lock(&tsens_th_lock);
+	owner = tsens_th_client == th;
+	if (owner) {
+		tsens_th_client = NULL;
+		tsens_status_cntl_write(tsens_status_cntl_read() |
+			TSENS_LOWER_STATUS_CLR | TSENS_UPPER_STATUS_CLR);
+		mb();
+	}
+	spin_unlock(&tsens_th_lock);
+
+	if (owner && tmdev->threshold_ready)
+		flush_work_sync(&tmdev->tsens_work);
+}
+EXPORT_SYMBOL(tsens_cancel_threshold);
+
+static bool tsens_threshold_busy(int trip)
+{
+	return (trip == TSENS_TRIP_STAGE1 || trip == TSENS_TRIP_STAGE2) &&
+		tsens_th_client;
+}
+
 static int tsens_tz_get_mode(struct thermal_zone_device *thermal,
 			      enum thermal_device_mode *mode)
 {
@@ -368,6 +464,9 @@ static int tsens_tz_activate_trip_type(struct thermal_zone_device *thermal,
 	if (!tm_sensor || trip < 0)
 		return -EINVAL;
 
+	if (tsens_threshold_busy(trip))
+		return -EBUSY;
+
 	lo_code = TSENS_THRESHOLD_MIN_CODE;
 	hi_code = TSENS_THRESHOLD_MAX_CODE;
 
@@ -522,6 +621,9 @@ static int tsens_tz_set_trip_temp(struct thermal_zone_device *thermal,
 	if (!tm_sensor || trip < 0)
 		return -EINVAL;
 
+	if (tsens_threshold_busy(trip))
+		return -EBUSY;
+
 	lo_code = TSENS_THRESHOLD_MIN_CODE;
 	hi_code = TSENS_THRESHOLD_MAX_CODE;
 
@@ -675,9 +777,12 @@ static void tsens_scheduler_fn(struct work_struct *work)
 					tsens_work);
 	unsigned int threshold, threshold_low, i, code, reg, sensor, mask;
 	unsigned int sensor_addr;
-	bool upper_th_x, lower_th_x;
+	bool upper_th_x, lower_th_x, crossed = false;
+	struct tsens_threshold *th;
+	unsigned long temp;
 	int adc_code;
 
+	spin_lock(&tsens_th_lock);
 	if (tmdev->hw_type == APQ_8064) {
 		reg = readl_relaxed(TSENS_8064_STATUS_CNTL);
 		writel_relaxed(reg | TSENS_LOWER_STATUS_CLR |
@@ -716,7 +821,7 @@ static void tsens_scheduler_fn(struct work_struct *work)
 			if (lower_th_x)
 				mask |= TSENS_LOWER_STATUS_CLR;
 			if (upper_th_x || lower_th_x) {
-				
+				crossed = true;
 				schedule_work(&tm->sensor[i].work);
 				adc_code = readl_relaxed(sensor_addr);
 				pr_debug("Trigger (%d degrees) for sensor %d\n",
@@ -731,6 +836,13 @@ static void tsens_scheduler_fn(struct work_struct *work)
 	else
 	writel_relaxed(reg & mask, TSENS_CNTL_ADDR);
 	mb();
+	th = tsens_th_client;
+	spin_unlock(&tsens_th_lock);
+
+	if (th && crossed) {
+		tsens8960_get_temp(th->sensor_num, &temp);
+		th->notify(th, temp);
+	}
 }
 
 static irqreturn_t tsens_isr(int irq, void *data)
@@ -1107,6 +1219,7 @@ static int __devinit tsens_tm_probe(struct platform_device *pdev)
 		goto fail;
 	}
 	INIT_WORK(&tmdev->tsens_work, tsens_scheduler_fn);
+	tmdev->threshold_ready = true;
 
 	pr_debug("%s: OK\n", __func__);
 	mb();
@@ -1123,9 +1236,11 @@ static int __devexit tsens_tm_remove(struct platform_device *pdev)
 {
 	int i;
 
+	tmdev->threshold_ready = false;
 	tsens_disable_mode();
 	mb();
 	free_irq(TSENS_UPPER_LOWER_INT, tmdev);
+	cancel_work_sync(&tmdev->tsens_work);
 	for (i = 0; i < tmdev->tsens_num_sensor; i++)
 		thermal_zone_device_unregister(tmdev->sensor[i].tz_dev);
 	kfree(tmdev);
@@ -15,19 +15,68 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
-#include <linux/msm_tsens.h>
 #include <linux/workqueue.h>
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
+#include <linux/jiffies.h>
+#include <linux/suspend.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/msm_tsens.h>
 #include <linux/msm_thermal.h>
 #include <mach/cpufreq.h>
 #include <mach/perflock.h>
 
+#define MSM_THERMAL_MAX_FREQS	32
+#define SLOPE_WEIGHT		4
+
+struct cpu_thermal {
+	int			sensor;
+	bool			sampled;
+	long			temp_mC;
+	long			slope;
+	unsigned long		sample_jiffies;
+
+	unsigned int		freqs[MSM_THERMAL_MAX_FREQS];
+	int			nr_freqs;
+	int			cap_idx;
+	unsigned long		cap_jiffies;
+	u64			cap_ms[MSM_THERMAL_MAX_FREQS];
+	unsigned int		cap_changes;
+};
+
+struct msm_thermal_stats {
+	unsigned int		irq_wakeups;
+	unsigned int		spurious_wakeups;
+	unsigned int		polls;
+	unsigned int		arm_failures;
+};
+
 static int enabled;
+static bool tracking;
 static struct msm_thermal_data msm_thermal_info;
-static uint32_t limited_max_freq = MSM_CPUFREQ_NO_LIMIT;
 static struct delayed_work check_temp_work;
+static DEFINE_MUTEX(msm_thermal_mutex);
+static DEFINE_PER_CPU(struct cpu_thermal, cpu_thermal);
+static struct msm_thermal_stats msm_thermal_stats;
+static struct tsens_threshold msm_thermal_th;
+static bool th_fired;
+
+static int watch_band_degC = 5;
+module_param(watch_band_degC, int, 0644);
+MODULE_PARM_DESC(watch_band_degC, "poll only within this many degC of the limit");
+
+static int predict_ms = 2000;
+module_param(predict_ms, int, 0644);
+MODULE_PARM_DESC(predict_ms, "how far ahead the temperature slope is projected");
+
+static int step_mdegC = 1000;
+module_param(step_mdegC, int, 0644);
+MODULE_PARM_DESC(step_mdegC, "projected overshoot per frequency step taken");
+
+static int cpu_sensor[NR_CPUS] = { [0 ... NR_CPUS - 1] = -1 };
+module_param_array(cpu_sensor, int, NULL, 0644);
+MODULE_PARM_DESC(cpu_sensor, "TSENS sensor per cpu, -1 uses the board sensor");
 
 static int update_cpu_max_freq(int cpu, uint32_t max_freq)
 {
@@ -41,9 +90,8 @@ static int update_cpu_max_freq(int cpu, uint32_t max_freq)
 	if (ret)
 		return ret;
 
-	limited_max_freq = max_freq;
 	if (max_freq != MSM_CPUFREQ_NO_LIMIT)
-		pr_info("msm_thermal: Limiting cpu%d max frequency to %d\n",
+		pr_debug("msm_thermal: Limiting cpu%d max frequency to %d\n",
 				cpu, max_freq);
 	else
 		pr_info("msm_thermal: Max frequency reset for cpu%d\n", cpu);
@@ -51,62 +99,239 @@ static int update_cpu_max_freq(int cpu, uint32_t max_freq)
 	return ret;
 }
 
-static void check_temp(struct work_struct *work)
+static int load_freq_table(struct cpu_thermal *ct, int cpu)
 {
-	struct tsens_device tsens_dev;
-	unsigned long temp = 0;
-	uint32_t max_freq = limited_max_freq;
-	int cpu = 0;
-	int ret = 0;
+	struct cpufreq_frequency_table *table;
+	int i;
+
+	table = cpufreq_frequency_get_table(cpu);
+	if (!table)
+		return -EAGAIN;
+
+	ct->nr_freqs = 0;
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		if (table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+		if (ct->nr_freqs == MSM_THERMAL_MAX_FREQS)
+			break;
+		ct->freqs[ct->nr_freqs++] = table[i].frequency;
+	}
+
+	return ct->nr_freqs ? 0 : -EINVAL;
+}
+
+static void apply_cpu_cap(struct cpu_thermal *ct, int cpu, int idx)
+{
+	unsigned long now = jiffies;
+	int ret;
+
+	if (idx == ct->cap_idx)
+		return;
+
+	ret = update_cpu_max_freq(cpu, idx < 0 ? MSM_CPUFREQ_NO_LIMIT :
+					ct->freqs[idx]);
+	if (ret)
+		pr_debug("Unable to limit cpu%d max freq to %d\n", cpu,
+				idx < 0 ? MSM_CPUFREQ_NO_LIMIT : ct->freqs[idx]);
+
+	if (ct->cap_idx >= 0)
+		ct->cap_ms[ct->cap_idx] +=
+			jiffies_to_msecs(now - ct->cap_jiffies);
+	ct->cap_idx = idx;
+	ct->cap_jiffies = now;
+	ct->cap_changes++;
+}
 
-	tsens_dev.sensor_num = msm_thermal_info.sensor_id;
-	ret = tsens_get_temp(&tsens_dev, &temp);
+static int sample_cpu(struct cpu_thermal *ct, int cpu, unsigned long now)
+{
+	unsigned long temp;
+	long temp_mC, inst;
+	unsigned int dt;
+	int sensor, ret;
+
+	sensor = cpu_sensor[cpu];
+	if (sensor < 0 || sensor >= TSENS_MAX_SENSORS)
+		sensor = msm_thermal_info.sensor_id;
+
+	ret = tsens_get_sensor_temp(sensor, &temp);
 	if (ret) {
 		pr_debug("msm_thermal: Unable to read TSENS sensor %d\n",
-				tsens_dev.sensor_num);
+				sensor);
+		return ret;
+	}
+	temp_mC = (long)temp * 1000;
+
+	dt = jiffies_to_msecs(now - ct->sample_jiffies);
+	if (!ct->sampled || ct->sensor != sensor ||
+	    dt > 4 * msm_thermal_info.poll_ms) {
+		ct->slope = 0;
+	} else if (dt) {
+		inst = (temp_mC - ct->temp_mC) * 1000 / (long)dt;
+		ct->slope += (inst - ct->slope) / SLOPE_WEIGHT;
+	}
+
+	ct->sensor = sensor;
+	ct->sampled = true;
+	ct->temp_mC = temp_mC;
+	ct->sample_jiffies = now;
+
+	return 0;
+}
+
+static void update_cpu_cap(struct cpu_thermal *ct, int cpu)
+{
+	long limit = (long)msm_thermal_info.limit_temp * 1000;
+	long hyst = (long)msm_thermal_info.temp_hysteresis * 1000;
+	long proj, overshoot;
+	int cur, floor, idx;
+
+	if (!ct->nr_freqs && load_freq_table(ct, cpu))
+		return;
+
+	proj = ct->temp_mC + ct->slope * predict_ms / 1000;
+	proj = max(proj, ct->temp_mC);
+	overshoot = proj - limit;
+
+	cur = ct->cap_idx < 0 ? ct->nr_freqs - 1 : ct->cap_idx;
+
+	floor = 0;
+	if (ct->temp_mC < limit + hyst)
+		while (floor < cur &&
+		       ct->freqs[floor] < msm_thermal_info.limit_freq)
+			floor++;
+
+	if (overshoot >= 0) {
+		idx = cur - 1 - overshoot / max(step_mdegC, 1);
+		idx = max(idx, floor);
+	} else if (ct->cap_idx >= 0 && proj < limit - hyst) {
+		idx = ct->cap_idx + 1;
+		if (idx >= ct->nr_freqs - 1)
+			idx = -1;
+	} else {
+		idx = ct->cap_idx;
+	}
+
+	apply_cpu_cap(ct, cpu, idx);
+}
+
+static int arm_threshold(int sensor, long temp_mC)
+{
+	long high = (long)msm_thermal_info.limit_temp - watch_band_degC;
+
+	if (temp_mC >= high * 1000)
+		return -ERANGE;
+
+	msm_thermal_th.sensor_num = sensor;
+	msm_thermal_th.low_degC = TSENS_THRESHOLD_OFF;
+	msm_thermal_th.high_degC = high;
+
+	return tsens_set_threshold(&msm_thermal_th);
+}
+
+static void check_temp(struct work_struct *work)
+{
+	struct cpu_thermal *ct;
+	unsigned long now = jiffies;
+	long hottest = LONG_MIN;
+	int hot_sensor = msm_thermal_info.sensor_id;
+	bool capped = false, fired;
+	int cpu;
+
+	mutex_lock(&msm_thermal_mutex);
+	if (!enabled)
+		goto out;
+
+	fired = th_fired;
+	th_fired = false;
+	msm_thermal_stats.polls++;
+
+	for_each_possible_cpu(cpu) {
+		ct = &per_cpu(cpu_thermal, cpu);
+		if (sample_cpu(ct, cpu, now))
+			continue;
+
+		if (ct->temp_mC > hottest) {
+			hottest = ct->temp_mC;
+			hot_sensor = ct->sensor;
+		}
+		update_cpu_cap(ct, cpu);
+		if (ct->cap_idx >= 0)
+			capped = true;
+	}
+
+	if (hottest == LONG_MIN)
 		goto reschedule;
-	} else
-		pr_info("msm_thermal: TSENS sensor %d (%ld C)\n",
-				tsens_dev.sensor_num, temp);
-	if (temp >= msm_thermal_info.limit_temp) {
-		max_freq = msm_thermal_info.limit_freq;
+
 #ifdef CONFIG_PERFLOCK_BOOT_LOCK
+	if (hottest >= (long)msm_thermal_info.limit_temp * 1000)
 		release_boot_lock();
 #endif
-	}
-	else if (temp <
-		msm_thermal_info.limit_temp - msm_thermal_info.temp_hysteresis)
-		max_freq = MSM_CPUFREQ_NO_LIMIT;
 
-	if (max_freq == limited_max_freq)
+	if (fired && !tracking && hottest <
+	    ((long)msm_thermal_info.limit_temp - watch_band_degC) * 1000) {
+		msm_thermal_stats.spurious_wakeups++;
 		goto reschedule;
+	}
 
-	
-	for_each_possible_cpu(cpu) {
-		ret = update_cpu_max_freq(cpu, max_freq);
-		if (ret)
-			pr_debug("Unable to limit cpu%d max freq to %d\n",
-					cpu, max_freq);
+	if (!capped) {
+		if (!arm_threshold(hot_sensor, hottest)) {
+			if (tracking)
+				pr_debug("msm_thermal: %ld mC, waiting for threshold\n",
+						hottest);
+			tracking = false;
+			goto out;
+		}
+		if (hottest < ((long)msm_thermal_info.limit_temp -
+				watch_band_degC) * 1000)
+			msm_thermal_stats.arm_failures++;
 	}
 
+	if (!tracking)
+		pr_info("msm_thermal: TSENS sensor %d (%ld C), tracking\n",
+				hot_sensor, hottest / 1000);
+	tracking = true;
+
 reschedule:
-	if (enabled)
-		schedule_delayed_work(&check_temp_work,
-				msecs_to_jiffies(msm_thermal_info.poll_ms));
+	schedule_delayed_work(&check_temp_work,
+			msecs_to_jiffies(msm_thermal_info.poll_ms));
+out:
+	mutex_unlock(&msm_thermal_mutex);
+}
+
+static void msm_thermal_notify(struct tsens_threshold *th, unsigned long temp)
+{
+	if (!enabled)
+		return;
+
+	mutex_lock(&msm_thermal_mutex);
+	th_fired = true;
+	msm_thermal_stats.irq_wakeups++;
+	mutex_unlock(&msm_thermal_mutex);
+
+	cancel_delayed_work(&check_temp_work);
+	schedule_delayed_work(&check_temp_work, 0);
 }
 
 static void disable_msm_thermal(void)
 {
 	int cpu = 0;
 
-	
+
+	cancel_delayed_work_sync(&check_temp_work);
+	tsens_cancel_threshold(&msm_thermal_th);
 	cancel_delayed_work_sync(&check_temp_work);
 	flush_scheduled_work();
 
-
+	mutex_lock(&msm_thermal_mutex);
+	tracking = false;
 	for_each_possible_cpu(cpu) {
-		update_cpu_max_freq(cpu, MSM_CPUFREQ_NO_LIMIT);
+		struct cpu_thermal *ct = &per_cpu(cpu_thermal, cpu);
+
+		if (ct->cap_idx >= 0)
+			apply_cpu_cap(ct, cpu, -1);
+		ct->sampled = false;
 	}
+	mutex_unlock(&msm_thermal_mutex);
 }
 
 static int set_enabled(const char *val, const struct kernel_param *kp)
@@ -117,7 +342,7 @@ static int set_enabled(const char *val, const struct kernel_param *kp)
 	if (!enabled)
 		disable_msm_thermal();
 	else
-		pr_info("msm_thermal: no action for enabled = %d\n", enabled);
+		schedule_delayed_work(&check_temp_work, 0);
 
 	pr_info("msm_thermal: enabled = %d\n", enabled);
 
@@ -132,16 +357,94 @@ static struct kernel_param_ops module_ops = {
 module_param_cb(enabled, &module_ops, &enabled, 0644);
 MODULE_PARM_DESC(enabled, "enforce thermal limit on cpu");
 
+static int msm_thermal_pm_notify(struct notifier_block *nb,
+				unsigned long event, void *unused)
+{
+	if (event == PM_POST_SUSPEND && enabled) {
+		cancel_delayed_work(&check_temp_work);
+		schedule_delayed_work(&check_temp_work, 0);
+	}
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block msm_thermal_pm_nb = {
+	.notifier_call = msm_thermal_pm_notify,
+};
+
+static int msm_thermal_stats_show(struct seq_file *m, void *unused)
+{
+	struct cpu_thermal *ct;
+	unsigned long now = jiffies;
+	u64 ms;
+	int cpu, i;
+
+	mutex_lock(&msm_thermal_mutex);
+	seq_printf(m, "limit %u C hysteresis %u C floor %u kHz %s\n",
+		   msm_thermal_info.limit_temp,
+		   msm_thermal_info.temp_hysteresis,
+		   msm_thermal_info.limit_freq,
+		   tracking ? "tracking" : "armed");
+	seq_printf(m, "irq_wakeups %u spurious %u polls %u arm_failures %u\n",
+		   msm_thermal_stats.irq_wakeups,
+		   msm_thermal_stats.spurious_wakeups,
+		   msm_thermal_stats.polls,
+		   msm_thermal_stats.arm_failures);
+
+	for_each_possible_cpu(cpu) {
+		ct = &per_cpu(cpu_thermal, cpu);
+		seq_printf(m, "cpu%d sensor %d temp %ld mC slope %ld mC/s "
+			   "cap %u kHz changes %u\n", cpu, ct->sensor,
+			   ct->temp_mC, ct->slope, ct->cap_idx < 0 ? 0 :
+			   ct->freqs[ct->cap_idx], ct->cap_changes);
+		for (i = 0; i < ct->nr_freqs; i++) {
+			ms = ct->cap_ms[i];
+			if (i == ct->cap_idx)
+				ms += jiffies_to_msecs(now - ct->cap_jiffies);
+			seq_printf(m, "\t%u %llu\n", ct->freqs[i], ms);
+		}
+	}
+	mutex_unlock(&msm_thermal_mutex);
+
+	return 0;
+}
+
+static int msm_thermal_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_thermal_stats_show, NULL);
+}
+
+static const struct file_operations msm_thermal_stats_fops = {
+	.open		= msm_thermal_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init msm_thermal_debugfs_init(void)
+{
+	debugfs_create_file("msm_thermal_stats", S_IRUGO, NULL, NULL,
+			    &msm_thermal_stats_fops);
+	return 0;
+}
+late_initcall(msm_thermal_debugfs_init);
+
 int __init msm_thermal_init(struct msm_thermal_data *pdata)
 {
 	int ret = 0;
+	int cpu;
 
 	BUG_ON(!pdata);
 	BUG_ON(pdata->sensor_id >= TSENS_MAX_SENSORS);
 	memcpy(&msm_thermal_info, pdata, sizeof(struct msm_thermal_data));
 
+	for_each_possible_cpu(cpu)
+		per_cpu(cpu_thermal, cpu).cap_idx = -1;
+	msm_thermal_th.notify = msm_thermal_notify;
+
 	enabled = 1;
 	INIT_DELAYED_WORK(&check_temp_work, check_temp);
+	register_pm_notifier(&msm_thermal_pm_nb);
 	schedule_delayed_work(&check_temp_work, 0);
 
 	return ret;
@@ -1083,14 +1083,31 @@ static ssize_t mtp_open_state_show(struct device *dev,
 	return sprintf(buf, "%d\n", htc_mtp_open_state);
 }
 
+static ssize_t mtp_xfer_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mtp_xfer_stats *tx = &_mtp_dev->tx_stats;
+	struct mtp_xfer_stats *rx = &_mtp_dev->rx_stats;
+
+	return sprintf(buf, "tx: count %lu last %llu bytes %lu us %lu KB/s peak %lu KB/s\n"
+			    "rx: count %lu last %llu bytes %lu us %lu KB/s peak %lu KB/s\n"
+			    "req: tx %u x %u rx %u x %u\n",
+		       tx->count, tx->bytes, tx->usecs, tx->kbps, tx->peak_kbps,
+		       rx->count, rx->bytes, rx->usecs, rx->kbps, rx->peak_kbps,
+		       _mtp_dev->tx_reqs, MTP_BULK_BUFFER_SIZE,
+		       _mtp_dev->rx_reqs, MTP_BULK_BUFFER_SIZE);
+}
+
 static DEVICE_ATTR(mtp_debug_level, S_IRUGO | S_IWUSR, mtp_debug_level_show,
 						    mtp_debug_level_store);
 static DEVICE_ATTR(iobusy, S_IRUGO, mtp_iobusy_show, NULL);
 static DEVICE_ATTR(mtp_open_state, S_IRUGO, mtp_open_state_show, NULL);
+static DEVICE_ATTR(mtp_xfer_stats, S_IRUGO, mtp_xfer_stats_show, NULL);
 static struct device_attribute *mtp_function_attributes[] = {
 	&dev_attr_mtp_debug_level,
 	&dev_attr_iobusy,
 	&dev_attr_mtp_open_state,
+	&dev_attr_mtp_xfer_stats,
 	NULL
 };
 
@@ -28,6 +28,8 @@
 #include <linux/file.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/ktime.h>
 
 #include <linux/usb.h>
 #include <linux/usb_usual.h>
@@ -48,8 +50,8 @@
 #define STATE_CANCELED              3   
 #define STATE_ERROR                 4   
 
-#define MTP_TX_REQ_MAX 4
-#define MTP_RX_REQ_MAX 8
+#define MTP_TX_REQ_MAX 8
+#define MTP_RX_REQ_MAX 16
 #define MTP_INTR_REQ_MAX 5
 
 #define MTP_OS_STRING_ID   0xEE
@@ -70,6 +72,20 @@ static int htc_mtp_open_state;
 
 static const char mtp_shortname[] = "mtp_usb";
 
+static unsigned int mtp_rx_reqs = MTP_RX_REQ_MAX;
+module_param(mtp_rx_reqs, uint, S_IRUGO | S_IWUSR);
+
+static unsigned int mtp_tx_reqs = MTP_TX_REQ_MAX;
+module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
+
+struct mtp_xfer_stats {
+	uint64_t bytes;
+	unsigned long usecs;
+	unsigned long kbps;
+	unsigned long peak_kbps;
+	unsigned long count;
+};
+
 struct mtp_dev {
 	struct usb_function function;
 	struct usb_composite_dev *cdev;
@@ -120,8 +136,11 @@ struct mtp_dev {
 	struct timer_list perf_timer;
 	unsigned long timer_expired;
 #endif
-	struct timeval st0;
-	struct timeval st1;
+	unsigned int rx_reqs;
+	unsigned int tx_reqs;
+
+	struct mtp_xfer_stats tx_stats;
+	struct mtp_xfer_stats rx_stats;
 };
 
 static struct usb_interface_descriptor mtp_interface_desc = {
@@ -515,20 +534,24 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	dev->ep_intr = ep;
 
 	
-	for (i = 0; i < MTP_TX_REQ_MAX; i++) {
+	dev->tx_reqs = max_t(unsigned, mtp_tx_reqs, 2);
+	for (i = 0; i < dev->tx_reqs; i++) {
 		req = mtp_request_new(dev->ep_in, MTP_BULK_BUFFER_SIZE);
 		if (!req)
 			goto fail;
 		req->complete = mtp_complete_in;
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
-	for (i = 0; i < MTP_RX_REQ_MAX; i++) {
+	dev->rx_reqs = max_t(unsigned, mtp_rx_reqs, 2);
+	for (i = 0; i < dev->rx_reqs; i++) {
 		req = mtp_request_new(dev->ep_out, MTP_BULK_BUFFER_SIZE);
 		if (!req)
 			goto fail;
 		req->complete = mtp_complete_out;
 		mtp_req_put(dev, &dev->rx_idle, req);
 	}
+	DBG(cdev, "%s: %u tx, %u rx requests\n", __func__,
+	    dev->tx_reqs, dev->rx_reqs);
 	for (i = 0; i < MTP_INTR_REQ_MAX; i++) {
 		req = mtp_request_new(dev->ep_intr, INTR_BUFFER_SIZE);
 		if (!req)
@@ -789,6 +812,21 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+static void mtp_xfer_stats_update(struct mtp_xfer_stats *s, uint64_t bytes,
+				  ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	if (us <= 0)
+		us = 1;
+	s->bytes = bytes;
+	s->usecs = us;
+	s->kbps = div64_u64(bytes * USEC_PER_SEC, us) >> 10;
+	if (s->kbps > s->peak_kbps)
+		s->peak_kbps = s->kbps;
+	s->count++;
+}
+
 static void send_file_work(struct work_struct *data)
 {
 	struct mtp_dev *dev = container_of(data, struct mtp_dev,
@@ -802,7 +840,9 @@ static void send_file_work(struct work_struct *data)
 	int xfer, ret, hdr_size;
 	int r = 0;
 	int sendZLP = 0;
-	long diff = 0;
+	uint64_t sent = 0;
+	unsigned long ra_pages;
+	ktime_t start;
 
 	
 	smp_rmb();
@@ -822,8 +862,14 @@ static void send_file_work(struct work_struct *data)
 	if ((count & (dev->ep_in->maxpacket - 1)) == 0)
 		sendZLP = 1;
 
-	if (htc_mtp_performance_debug)
-		do_gettimeofday(&dev->st0);
+	
+	ra_pages = (MTP_BULK_BUFFER_SIZE * dev->tx_reqs) >> PAGE_SHIFT;
+	spin_lock(&filp->f_lock);
+	if (filp->f_ra.ra_pages < ra_pages)
+		filp->f_ra.ra_pages = ra_pages;
+	spin_unlock(&filp->f_lock);
+
+	start = ktime_get();
 	while (count > 0 || sendZLP) {
 		
 		if (count == 0)
@@ -878,15 +924,16 @@ static void send_file_work(struct work_struct *data)
 		}
 
 		count -= xfer;
+		sent += xfer;
 
 		
 		req = 0;
 	}
-	if (htc_mtp_performance_debug) {
-		do_gettimeofday(&dev->st1);
-		diff = (dev->st1.tv_sec-dev->st0.tv_sec)*1000 + (dev->st1.tv_usec-dev->st0.tv_usec)/1000;
-		printk(KERN_INFO "[USB][MTP]%s, total time:%ld\n", __func__, diff);
-	}
+	mtp_xfer_stats_update(&dev->tx_stats, sent, start);
+	if (htc_mtp_performance_debug)
+		printk(KERN_INFO "[USB][MTP]%s, %llu bytes, total time:%lu ms, %lu KB/s\n",
+		       __func__, sent, dev->tx_stats.usecs / 1000,
+		       dev->tx_stats.kbps);
 
 	if (req)
 		mtp_req_put(dev, &dev->tx_idle, req);
@@ -911,7 +958,8 @@ static void receive_file_work(struct work_struct *data)
 	int64_t count;
 	int r = 0, xfer, times = 0, file_xfer_zlp_flag = 0;
 	int ret;
-	long diff = 0;
+	uint64_t received = 0;
+	ktime_t start;
 
 	
 	smp_rmb();
@@ -921,8 +969,7 @@ static void receive_file_work(struct work_struct *data)
 	dev->read_count = 0;
 
 	DBG(cdev, "receive_file_work(%lld)\n", count);
-	if (htc_mtp_performance_debug)
-		do_gettimeofday(&dev->st0);
+	start = ktime_get();
 
 	if (count == 0xFFFFFFFF)
 		file_xfer_zlp_flag = 1;
@@ -984,6 +1031,7 @@ requeue_req:
 			}
 			dev->read_buf += xfer;
 			dev->read_count -= xfer;
+			received += xfer;
 
 			if (file_xfer_zlp_flag == 0)
 				count -= xfer;
@@ -1031,11 +1079,11 @@ requeue_req:
 
 done:
 	DBG(cdev, "receive_file_work returning %d\n", r);
-	if (htc_mtp_performance_debug) {
-		do_gettimeofday(&dev->st1);
-		diff = (dev->st1.tv_sec-dev->st0.tv_sec)*1000 + (dev->st1.tv_usec-dev->st0.tv_usec)/1000;
-		INFO(cdev, "[USB][MTP]%s, total time:%ld\n", __func__, diff);
-	}
+	mtp_xfer_stats_update(&dev->rx_stats, received, start);
+	if (htc_mtp_performance_debug)
+		INFO(cdev, "[USB][MTP]%s, %llu bytes, total time:%lu ms, %lu KB/s\n",
+		     __func__, received, dev->rx_stats.usecs / 1000,
+		     dev->rx_stats.kbps);
 #ifdef CONFIG_PERFLOCK
 	mod_timer(&dev->perf_timer, MTP_TRANSFER_EXPIRED);
 #endif
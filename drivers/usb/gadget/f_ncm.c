@@ -53,9 +53,17 @@ struct f_ncm {
 	bool				is_crc;
 	int                 iCurMaxDataSize;
 
+	struct sk_buff_head		tx_pending;
+	unsigned			tx_pending_len;
+
 	spinlock_t			lock;
 };
 
+static unsigned int ncm_dl_max_pkt_per_xfer = 10;
+module_param(ncm_dl_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(ncm_dl_max_pkt_per_xfer,
+		"max datagrams packed into one IN NTB");
+
 static inline struct f_ncm *func_to_ncm(struct usb_function *f)
 {
 	return container_of(f, struct f_ncm, port.func);
@@ -402,6 +410,8 @@ static inline void ncm_reset_values(struct f_ncm *ncm)
 
 	ncm->port.fixed_out_len = le32_to_cpu(ntb_parameters_ncm.dwNtbOutMaxSize);
 	ncm->port.fixed_in_len = NTB_DEFAULT_IN_SIZE_NCM;
+	skb_queue_purge(&ncm->tx_pending);
+	ncm->tx_pending_len = 0;
 }
 
 static void ncm_do_notify(struct f_ncm *ncm)
@@ -784,6 +794,8 @@ static int ncm_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 				gadget_is_musbhdrc(cdev->gadget)
 				);
 			ncm->port.cdc_filter = DEFAULT_FILTER;
+			ncm->port.dl_max_pkts_per_xfer =
+				ncm_dl_max_pkt_per_xfer;
 			DBG(cdev, "activate ncm\n");
 			net = gether_connect(&ncm->port);
 			if (IS_ERR(net))
@@ -810,6 +822,120 @@ static int ncm_get_alt(struct usb_function *f, unsigned intf)
 	return ncm->port.in_ep->driver_data ? 1 : 0;
 }
 
+static unsigned ncm_ntb_hdr_len(struct f_ncm *ncm, unsigned n)
+{
+	struct ndp_parser_opts_ncm *opts = ncm->parser_opts;
+	int		ndp_align = le16_to_cpu(ntb_parameters_ncm.wNdpInAlignment);
+	unsigned	len;
+
+	len = ALIGN(opts->nth_size, ndp_align);
+	len += opts->ndp_size;
+	len += max_t(unsigned, n + 1, 2) * 2 * 2 * opts->dgram_item_len;
+	return len;
+}
+
+static struct sk_buff *ncm_build_ntb(struct f_ncm *ncm)
+{
+	struct ndp_parser_opts_ncm *opts = ncm->parser_opts;
+	unsigned	crc_len = ncm->is_crc ? sizeof(uint32_t) : 0;
+	int		div = le16_to_cpu(ntb_parameters_ncm.wNdpInDivisor);
+	int		rem = le16_to_cpu(ntb_parameters_ncm.wNdpInPayloadRemainder);
+	int		ndp_align = le16_to_cpu(ntb_parameters_ncm.wNdpInAlignment);
+	unsigned	n = skb_queue_len(&ncm->tx_pending);
+	unsigned	hdr_len, ndp_off, pad;
+	struct sk_buff	*ntb, *skb;
+	__le16		*tmp, *blk;
+
+	if (!n)
+		return NULL;
+
+	ntb = alloc_skb(ncm->port.fixed_in_len, GFP_ATOMIC);
+	if (!ntb) {
+		skb_queue_purge(&ncm->tx_pending);
+		ncm->tx_pending_len = 0;
+		return NULL;
+	}
+
+	hdr_len = ncm_ntb_hdr_len(ncm, n);
+	ndp_off = ALIGN(opts->nth_size, ndp_align);
+	tmp = (void *)skb_put(ntb, hdr_len);
+	memset(tmp, 0, hdr_len);
+
+	put_unaligned_le32(opts->nth_sign, tmp);
+	tmp += 2;
+	put_unaligned_le16(opts->nth_size, tmp++);
+	tmp++;
+	blk = tmp;
+	tmp += opts->block_length;
+	put_ncm(&tmp, opts->fp_index, ndp_off);
+
+	tmp = (void *)ntb->data + ndp_off;
+	put_unaligned_le32(opts->ndp_sign, tmp);
+	tmp += 2;
+	put_unaligned_le16(hdr_len - ndp_off, tmp++);
+	tmp += opts->reserved1;
+	tmp += opts->next_fp_index;
+	tmp += opts->reserved2;
+
+	while ((skb = __skb_dequeue(&ncm->tx_pending))) {
+		pad = ALIGN(ntb->len, div) + rem - ntb->len;
+		memset(skb_put(ntb, pad), 0, pad);
+
+		put_ncm(&tmp, opts->dgram_item_len, ntb->len);
+		put_ncm(&tmp, opts->dgram_item_len, skb->len + crc_len);
+
+		skb_copy_bits(skb, 0, skb_put(ntb, skb->len), skb->len);
+		if (ncm->is_crc) {
+			uint32_t crc;
+
+			crc = ~crc32_le(~0, ntb->data + ntb->len - skb->len,
+					skb->len);
+			put_unaligned_le32(crc, skb_put(ntb, crc_len));
+		}
+		dev_kfree_skb_any(skb);
+	}
+	ncm->tx_pending_len = 0;
+
+	put_ncm(&blk, opts->block_length, ntb->len);
+	GETHER_SKB_CB(ntb)->pkts = n;
+
+	return ntb;
+}
+
+static struct sk_buff *ncm_wrap_ntb_aggr(struct f_ncm *ncm,
+					 struct sk_buff *skb)
+{
+	unsigned	max_size = ncm->port.fixed_in_len;
+	unsigned	crc_len = ncm->is_crc ? sizeof(uint32_t) : 0;
+	int		div = le16_to_cpu(ntb_parameters_ncm.wNdpInDivisor);
+	int		rem = le16_to_cpu(ntb_parameters_ncm.wNdpInPayloadRemainder);
+	unsigned	dg_len, n;
+	struct sk_buff	*ntb = NULL;
+
+	if (!skb)
+		return ncm_build_ntb(ncm);
+
+	dg_len = skb->len + crc_len + div + rem;
+	if (ncm_ntb_hdr_len(ncm, 1) + dg_len > max_size) {
+		dev_kfree_skb_any(skb);
+		return NULL;
+	}
+
+	n = skb_queue_len(&ncm->tx_pending);
+	if (n && ncm_ntb_hdr_len(ncm, n + 1) + ncm->tx_pending_len +
+			dg_len > max_size)
+		ntb = ncm_build_ntb(ncm);
+
+	__skb_queue_tail(&ncm->tx_pending, skb);
+	ncm->tx_pending_len += dg_len;
+
+	if (!ntb && skb_queue_len(&ncm->tx_pending) >=
+			ncm->port.dl_max_pkts_per_xfer)
+		ntb = ncm_build_ntb(ncm);
+
+	return ntb ? ntb : ERR_PTR(-EINPROGRESS);
+}
+
 static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 				    struct sk_buff *skb)
 {
@@ -826,6 +952,9 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 	struct ndp_parser_opts_ncm *opts = ncm->parser_opts;
 	unsigned	crc_len = ncm->is_crc ? sizeof(uint32_t) : 0;
 
+	if (port->dl_max_pkts_per_xfer > 1)
+		return ncm_wrap_ntb_aggr(ncm, skb);
+
 	ncb_len += opts->nth_size;
 	ndp_pad = ALIGN(ncb_len, ndp_align) - ncb_len;
 	ncb_len += ndp_pad;
@@ -1035,6 +1164,9 @@ static void ncm_disable(struct usb_function *f)
 	if (ncm->port.in_ep->driver_data)
 		gether_disconnect(&ncm->port);
 
+	skb_queue_purge(&ncm->tx_pending);
+	ncm->tx_pending_len = 0;
+
 	if (ncm->notify->driver_data) {
 		usb_ep_disable(ncm->notify);
 		ncm->notify->driver_data = NULL;
@@ -1253,6 +1385,7 @@ int ncm_bind_config(struct usb_configuration *c, u8 ethaddr[ETH_ALEN])
 	ncm_string_defs[1].s = ncm->ethaddr;
 
 	spin_lock_init(&ncm->lock);
+	skb_queue_head_init(&ncm->tx_pending);
 	ncm_reset_values(ncm);
 	ncm->port.is_fixed = true;
 
@@ -39,8 +39,20 @@ struct f_rndis {
 	atomic_t			notify_count;
 
 	atomic_t			online;
+
+	struct sk_buff			*tx_aggr;
 };
 
+static unsigned int rndis_ul_max_pkt_per_xfer = 3;
+module_param(rndis_ul_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_ul_max_pkt_per_xfer,
+		"max RNDIS packets the host may send per OUT transfer");
+
+static unsigned int rndis_dl_max_pkt_per_xfer = 10;
+module_param(rndis_dl_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_dl_max_pkt_per_xfer,
+		"max RNDIS packets sent to the host per IN transfer");
+
 static inline struct f_rndis *func_to_rndis(struct usb_function *f)
 {
 	return container_of(f, struct f_rndis, port.func);
@@ -319,14 +331,71 @@ static struct usb_gadget_strings *rndis_strings[] = {
 static struct sk_buff *rndis_add_header(struct gether *port,
 					struct sk_buff *skb)
 {
-	struct sk_buff *skb2;
+	struct f_rndis *rndis = func_to_rndis(&port->func);
+	struct rndis_packet_msg_type *header;
+	struct sk_buff *skb2 = NULL;
+	unsigned max_size, msg_len;
+
+	if (port->dl_max_pkts_per_xfer <= 1) {
+		skb2 = skb_realloc_headroom(skb,
+				sizeof(struct rndis_packet_msg_type));
+		if (skb2)
+			rndis_add_hdr(skb2);
+
+		dev_kfree_skb_any(skb);
+		return skb2;
+	}
+
+	if (!skb) {
+		skb2 = rndis->tx_aggr;
+		rndis->tx_aggr = NULL;
+		return skb2;
+	}
+
+	max_size = port->dl_max_pkts_per_xfer *
+		(ETH_FRAME_LEN_MAX + sizeof(struct rndis_packet_msg_type));
+	if (rndis_get_dl_max_xfer_size(rndis->config))
+		max_size = min(max_size,
+			       rndis_get_dl_max_xfer_size(rndis->config));
+
+	msg_len = ALIGN(skb->len + sizeof(*header), 4);
+	if (msg_len > max_size) {
+		dev_kfree_skb_any(skb);
+		return NULL;
+	}
+
+	if (rndis->tx_aggr && rndis->tx_aggr->len + msg_len > max_size) {
+		skb2 = rndis->tx_aggr;
+		rndis->tx_aggr = NULL;
+	}
 
-	skb2 = skb_realloc_headroom(skb, sizeof(struct rndis_packet_msg_type));
-	if (skb2)
-		rndis_add_hdr(skb2);
+	if (!rndis->tx_aggr) {
+		rndis->tx_aggr = alloc_skb(max_size, GFP_ATOMIC);
+		if (!rndis->tx_aggr) {
+			dev_kfree_skb_any(skb);
+			return skb2;
+		}
+		GETHER_SKB_CB(rndis->tx_aggr)->pkts = 0;
+	}
 
+	header = (void *)skb_put(rndis->tx_aggr, msg_len);
+	memset(header, 0, sizeof(*header));
+	header->MessageType = cpu_to_le32(REMOTE_NDIS_PACKET_MSG);
+	header->MessageLength = cpu_to_le32(msg_len);
+	header->DataOffset = cpu_to_le32(36);
+	header->DataLength = cpu_to_le32(skb->len);
+	skb_copy_bits(skb, 0, header + 1, skb->len);
+	memset((void *)(header + 1) + skb->len, 0,
+	       msg_len - sizeof(*header) - skb->len);
 	dev_kfree_skb_any(skb);
-	return skb2;
+
+	if (++GETHER_SKB_CB(rndis->tx_aggr)->pkts >=
+			port->dl_max_pkts_per_xfer && !skb2) {
+		skb2 = rndis->tx_aggr;
+		rndis->tx_aggr = NULL;
+	}
+
+	return skb2 ? skb2 : ERR_PTR(-EINPROGRESS);
 }
 
 static void rndis_response_available(void *_rndis)
@@ -506,6 +575,10 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 		if (rndis->port.in_ep->driver_data) {
 			DBG(cdev, "reset rndis\n");
 			gether_disconnect(&rndis->port);
+			if (rndis->tx_aggr) {
+				dev_kfree_skb_any(rndis->tx_aggr);
+				rndis->tx_aggr = NULL;
+			}
 		}
 
 		if (!rndis->port.in_ep->desc || !rndis->port.out_ep->desc) {
@@ -525,6 +598,11 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 
 		rndis->port.cdc_filter = 0;
 
+		rndis->port.ul_max_pkts_per_xfer = rndis_ul_max_pkt_per_xfer;
+		rndis->port.dl_max_pkts_per_xfer = rndis_dl_max_pkt_per_xfer;
+		rndis_set_max_pkt_xfer(rndis->config,
+				       rndis_ul_max_pkt_per_xfer);
+
 		DBG(cdev, "RNDIS RX/TX early activation ... \n");
 		net = gether_connect(&rndis->port);
 		if (IS_ERR(net))
@@ -556,6 +634,11 @@ static void rndis_disable(struct usb_function *f)
 	rndis_uninit(rndis->config);
 	gether_disconnect(&rndis->port);
 
+	if (rndis->tx_aggr) {
+		dev_kfree_skb_any(rndis->tx_aggr);
+		rndis->tx_aggr = NULL;
+	}
+
 	usb_ep_disable(rndis->notify);
 	rndis->notify->driver_data = NULL;
 }
@@ -536,6 +536,10 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 		return -ENOMEM;
 	resp = (rndis_init_cmplt_type *)r->buf;
 
+	params->dl_max_xfer_size = le32_to_cpu(buf->MaxTransferSize);
+	if (!params->ul_max_pkt_per_xfer)
+		params->ul_max_pkt_per_xfer = 1;
+
 	resp->MessageType = cpu_to_le32(REMOTE_NDIS_INITIALIZE_CMPLT);
 	resp->MessageLength = cpu_to_le32(52);
 	resp->RequestID = buf->RequestID; 
@@ -544,12 +548,12 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = cpu_to_le32(RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32(RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32(RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32(1);
-	resp->MaxTransferSize = cpu_to_le32(
-		  params->dev->mtu
+	resp->MaxPacketsPerTransfer = cpu_to_le32(params->ul_max_pkt_per_xfer);
+	resp->MaxTransferSize = cpu_to_le32(params->ul_max_pkt_per_xfer *
+		(params->dev->mtu
 		+ sizeof(struct ethhdr)
 		+ sizeof(struct rndis_packet_msg_type)
-		+ 22);
+		+ 22));
 	resp->PacketAlignmentFactor = cpu_to_le32(0);
 	resp->AFListOffset = cpu_to_le32(0);
 	resp->AFListSize = cpu_to_le32(0);
@@ -894,6 +898,23 @@ int rndis_set_param_medium(u8 configNr, u32 medium, u32 speed)
 	return 0;
 }
 
+void rndis_set_max_pkt_xfer(u8 configNr, u32 max_pkt_per_xfer)
+{
+	pr_debug("%s: %u\n", __func__, max_pkt_per_xfer);
+	if (configNr >= RNDIS_MAX_CONFIGS)
+		return;
+
+	rndis_per_dev_params[configNr].ul_max_pkt_per_xfer = max_pkt_per_xfer;
+}
+
+u32 rndis_get_dl_max_xfer_size(u8 configNr)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS)
+		return 0;
+
+	return rndis_per_dev_params[configNr].dl_max_xfer_size;
+}
+
 void rndis_add_hdr(struct sk_buff *skb)
 {
 	struct rndis_packet_msg_type *header;
@@ -966,25 +987,58 @@ int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	
-	__le32 *tmp = (void *)skb->data;
+	int pkts = 0;
 
-	
-	if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+	while (skb->len) {
+		__le32 *tmp = (void *)skb->data;
+		struct sk_buff *skb2;
+		u32 msg_len, data_offset, data_len;
 
-	
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		
+		if (pkts && skb->len < sizeof(struct rndis_packet_msg_type))
+			break;
+
+		if (skb->len < sizeof(struct rndis_packet_msg_type) ||
+		    cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+				!= get_unaligned(tmp++)) {
+			dev_kfree_skb_any(skb);
+			return pkts ? 0 : -EINVAL;
+		}
+
+		msg_len = get_unaligned_le32(tmp++);
+		data_offset = get_unaligned_le32(tmp++);
+		data_len = get_unaligned_le32(tmp++);
+
+		if (msg_len < sizeof(struct rndis_packet_msg_type) ||
+		    msg_len > skb->len || data_offset > msg_len - 8 ||
+		    data_len > msg_len - 8 - data_offset) {
+			dev_kfree_skb_any(skb);
+			return pkts ? 0 : -EOVERFLOW;
+		}
+
+		
+		if (msg_len == skb->len) {
+			skb_pull(skb, data_offset + 8);
+			skb_trim(skb, data_len);
+			skb_queue_tail(list, skb);
+			return 0;
+		}
+
+		skb2 = alloc_skb(data_len + NET_IP_ALIGN, GFP_ATOMIC);
+		if (!skb2) {
+			dev_kfree_skb_any(skb);
+			return -ENOMEM;
+		}
+		skb_reserve(skb2, NET_IP_ALIGN);
+		memcpy(skb_put(skb2, data_len), skb->data + data_offset + 8,
+		       data_len);
+		skb_queue_tail(list, skb2);
+		pkts++;
+
+		skb_pull(skb, msg_len);
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
 
-	skb_queue_tail(list, skb);
+	dev_kfree_skb_any(skb);
 	return 0;
 }
 
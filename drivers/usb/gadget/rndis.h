@@ -220,6 +220,9 @@ typedef struct rndis_params
 	u32			speed;
 	u32			media_state;
 
+	u32			ul_max_pkt_per_xfer;
+	u32			dl_max_xfer_size;
+
 	const u8		*host_mac;
 	u16			*filter;
 	struct net_device	*dev;
@@ -239,6 +242,8 @@ int  rndis_set_param_dev (u8 configNr, struct net_device *dev,
 int  rndis_set_param_vendor (u8 configNr, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium (u8 configNr, u32 medium, u32 speed);
+void rndis_set_max_pkt_xfer(u8 configNr, u32 max_pkt_per_xfer);
+u32  rndis_get_dl_max_xfer_size(u8 configNr);
 void rndis_add_hdr (struct sk_buff *skb);
 int rndis_rm_hdr(struct gether *port, struct sk_buff *skb,
 			struct sk_buff_head *list);
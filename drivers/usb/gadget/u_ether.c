@@ -18,6 +18,10 @@
 #include <linux/ctype.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "u_ether.h"
 
@@ -27,6 +31,14 @@
 
 static struct workqueue_struct	*uether_wq;
 
+#define AGGR_HIST_BUCKETS	6
+
+struct aggr_stats {
+	unsigned long		xfers;
+	unsigned long		pkts;
+	unsigned long		hist[AGGR_HIST_BUCKETS];
+};
+
 struct eth_dev {
 	spinlock_t		lock;
 	struct gether		*port_usb;
@@ -55,6 +67,17 @@ struct eth_dev {
 	bool			zlp;
 	u8			host_mac[ETH_ALEN];
 	int             miMaxMtu;
+
+	unsigned		ul_max_pkts;
+	bool			dl_aggr;
+	unsigned		tx_inflight;
+	struct hrtimer		tx_timer;
+	struct tasklet_struct	tx_flush;
+
+	struct aggr_stats	ul_stats;
+	struct aggr_stats	dl_stats;
+	unsigned long		dl_timer_flushes;
+	struct dentry		*dent;
 };
 
 
@@ -72,6 +95,11 @@ MODULE_PARM_DESC(qmult, "queue length multiplier at high/super speed");
 #define qmult		1
 #endif
 
+static unsigned dl_aggr_timeout_us = 300;
+module_param(dl_aggr_timeout_us, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(dl_aggr_timeout_us,
+		"max time a partial IN aggregate is held before it is sent");
+
 static inline int qlen(struct usb_gadget *gadget)
 {
 	if (gadget_is_dualspeed(gadget) && (gadget->speed == USB_SPEED_HIGH ||
@@ -159,6 +187,15 @@ static const struct ethtool_ops ops = {
 	.get_link = ethtool_op_get_link,
 };
 
+static void aggr_stats_add(struct aggr_stats *stats, unsigned pkts)
+{
+	int bucket = min(fls(pkts) - 1, AGGR_HIST_BUCKETS - 1);
+
+	stats->xfers++;
+	stats->pkts += pkts;
+	stats->hist[max(bucket, 0)]++;
+}
+
 static void defer_kevent(struct eth_dev *dev, int flag)
 {
 	if (test_and_set_bit(flag, &dev->todo))
@@ -193,6 +230,7 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	size *= dev->ul_max_pkts;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -238,19 +276,29 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 		skb_put(skb, req->actual);
 
 		if (dev->unwrap) {
+			struct sk_buff_head	frames;
 			unsigned long	flags;
 
+			skb_queue_head_init(&frames);
 			spin_lock_irqsave(&dev->lock, flags);
 			if (dev->port_usb) {
 				status = dev->unwrap(dev->port_usb,
 							skb,
-							&dev->rx_frames);
+							&frames);
 			} else {
 				dev_kfree_skb_any(skb);
 				status = -ENOTCONN;
 			}
+			if (!skb_queue_empty(&frames))
+				aggr_stats_add(&dev->ul_stats,
+					       skb_queue_len(&frames));
 			spin_unlock_irqrestore(&dev->lock, flags);
+
+			spin_lock_irqsave(&dev->rx_frames.lock, flags);
+			skb_queue_splice_tail_init(&frames, &dev->rx_frames);
+			spin_unlock_irqrestore(&dev->rx_frames.lock, flags);
 		} else {
+			aggr_stats_add(&dev->ul_stats, 1);
 			skb_queue_tail(&dev->rx_frames, skb);
 		}
 
@@ -437,6 +485,10 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev = ep->driver_data;
+	unsigned	pkts = 1;
+
+	if (dev->dl_aggr && GETHER_SKB_CB(skb)->pkts)
+		pkts = GETHER_SKB_CB(skb)->pkts;
 
 	switch (req->status) {
 	default:
@@ -449,15 +501,28 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	case 0:
 		dev->net->stats.tx_bytes += skb->len;
 	}
-	dev->net->stats.tx_packets++;
+	dev->net->stats.tx_packets += pkts;
 
 	spin_lock(&dev->req_lock);
 	list_add(&req->list, &dev->tx_reqs);
+	dev->tx_inflight--;
 	spin_unlock(&dev->req_lock);
 	dev_kfree_skb_any(skb);
 
-	if (netif_carrier_ok(dev->net))
+	if (netif_carrier_ok(dev->net)) {
 		netif_wake_queue(dev->net);
+		if (dev->dl_aggr)
+			tasklet_schedule(&dev->tx_flush);
+	}
+}
+
+static enum hrtimer_restart eth_tx_timeout(struct hrtimer *timer)
+{
+	struct eth_dev	*dev = container_of(timer, struct eth_dev, tx_timer);
+
+	dev->dl_timer_flushes++;
+	tasklet_schedule(&dev->tx_flush);
+	return HRTIMER_NORESTART;
 }
 
 static inline int is_promisc(u16 cdc_filter)
@@ -465,24 +530,97 @@ static inline int is_promisc(u16 cdc_filter)
 	return cdc_filter & USB_CDC_PACKET_TYPE_PROMISCUOUS;
 }
 
+static void eth_tx_put_req(struct eth_dev *dev, struct usb_request *req)
+{
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (list_empty(&dev->tx_reqs))
+		netif_start_queue(dev->net);
+	list_add(&req->list, &dev->tx_reqs);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+}
+
+static void eth_tx_queue(struct eth_dev *dev, struct usb_ep *in,
+			 struct usb_request *req, struct sk_buff *skb,
+			 unsigned pkts)
+{
+	int		length = skb->len;
+	int		retval;
+	unsigned long	flags;
+
+	req->buf = skb->data;
+	req->context = skb;
+	req->complete = tx_complete;
+
+	
+	if (dev->port_usb->is_fixed &&
+	    length == dev->port_usb->fixed_in_len &&
+	    (length % in->maxpacket) == 0)
+		req->zero = 0;
+	else
+		req->zero = 1;
+
+	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
+		length++;
+
+	req->length = length;
+
+	
+	if (gadget_is_dualspeed(dev->gadget) &&
+			 (dev->gadget->speed == USB_SPEED_HIGH)) {
+		dev->tx_qlen++;
+		if (dev->tx_qlen == qmult) {
+			req->no_interrupt = 0;
+			dev->tx_qlen = 0;
+		} else {
+			req->no_interrupt = 1;
+		}
+	} else {
+		req->no_interrupt = 0;
+	}
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	dev->tx_inflight++;
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	switch (retval) {
+	default:
+		DBG(dev, "tx queue err %d\n", retval);
+		break;
+	case 0:
+		dev->net->trans_start = jiffies;
+		aggr_stats_add(&dev->dl_stats, pkts);
+	}
+
+	if (retval) {
+		dev_kfree_skb_any(skb);
+		spin_lock_irqsave(&dev->req_lock, flags);
+		dev->tx_inflight--;
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		dev->net->stats.tx_dropped++;
+		eth_tx_put_req(dev, req);
+	}
+}
+
 static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 					struct net_device *net)
 {
 	struct eth_dev		*dev = netdev_priv(net);
-	int			length;
-	int			retval;
 	struct usb_request	*req = NULL;
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	unsigned		pkts = 1;
+	bool			idle;
 
-	if ((!skb) || (IS_ERR(skb)))
+	if (IS_ERR(skb))
 		return NETDEV_TX_OK;
 
 	if ((!net) || (IS_ERR(net)))
 		return NETDEV_TX_OK;
 
-	length = skb->len;
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
@@ -535,65 +673,86 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		unsigned long	flags;
 
 		spin_lock_irqsave(&dev->lock, flags);
-		if (dev->port_usb)
+		if (dev->port_usb) {
 			skb = dev->wrap(dev->port_usb, skb);
+			if (PTR_ERR(skb) == -EINPROGRESS) {
+				spin_lock(&dev->req_lock);
+				idle = !dev->tx_inflight;
+				spin_unlock(&dev->req_lock);
+				
+				if (idle)
+					skb = dev->wrap(dev->port_usb, NULL);
+				else if (!hrtimer_active(&dev->tx_timer))
+					hrtimer_start(&dev->tx_timer,
+						ktime_set(0, dl_aggr_timeout_us *
+							  NSEC_PER_USEC),
+						HRTIMER_MODE_REL);
+			}
+		} else {
+			dev_kfree_skb_any(skb);
+			skb = NULL;
+		}
 		spin_unlock_irqrestore(&dev->lock, flags);
-		if (!skb)
-			goto drop;
+		if (IS_ERR(skb)) {
+			eth_tx_put_req(dev, req);
+			return NETDEV_TX_OK;
+		}
+		if (!skb) {
+			dev->net->stats.tx_dropped++;
+			eth_tx_put_req(dev, req);
+			return NETDEV_TX_OK;
+		}
 
-		length = skb->len;
+		if (dev->dl_aggr && GETHER_SKB_CB(skb)->pkts)
+			pkts = GETHER_SKB_CB(skb)->pkts;
 	}
-	req->buf = skb->data;
-	req->context = skb;
-	req->complete = tx_complete;
-
-	
-	if (dev->port_usb->is_fixed &&
-	    length == dev->port_usb->fixed_in_len &&
-	    (length % in->maxpacket) == 0)
-		req->zero = 0;
-	else
-		req->zero = 1;
+	eth_tx_queue(dev, in, req, skb, pkts);
+	return NETDEV_TX_OK;
+}
 
-	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
-		length++;
+/*
+ * Send the frames the wrap callback is holding back.  Runs from tx
+ * completion and from the aggregation timer, under the netdev tx lock
+ * so it stays ordered with eth_start_xmit().
+ */
+static void eth_tx_flush(unsigned long data)
+{
+	struct eth_dev		*dev = (struct eth_dev *)data;
+	struct net_device	*net = dev->net;
+	struct usb_request	*req = NULL;
+	struct sk_buff		*skb = NULL;
+	struct usb_ep		*in = NULL;
+	unsigned long		flags;
 
-	req->length = length;
+	if (!netif_running(net) || !netif_carrier_ok(net))
+		return;
 
-	
-	if (gadget_is_dualspeed(dev->gadget) &&
-			 (dev->gadget->speed == USB_SPEED_HIGH)) {
-		dev->tx_qlen++;
-		if (dev->tx_qlen == qmult) {
-			req->no_interrupt = 0;
-			dev->tx_qlen = 0;
-		} else {
-			req->no_interrupt = 1;
+	netif_tx_lock_bh(net);
+	spin_lock_irqsave(&dev->lock, flags);
+	/* may have been queued before a disconnect; wrap(NULL) is aggr-only */
+	if (dev->port_usb && dev->wrap && dev->dl_aggr) {
+		in = dev->port_usb->in_ep;
+		spin_lock(&dev->req_lock);
+		if (!list_empty(&dev->tx_reqs)) {
+			skb = dev->wrap(dev->port_usb, NULL);
+			if (IS_ERR_OR_NULL(skb)) {
+				skb = NULL;
+			} else {
+				req = container_of(dev->tx_reqs.next,
+						   struct usb_request, list);
+				list_del(&req->list);
+				if (list_empty(&dev->tx_reqs))
+					netif_stop_queue(net);
+			}
 		}
-	} else {
-		req->no_interrupt = 0;
-	}
-
-	retval = usb_ep_queue(in, req, GFP_ATOMIC);
-	switch (retval) {
-	default:
-		DBG(dev, "tx queue err %d\n", retval);
-		break;
-	case 0:
-		net->trans_start = jiffies;
+		spin_unlock(&dev->req_lock);
 	}
+	spin_unlock_irqrestore(&dev->lock, flags);
 
-	if (retval) {
-		dev_kfree_skb_any(skb);
-drop:
-		dev->net->stats.tx_dropped++;
-		spin_lock_irqsave(&dev->req_lock, flags);
-		if (list_empty(&dev->tx_reqs))
-			netif_start_queue(net);
-		list_add(&req->list, &dev->tx_reqs);
-		spin_unlock_irqrestore(&dev->req_lock, flags);
-	}
-	return NETDEV_TX_OK;
+	if (skb)
+		eth_tx_queue(dev, in, req, skb,
+			     GETHER_SKB_CB(skb)->pkts ? : 1);
+	netif_tx_unlock_bh(net);
 }
 
 
@@ -719,6 +878,57 @@ static struct device_type gadget_type = {
 	.name	= "gadget",
 };
 
+static void aggr_stats_show(struct seq_file *s, const char *name,
+			    struct aggr_stats *stats)
+{
+	static const char * const buckets[AGGR_HIST_BUCKETS] = {
+		"1", "2-3", "4-7", "8-15", "16-31", "32+" };
+	int i;
+
+	seq_printf(s, "%s: xfers %lu pkts %lu\n", name, stats->xfers,
+		   stats->pkts);
+	for (i = 0; i < AGGR_HIST_BUCKETS; i++)
+		seq_printf(s, "  %-6s pkts/xfer: %lu\n", buckets[i],
+			   stats->hist[i]);
+}
+
+static int aggr_stats_seq_show(struct seq_file *s, void *unused)
+{
+	struct eth_dev *dev = s->private;
+
+	seq_printf(s, "ul_max_pkts_per_xfer: %u\n", dev->ul_max_pkts);
+	seq_printf(s, "dl_aggregation: %s\n", dev->dl_aggr ? "on" : "off");
+	aggr_stats_show(s, "ul", &dev->ul_stats);
+	aggr_stats_show(s, "dl", &dev->dl_stats);
+	seq_printf(s, "dl_timer_flushes: %lu\n", dev->dl_timer_flushes);
+	return 0;
+}
+
+static int aggr_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, aggr_stats_seq_show, inode->i_private);
+}
+
+static ssize_t aggr_stats_reset(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct eth_dev *dev = s->private;
+
+	memset(&dev->ul_stats, 0, sizeof(dev->ul_stats));
+	memset(&dev->dl_stats, 0, sizeof(dev->dl_stats));
+	dev->dl_timer_flushes = 0;
+	return count;
+}
+
+static const struct file_operations aggr_stats_fops = {
+	.open		= aggr_stats_open,
+	.read		= seq_read,
+	.write		= aggr_stats_reset,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int gether_setup(struct usb_gadget *g, u8 ethaddr[ETH_ALEN])
 {
 	return gether_setup_name(g, ethaddr, "usb");
@@ -752,6 +962,10 @@ int gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 	INIT_WORK(&dev->rx_work, process_rx_w);
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
+	hrtimer_init(&dev->tx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_timer.function = eth_tx_timeout;
+	tasklet_init(&dev->tx_flush, eth_tx_flush, (unsigned long)dev);
+	dev->ul_max_pkts = 1;
 
 	skb_queue_head_init(&dev->rx_frames);
 
@@ -786,6 +1000,8 @@ int gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 		INFO(dev, "HOST MAC %pM\n", dev->host_mac);
 
 		the_dev = dev;
+		dev->dent = debugfs_create_file("usb_ether_aggr", S_IRUGO | S_IWUSR,
+						NULL, dev, &aggr_stats_fops);
         if (g) {
             the_dev->miMaxMtu = g->miMaxMtu;
             if (the_dev->miMaxMtu == ETH_FRAME_LEN_MAX - ETH_HLEN)
@@ -802,8 +1018,11 @@ void gether_cleanup(void)
 	if (!the_dev)
 		return;
 
+	debugfs_remove(the_dev->dent);
 	unregister_netdev(the_dev->net);
 	flush_work_sync(&the_dev->work);
+	hrtimer_cancel(&the_dev->tx_timer);
+	tasklet_kill(&the_dev->tx_flush);
 	free_netdev(the_dev->net);
 
 	the_dev = NULL;
@@ -866,8 +1085,11 @@ struct net_device *gether_connect(struct gether *link)
 		dev->header_len = link->header_len;
 		dev->unwrap = link->unwrap;
 		dev->wrap = link->wrap;
+		dev->ul_max_pkts = max_t(unsigned, link->ul_max_pkts_per_xfer, 1);
+		dev->tx_inflight = 0;
 
 		spin_lock(&dev->lock);
+		dev->dl_aggr = link->dl_max_pkts_per_xfer > 1;
 		dev->port_usb = link;
 		link->ioport = dev;
 		if (netif_running(dev->net)) {
@@ -910,6 +1132,11 @@ void gether_disconnect(struct gether *link)
 	netif_stop_queue(dev->net);
 	netif_carrier_off(dev->net);
 
+	spin_lock(&dev->lock);
+	dev->dl_aggr = false;
+	spin_unlock(&dev->lock);
+	hrtimer_cancel(&dev->tx_timer);
+
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
 	while (!list_empty(&dev->tx_reqs)) {
@@ -42,6 +42,11 @@ struct gether {
 	bool				is_fixed;
 	u32				fixed_out_len;
 	u32				fixed_in_len;
+
+	
+	u32				ul_max_pkts_per_xfer;
+	u32				dl_max_pkts_per_xfer;
+
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
@@ -53,6 +58,11 @@ struct gether {
 	void				(*close)(struct gether *);
 };
 
+struct gether_skb_cb {
+	unsigned			pkts;
+};
+#define GETHER_SKB_CB(skb)	((struct gether_skb_cb *)(skb)->cb)
+
 #define	DEFAULT_FILTER	(USB_CDC_PACKET_TYPE_BROADCAST \
 			|USB_CDC_PACKET_TYPE_ALL_MULTICAST \
 			|USB_CDC_PACKET_TYPE_PROMISCUOUS \
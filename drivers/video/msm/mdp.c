@@ -2250,6 +2250,7 @@ static struct platform_driver mdp_driver = {
 	.driver = {
 		.name = "mdp",
 		.pm = &mdp_dev_pm_ops,
+		.async_domain = &device_async_display,
 	},
 };
 
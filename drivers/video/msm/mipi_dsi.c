@@ -60,6 +60,7 @@ static struct platform_driver mipi_dsi_driver = {
 	.shutdown = NULL,
 	.driver = {
 		   .name = "mipi_dsi",
+		   .async_domain = &device_async_display,
 		   },
 };
 
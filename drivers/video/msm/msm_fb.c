@@ -1167,6 +1167,7 @@ static struct platform_driver msm_fb_driver = {
 		   
 		   .name = "msm_fb",
 		   .pm = &msm_fb_dev_pm_ops,
+		   .async_domain = &device_async_display,
 		   },
 };
 
@@ -352,9 +352,8 @@ static void vid_dec_output_frame_done(struct video_client_ctx *client_ctx,
 				"size %u\n", __func__,
 				(void *)kernel_vaddr,
 				vcd_frame_data->alloc_len);
-			msm_ion_do_cache_op(client_ctx->user_ion_client,
-					buff_handle,
-					(unsigned long *) kernel_vaddr,
+			vidc_cache_op(client_ctx, buff_handle,
+					(void *)kernel_vaddr,
 					(unsigned long)vcd_frame_data->\
 					alloc_len,
 					ION_IOC_INV_CACHES);
@@ -1267,6 +1266,7 @@ static u32 vid_dec_decode_frame(struct video_client_ctx *client_ctx,
 	u32 vcd_status = VCD_ERR_FAIL;
 	u32 ion_flag = 0;
 	struct ion_handle *buff_handle = NULL;
+	ktime_t start = ktime_get();
 
 	if (!client_ctx || !input_frame_info)
 		return false;
@@ -1302,13 +1302,14 @@ static u32 vid_dec_decode_frame(struct video_client_ctx *client_ctx,
 						buffer_index,
 						&buff_handle);
 			if (ion_flag == CACHED && buff_handle) {
-				msm_ion_do_cache_op(client_ctx->user_ion_client,
-				buff_handle,
-				(unsigned long *)kernel_vaddr,
+				vidc_cache_op(client_ctx, buff_handle,
+				vcd_input_buffer.virtual +
+				vcd_input_buffer.offset,
 				(unsigned long) vcd_input_buffer.data_len,
 				ION_IOC_CLEAN_CACHES);
 			}
 		}
+		vidc_frame_overhead(start);
 		vcd_status = vcd_decode_frame(client_ctx->vcd_handle,
 					      &vcd_input_buffer);
 		if (!vcd_status)
@@ -1334,6 +1335,7 @@ static u32 vid_dec_fill_output_buffer(struct video_client_ctx *client_ctx,
 	s32 buffer_index = -1;
 	u32 vcd_status = VCD_ERR_FAIL;
 	struct ion_handle *buff_handle = NULL;
+	ktime_t start = ktime_get();
 
 	struct vcd_frame_data vcd_frame;
 
@@ -1358,6 +1360,7 @@ static u32 vid_dec_fill_output_buffer(struct video_client_ctx *client_ctx,
 						buffer_index,
 						&buff_handle);
 		vcd_frame.buff_ion_handle = buff_handle;
+		vidc_frame_overhead(start);
 		vcd_status = vcd_fill_output_buffer(client_ctx->vcd_handle,
 						    &vcd_frame);
 		if (!vcd_status)
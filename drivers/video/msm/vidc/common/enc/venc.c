@@ -287,16 +287,16 @@ static void vid_enc_output_frame_done(struct video_client_ctx *client_ctx,
 		venc_msg->venc_msg_info.statuscode =
 			VEN_S_EFATAL;
 	}
-	if (venc_msg->venc_msg_info.buf.len > 0) {
+	if (venc_msg->venc_msg_info.buf.len > 0 &&
+	    res_trk_get_core_type() == (u32)VCD_CORE_720P) {
 		ion_flag = vidc_get_fd_info(client_ctx, BUFFER_TYPE_OUTPUT,
 					pmem_fd, kernel_vaddr, buffer_index,
 					&buff_handle);
 		if (ion_flag == CACHED && buff_handle) {
-			msm_ion_do_cache_op(client_ctx->user_ion_client,
-				buff_handle,
-				(unsigned long *) kernel_vaddr,
+			vidc_cache_op(client_ctx, buff_handle,
+				(void *)kernel_vaddr,
 				(unsigned long)venc_msg->venc_msg_info.buf.sz,
-				ION_IOC_CLEAN_INV_CACHES);
+				ION_IOC_INV_CACHES);
 		}
 	}
 	mutex_lock(&client_ctx->msg_queue_lock);
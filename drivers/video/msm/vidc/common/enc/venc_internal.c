@@ -1652,6 +1652,7 @@ u32 vid_enc_encode_frame(struct video_client_ctx *client_ctx,
 	s32 buffer_index = -1;
 	u32 ion_flag = 0;
 	struct ion_handle *buff_handle = NULL;
+	ktime_t start = ktime_get();
 
 	u32 vcd_status = VCD_ERR_FAIL;
 
@@ -1689,15 +1690,14 @@ u32 vid_enc_encode_frame(struct video_client_ctx *client_ctx,
 
 		if (vcd_input_buffer.data_len > 0) {
 			if (ion_flag == CACHED && buff_handle) {
-				msm_ion_do_cache_op(
-				client_ctx->user_ion_client,
-				buff_handle,
-				(unsigned long *) vcd_input_buffer.virtual,
+				vidc_cache_op(client_ctx, buff_handle,
+				vcd_input_buffer.virtual,
 				(unsigned long) vcd_input_buffer.data_len,
 				ION_IOC_CLEAN_CACHES);
 			}
 		}
 
+		vidc_frame_overhead(start);
 		vcd_status = vcd_encode_frame(client_ctx->vcd_handle,
 		&vcd_input_buffer);
 		if (!vcd_status)
@@ -1724,6 +1724,7 @@ u32 vid_enc_fill_output_buffer(struct video_client_ctx *client_ctx,
 	s32 buffer_index = -1;
 	u32 vcd_status = VCD_ERR_FAIL;
 	struct ion_handle *buff_handle = NULL;
+	ktime_t start = ktime_get();
 
 	struct vcd_frame_data vcd_frame;
 
@@ -1747,6 +1748,7 @@ u32 vid_enc_fill_output_buffer(struct video_client_ctx *client_ctx,
 		vcd_frame.alloc_len = output_frame_info->sz;
 		vcd_frame.buff_ion_handle = buff_handle;
 
+		vidc_frame_overhead(start);
 		vcd_status = vcd_fill_output_buffer(client_ctx->vcd_handle,
 								&vcd_frame);
 		if (!vcd_status)
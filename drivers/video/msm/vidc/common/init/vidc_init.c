@@ -28,6 +28,8 @@
 #include <linux/clk.h>
 #include <linux/delay.h>
 #include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/ktime.h>
 #include <mach/clk.h>
 #include <linux/pm_runtime.h>
 #include <mach/msm_subsystem_map.h>
@@ -64,6 +66,10 @@ static spinlock_t vidc_spin_lock;
 
 u32 vidc_msg_timing, vidc_msg_pmem, vidc_msg_register, vidc_msg_debug;
 
+static u32 vidc_stat_lookups, vidc_stat_lookup_probes, vidc_stat_lookup_misses;
+static u32 vidc_stat_cache_ops, vidc_stat_cache_kbytes;
+static u32 vidc_stat_frames, vidc_stat_frame_us, vidc_stat_frame_max_us;
+
 #ifdef VIDC_ENABLE_DBGFS
 struct dentry *vidc_debugfs_root;
 
@@ -314,6 +320,22 @@ static int __init vidc_init(void)
 				(u32 *) &vidc_msg_register);
 		vidc_debugfs_file_create(root, "vidc_msg_debug",
 				(u32 *) &vidc_msg_debug);
+		vidc_debugfs_file_create(root, "vidc_stat_lookups",
+				&vidc_stat_lookups);
+		vidc_debugfs_file_create(root, "vidc_stat_lookup_probes",
+				&vidc_stat_lookup_probes);
+		vidc_debugfs_file_create(root, "vidc_stat_lookup_misses",
+				&vidc_stat_lookup_misses);
+		vidc_debugfs_file_create(root, "vidc_stat_cache_ops",
+				&vidc_stat_cache_ops);
+		vidc_debugfs_file_create(root, "vidc_stat_cache_kbytes",
+				&vidc_stat_cache_kbytes);
+		vidc_debugfs_file_create(root, "vidc_stat_frames",
+				&vidc_stat_frames);
+		vidc_debugfs_file_create(root, "vidc_stat_frame_us",
+				&vidc_stat_frame_us);
+		vidc_debugfs_file_create(root, "vidc_stat_frame_max_us",
+				&vidc_stat_frame_max_us);
 	}
 #endif
 	return 0;
@@ -375,6 +397,89 @@ void vidc_release_firmware(void)
 }
 EXPORT_SYMBOL(vidc_release_firmware);
 
+static void vidc_hash_insert(u8 *hash, unsigned long key, u32 index)
+{
+	u32 slot = hash_long(key, VIDC_ADDR_HASH_BITS);
+
+	while (hash[slot])
+		slot = (slot + 1) & (VIDC_ADDR_HASH_SIZE - 1);
+	hash[slot] = index + 1;
+}
+
+static void vidc_rehash_addr_table(struct video_client_ctx *client_ctx,
+				enum buffer_dir buffer)
+{
+	struct buf_addr_table *buf_addr_table;
+	struct buf_addr_hash *hash;
+	u32 num_of_buffers, i;
+
+	if (buffer == BUFFER_TYPE_INPUT) {
+		buf_addr_table = client_ctx->input_buf_addr_table;
+		num_of_buffers = client_ctx->num_of_input_buffers;
+		hash = &client_ctx->input_buf_addr_hash;
+	} else {
+		buf_addr_table = client_ctx->output_buf_addr_table;
+		num_of_buffers = client_ctx->num_of_output_buffers;
+		hash = &client_ctx->output_buf_addr_hash;
+	}
+
+	memset(hash, 0, sizeof(*hash));
+	for (i = 0; i < num_of_buffers; ++i) {
+		vidc_hash_insert(hash->user_vaddr,
+				buf_addr_table[i].user_vaddr, i);
+		vidc_hash_insert(hash->kernel_vaddr,
+				buf_addr_table[i].kernel_vaddr, i);
+	}
+}
+
+static s32 vidc_hash_find(u8 *hash, struct buf_addr_table *buf_addr_table,
+	u32 num_of_buffers, u32 search_with_user_vaddr, unsigned long key)
+{
+	u32 slot = hash_long(key, VIDC_ADDR_HASH_BITS);
+	unsigned long entry;
+	u32 i;
+
+	vidc_stat_lookups++;
+	while (hash[slot]) {
+		i = hash[slot] - 1;
+		vidc_stat_lookup_probes++;
+		if (i < num_of_buffers) {
+			entry = search_with_user_vaddr ?
+				buf_addr_table[i].user_vaddr :
+				buf_addr_table[i].kernel_vaddr;
+			if (entry == key)
+				return i;
+		}
+		slot = (slot + 1) & (VIDC_ADDR_HASH_SIZE - 1);
+	}
+	vidc_stat_lookup_misses++;
+	return -1;
+}
+
+void vidc_cache_op(struct video_client_ctx *client_ctx,
+	struct ion_handle *buff_handle, void *vaddr,
+	unsigned long len, unsigned int cmd)
+{
+	if (!client_ctx || !buff_handle || !len)
+		return;
+	vidc_stat_cache_ops++;
+	vidc_stat_cache_kbytes += len >> 10;
+	msm_ion_do_cache_op(client_ctx->user_ion_client, buff_handle,
+			(unsigned long *)vaddr, len, cmd);
+}
+EXPORT_SYMBOL(vidc_cache_op);
+
+void vidc_frame_overhead(ktime_t start)
+{
+	u32 us = (u32)ktime_us_delta(ktime_get(), start);
+
+	vidc_stat_frames++;
+	vidc_stat_frame_us += us;
+	if (us > vidc_stat_frame_max_us)
+		vidc_stat_frame_max_us = us;
+}
+EXPORT_SYMBOL(vidc_frame_overhead);
+
 u32 vidc_get_fd_info(struct video_client_ctx *client_ctx,
 		enum buffer_dir buffer, int pmem_fd,
 		unsigned long kvaddr, int index,
@@ -483,8 +588,9 @@ u32 vidc_lookup_addr_table(struct video_client_ctx *client_ctx,
 	struct file **file, s32 *buffer_index)
 {
 	u32 num_of_buffers;
-	u32 i;
+	s32 i;
 	struct buf_addr_table *buf_addr_table;
+	struct buf_addr_hash *hash;
 	u32 found = false;
 
 	if (!client_ctx)
@@ -493,33 +599,35 @@ u32 vidc_lookup_addr_table(struct video_client_ctx *client_ctx,
 	if (buffer == BUFFER_TYPE_INPUT) {
 		buf_addr_table = client_ctx->input_buf_addr_table;
 		num_of_buffers = client_ctx->num_of_input_buffers;
+		hash = &client_ctx->input_buf_addr_hash;
 		DBG("%s(): buffer = INPUT\n", __func__);
 
 	} else {
 		buf_addr_table = client_ctx->output_buf_addr_table;
 		num_of_buffers = client_ctx->num_of_output_buffers;
+		hash = &client_ctx->output_buf_addr_hash;
 		DBG("%s(): buffer = OUTPUT\n", __func__);
 	}
 
-	for (i = 0; i < num_of_buffers; ++i) {
-		if (search_with_user_vaddr) {
-			if (*user_vaddr == buf_addr_table[i].user_vaddr) {
-				*kernel_vaddr = buf_addr_table[i].kernel_vaddr;
-				found = true;
-				DBG("%s() : client_ctx = %p."
-				" user_virt_addr = 0x%08lx is found",
-				__func__, client_ctx, *user_vaddr);
-				break;
-			}
-		} else {
-			if (*kernel_vaddr == buf_addr_table[i].kernel_vaddr) {
-				*user_vaddr = buf_addr_table[i].user_vaddr;
-				found = true;
-				DBG("%s() : client_ctx = %p."
-				" kernel_virt_addr = 0x%08lx is found",
-				__func__, client_ctx, *kernel_vaddr);
-				break;
-			}
+	if (search_with_user_vaddr) {
+		i = vidc_hash_find(hash->user_vaddr, buf_addr_table,
+				num_of_buffers, true, *user_vaddr);
+		if (i >= 0) {
+			*kernel_vaddr = buf_addr_table[i].kernel_vaddr;
+			found = true;
+			DBG("%s() : client_ctx = %p."
+			" user_virt_addr = 0x%08lx is found",
+			__func__, client_ctx, *user_vaddr);
+		}
+	} else {
+		i = vidc_hash_find(hash->kernel_vaddr, buf_addr_table,
+				num_of_buffers, false, *kernel_vaddr);
+		if (i >= 0) {
+			*user_vaddr = buf_addr_table[i].user_vaddr;
+			found = true;
+			DBG("%s() : client_ctx = %p."
+			" kernel_virt_addr = 0x%08lx is found",
+			__func__, client_ctx, *kernel_vaddr);
 		}
 	}
 
@@ -706,6 +814,7 @@ u32 vidc_insert_addr_table(struct video_client_ctx *client_ctx,
 		buf_addr_table[*num_of_buffers].buff_ion_flag =
 						ionflag;
 		*num_of_buffers = *num_of_buffers + 1;
+		vidc_rehash_addr_table(client_ctx, buffer);
 		DBG("%s() : client_ctx = %p, user_virt_addr = 0x%08lx, "
 			"kernel_vaddr = 0x%08lx phys_addr=%lu inserted!",
 			__func__, client_ctx, user_vaddr, *kernel_vaddr,
@@ -780,6 +889,7 @@ u32 vidc_insert_addr_table_kernel(struct video_client_ctx *client_ctx,
 		buf_addr_table[*num_of_buffers].phy_addr = phys_addr;
 		buf_addr_table[*num_of_buffers].buff_ion_handle = NULL;
 		*num_of_buffers = *num_of_buffers + 1;
+		vidc_rehash_addr_table(client_ctx, buffer);
 		DBG("%s() : client_ctx = %p, user_virt_addr = 0x%08lx, "
 			"kernel_vaddr = 0x%08lx inserted!", __func__,
 			client_ctx, user_vaddr, kernel_vaddr);
@@ -863,8 +973,11 @@ u32 vidc_delete_addr_table(struct video_client_ctx *client_ctx,
 			buf_addr_table[*num_of_buffers - 1].file;
 		buf_addr_table[i].buff_ion_handle =
 			buf_addr_table[*num_of_buffers - 1].buff_ion_handle;
+		buf_addr_table[i].buff_ion_flag =
+			buf_addr_table[*num_of_buffers - 1].buff_ion_flag;
 	}
 	*num_of_buffers = *num_of_buffers - 1;
+	vidc_rehash_addr_table(client_ctx, buffer);
 	DBG("%s() : client_ctx = %p."
 		" user_virt_addr = 0x%08lx is found and deleted",
 		__func__, client_ctx, user_vaddr);
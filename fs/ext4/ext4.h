@@ -31,6 +31,7 @@
 #include <linux/percpu_counter.h>
 #ifdef __KERNEL__
 #include <linux/compat.h>
+#include <linux/blk-discard.h>
 #endif
 
 
@@ -291,9 +292,10 @@ struct flex_groups {
 #define EXT4_EXTENTS_FL			0x00080000 
 #define EXT4_EA_INODE_FL	        0x00200000 
 #define EXT4_EOFBLOCKS_FL		0x00400000 
+#define EXT4_INLINE_DATA_FL		0x10000000 
 #define EXT4_RESERVED_FL		0x80000000 
 
-#define EXT4_FL_USER_VISIBLE		0x004BDFFF 
+#define EXT4_FL_USER_VISIBLE		0x104BDFFF 
 #define EXT4_FL_USER_MODIFIABLE		0x004B80FF 
 
 #define EXT4_FL_INHERITED (EXT4_SECRM_FL | EXT4_UNRM_FL | EXT4_COMPR_FL |\
@@ -338,6 +340,7 @@ enum {
 	EXT4_INODE_EXTENTS	= 19,	
 	EXT4_INODE_EA_INODE	= 21,	
 	EXT4_INODE_EOFBLOCKS	= 22,	
+	EXT4_INODE_INLINE_DATA	= 28,	
 	EXT4_INODE_RESERVED	= 31,	
 };
 
@@ -370,6 +373,7 @@ static inline void ext4_check_flag_values(void)
 	CHECK_FLAG_VALUE(EXTENTS);
 	CHECK_FLAG_VALUE(EA_INODE);
 	CHECK_FLAG_VALUE(EOFBLOCKS);
+	CHECK_FLAG_VALUE(INLINE_DATA);
 	CHECK_FLAG_VALUE(RESERVED);
 }
 
@@ -729,12 +733,14 @@ struct ext4_inode_info {
 #define EXT4_MOUNT_POSIX_ACL		0x08000	
 #define EXT4_MOUNT_NO_AUTO_DA_ALLOC	0x10000	
 #define EXT4_MOUNT_BARRIER		0x20000 
+#define EXT4_MOUNT_INLINE_DATA		0x40000 
 #define EXT4_MOUNT_QUOTA		0x80000 
 #define EXT4_MOUNT_USRQUOTA		0x100000 
 #define EXT4_MOUNT_GRPQUOTA		0x200000 
 #define EXT4_MOUNT_DIOREAD_NOLOCK	0x400000 
 #define EXT4_MOUNT_JOURNAL_CHECKSUM	0x800000 
 #define EXT4_MOUNT_JOURNAL_ASYNC_COMMIT	0x1000000 
+#define EXT4_MOUNT_DISCARD_DEFER	0x2000000 
 #define EXT4_MOUNT_MBLK_IO_SUBMIT	0x4000000 
 #define EXT4_MOUNT_DELALLOC		0x8000000 
 #define EXT4_MOUNT_DATA_ERR_ABORT	0x10000000 
@@ -983,6 +989,7 @@ struct ext4_sb_info {
 	atomic_t s_mb_preallocated;
 	atomic_t s_mb_discarded;
 	atomic_t s_lock_busy;
+	struct blk_discard_defer *s_discard_defer;
 
 	
 	struct ext4_locality_group __percpu *s_locality_groups;
@@ -1181,6 +1188,12 @@ static inline void ext4_clear_state_flags(struct ext4_inode_info *ei)
 					 EXT4_FEATURE_RO_COMPAT_LARGE_FILE| \
 					 EXT4_FEATURE_RO_COMPAT_BTREE_DIR)
 
+#ifdef CONFIG_EXT4_FS_XATTR
+#define EXT4_FEATURE_INCOMPAT_INLINE_SUPP EXT4_FEATURE_INCOMPAT_INLINEDATA
+#else
+#define EXT4_FEATURE_INCOMPAT_INLINE_SUPP 0
+#endif
+
 #define EXT4_FEATURE_COMPAT_SUPP	EXT2_FEATURE_COMPAT_EXT_ATTR
 #define EXT4_FEATURE_INCOMPAT_SUPP	(EXT4_FEATURE_INCOMPAT_FILETYPE| \
 					 EXT4_FEATURE_INCOMPAT_RECOVER| \
@@ -1188,7 +1201,8 @@ static inline void ext4_clear_state_flags(struct ext4_inode_info *ei)
 					 EXT4_FEATURE_INCOMPAT_EXTENTS| \
 					 EXT4_FEATURE_INCOMPAT_64BIT| \
 					 EXT4_FEATURE_INCOMPAT_FLEX_BG| \
-					 EXT4_FEATURE_INCOMPAT_MMP)
+					 EXT4_FEATURE_INCOMPAT_MMP| \
+					 EXT4_FEATURE_INCOMPAT_INLINE_SUPP)
 #define EXT4_FEATURE_RO_COMPAT_SUPP	(EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER| \
 					 EXT4_FEATURE_RO_COMPAT_LARGE_FILE| \
 					 EXT4_FEATURE_RO_COMPAT_GDT_CSUM| \
@@ -1894,6 +1908,64 @@ extern int ext4_move_extents(struct file *o_filp, struct file *d_filp,
 			     __u64 start_orig, __u64 start_donor,
 			     __u64 len, __u64 *moved_len);
 
+#define EXT4_MIN_INLINE_DATA_SIZE	(sizeof(__le32) * EXT4_N_BLOCKS)
+
+static inline int ext4_has_inline_data(struct inode *inode)
+{
+	return ext4_test_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+}
+
+#ifdef CONFIG_EXT4_FS_XATTR
+extern int ext4_readpage_inline(struct inode *inode, struct page *page);
+extern int ext4_try_inline_write_begin(struct address_space *mapping,
+				       struct inode *inode, loff_t pos,
+				       unsigned len, unsigned flags,
+				       struct page **pagep);
+extern int ext4_inline_write_end(struct inode *inode, loff_t pos,
+				 unsigned len, unsigned copied,
+				 struct page *page);
+extern int ext4_inline_data_fits(struct inode *inode, loff_t size);
+extern int ext4_convert_inline_data(struct inode *inode);
+extern int ext4_inline_data_truncate(struct inode *inode);
+extern int ext4_inline_data_fiemap(struct inode *inode,
+				   struct fiemap_extent_info *fieinfo);
+#else
+static inline int ext4_readpage_inline(struct inode *inode, struct page *page)
+{
+	return -EAGAIN;
+}
+static inline int ext4_try_inline_write_begin(struct address_space *mapping,
+				       struct inode *inode, loff_t pos,
+				       unsigned len, unsigned flags,
+				       struct page **pagep)
+{
+	return 0;
+}
+static inline int ext4_inline_write_end(struct inode *inode, loff_t pos,
+				 unsigned len, unsigned copied,
+				 struct page *page)
+{
+	return -EIO;
+}
+static inline int ext4_inline_data_fits(struct inode *inode, loff_t size)
+{
+	return 0;
+}
+static inline int ext4_convert_inline_data(struct inode *inode)
+{
+	return 0;
+}
+static inline int ext4_inline_data_truncate(struct inode *inode)
+{
+	return 0;
+}
+static inline int ext4_inline_data_fiemap(struct inode *inode,
+				   struct fiemap_extent_info *fieinfo)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
 #ifdef CONFIG_EXT4_E2FSCK_RECOVER
 extern void ext4_e2fsck(struct super_block *sb);
 #endif
@@ -3532,6 +3532,12 @@ long ext4_fallocate(struct file *file, int mode, loff_t offset, loff_t len)
 	struct ext4_map_blocks map;
 	unsigned int credits, blkbits = inode->i_blkbits;
 
+	if (ext4_has_inline_data(inode)) {
+		ret = ext4_convert_inline_data(inode);
+		if (ret)
+			return ret;
+	}
+
 	if (!(ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS)))
 		return -EOPNOTSUPP;
 
@@ -3991,6 +3997,13 @@ int ext4_fiemap(struct inode *inode, struct fiemap_extent_info *fieinfo,
 	ext4_lblk_t start_blk;
 	int error = 0;
 
+	if (ext4_has_inline_data(inode) &&
+	    !(fieinfo->fi_flags & FIEMAP_FLAG_XATTR)) {
+		error = ext4_inline_data_fiemap(inode, fieinfo);
+		if (error != -EAGAIN)
+			return error;
+	}
+
 	
 	if (!(ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS)))
 		return generic_block_fiemap(inode, fieinfo, start, len,
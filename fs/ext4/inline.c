@@ -0,0 +1,558 @@
+/*
+ *  linux/fs/ext4/inline.c
+ *
+ * Inline data for small regular files.  The first
+ * EXT4_MIN_INLINE_DATA_SIZE bytes of the file live in i_block, the
+ * remainder in the "system.data" extended attribute inside the inode
+ * body.  A file is converted to ordinary blocks as soon as it no
+ * longer fits.
+ *
+ * Lock ordering: journal handle, page lock of page 0, xattr_sem.
+ */
+
+#include <linux/fs.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/buffer_head.h>
+#include <linux/fiemap.h>
+#include <linux/slab.h>
+
+#include "ext4_jbd2.h"
+#include "xattr.h"
+
+static int ext4_may_inline_data(struct inode *inode)
+{
+	return test_opt(inode->i_sb, INLINE_DATA) &&
+	       S_ISREG(inode->i_mode) &&
+	       EXT4_I(inode)->i_extra_isize &&
+	       !inode->i_size && !inode->i_blocks;
+}
+
+static int ext4_inline_capacity(struct inode *inode, struct ext4_iloc *iloc)
+{
+	int size = ext4_xattr_inline_get(inode, iloc, NULL, 0);
+
+	if (size == -ENODATA)
+		size = 0;
+	if (size < 0)
+		return size;
+	return EXT4_MIN_INLINE_DATA_SIZE + size;
+}
+
+static int ext4_read_inline_data(struct inode *inode, void *buf, size_t len,
+				 struct ext4_iloc *iloc)
+{
+	size_t cp = min_t(size_t, len, EXT4_MIN_INLINE_DATA_SIZE);
+	int ret;
+
+	memcpy(buf, EXT4_I(inode)->i_data, cp);
+	if (len == cp)
+		return cp;
+
+	ret = ext4_xattr_inline_get(inode, iloc, buf + cp, len - cp);
+	if (ret == -ENODATA)
+		return cp;
+	if (ret < 0)
+		return ret;
+	return cp + min_t(size_t, ret, len - cp);
+}
+
+static int ext4_fill_inline_page(struct inode *inode, struct page *page,
+				 struct ext4_iloc *iloc)
+{
+	size_t len = min_t(loff_t, i_size_read(inode), PAGE_CACHE_SIZE);
+	void *kaddr;
+	int ret;
+
+	kaddr = kmap_atomic(page);
+	ret = ext4_read_inline_data(inode, kaddr, len, iloc);
+	if (ret >= 0)
+		memset(kaddr + ret, 0, PAGE_CACHE_SIZE - ret);
+	flush_dcache_page(page);
+	kunmap_atomic(kaddr);
+	if (ret < 0)
+		return ret;
+
+	SetPageUptodate(page);
+	return 0;
+}
+
+int ext4_readpage_inline(struct inode *inode, struct page *page)
+{
+	struct ext4_iloc iloc;
+	int ret = 0;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	if (!ext4_has_inline_data(inode)) {
+		up_read(&EXT4_I(inode)->xattr_sem);
+		return -EAGAIN;
+	}
+
+	if (page->index) {
+		zero_user_segment(page, 0, PAGE_CACHE_SIZE);
+		SetPageUptodate(page);
+	} else {
+		ret = ext4_get_inode_loc(inode, &iloc);
+		if (!ret) {
+			ret = ext4_fill_inline_page(inode, page, &iloc);
+			brelse(iloc.bh);
+		}
+	}
+	up_read(&EXT4_I(inode)->xattr_sem);
+
+	if (ret)
+		SetPageError(page);
+	unlock_page(page);
+	return ret;
+}
+
+static int ext4_set_inline_feature(handle_t *handle, struct super_block *sb)
+{
+	int err;
+
+	if (EXT4_HAS_INCOMPAT_FEATURE(sb, EXT4_FEATURE_INCOMPAT_INLINEDATA))
+		return 0;
+
+	err = ext4_journal_get_write_access(handle, EXT4_SB(sb)->s_sbh);
+	if (err)
+		return err;
+	EXT4_SET_INCOMPAT_FEATURE(sb, EXT4_FEATURE_INCOMPAT_INLINEDATA);
+	return ext4_handle_dirty_super(handle, sb);
+}
+
+static int ext4_prepare_inline_data(handle_t *handle, struct inode *inode,
+				    struct ext4_iloc *iloc, loff_t size)
+{
+	size_t want = 0;
+	void *value;
+	int cur, ret;
+
+	if (size > EXT4_MIN_INLINE_DATA_SIZE)
+		want = size - EXT4_MIN_INLINE_DATA_SIZE;
+
+	cur = ext4_xattr_inline_get(inode, iloc, NULL, 0);
+	if (cur < 0 && cur != -ENODATA)
+		return cur;
+	if (cur >= 0 && want <= cur)
+		return 0;
+	if (!want)
+		return ext4_xattr_inline_set(handle, inode, iloc, "", 0);
+
+	value = kzalloc(want, GFP_NOFS);
+	if (!value)
+		return -ENOMEM;
+	if (cur > 0)
+		ext4_xattr_inline_get(inode, iloc, value, cur);
+	ret = ext4_xattr_inline_set(handle, inode, iloc, value, want);
+	kfree(value);
+	return ret;
+}
+
+int ext4_try_inline_write_begin(struct address_space *mapping,
+				struct inode *inode, loff_t pos,
+				unsigned len, unsigned flags,
+				struct page **pagep)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_iloc iloc;
+	handle_t *handle;
+	struct page *page;
+	int create, ret, err;
+
+	if (!ext4_has_inline_data(inode) && !ext4_may_inline_data(inode))
+		return 0;
+
+	if (pos + len > EXT4_INODE_SIZE(inode->i_sb))
+		return ext4_convert_inline_data(inode);
+
+	handle = ext4_journal_start(inode, 3);
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	page = grab_cache_page_write_begin(mapping, 0, flags | AOP_FLAG_NOFS);
+	if (!page) {
+		ext4_journal_stop(handle);
+		return -ENOMEM;
+	}
+
+	down_write(&ei->xattr_sem);
+	create = !ext4_has_inline_data(inode);
+	ret = 0;
+	if (create && !ext4_may_inline_data(inode))
+		goto out;
+
+	if (create) {
+		ret = ext4_set_inline_feature(handle, inode->i_sb);
+		if (ret)
+			goto out;
+	}
+	ret = ext4_reserve_inode_write(handle, inode, &iloc);
+	if (ret)
+		goto out;
+
+	ret = ext4_prepare_inline_data(handle, inode, &iloc, pos + len);
+	if (!ret && create) {
+		ext4_clear_inode_flag(inode, EXT4_INODE_EXTENTS);
+		ext4_set_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+		memset(ei->i_data, 0, sizeof(ei->i_data));
+	}
+	if (ret) {
+		brelse(iloc.bh);
+		if (ret == -ENOSPC)
+			ret = 0;
+		goto out;
+	}
+
+	if (!PageUptodate(page))
+		ret = ext4_fill_inline_page(inode, page, &iloc);
+	err = ext4_mark_iloc_dirty(handle, inode, &iloc);
+	if (!ret)
+		ret = err;
+	up_write(&ei->xattr_sem);
+
+	if (ret) {
+		unlock_page(page);
+		page_cache_release(page);
+		ext4_journal_stop(handle);
+		return ret;
+	}
+	*pagep = page;
+	return 1;
+
+out:
+	up_write(&ei->xattr_sem);
+	unlock_page(page);
+	page_cache_release(page);
+	err = ext4_journal_stop(handle);
+	if (ret)
+		return ret;
+	if (err)
+		return err;
+	return create ? 0 : ext4_convert_inline_data(inode);
+}
+
+static int ext4_write_inline_data(handle_t *handle, struct inode *inode,
+				  struct ext4_iloc *iloc, struct page *page,
+				  unsigned pos, unsigned len)
+{
+	void *kaddr, *value;
+	unsigned n;
+	int size, ret = 0;
+
+	kaddr = kmap(page);
+	if (pos < EXT4_MIN_INLINE_DATA_SIZE) {
+		n = min_t(unsigned, len, EXT4_MIN_INLINE_DATA_SIZE - pos);
+		memcpy((void *)EXT4_I(inode)->i_data + pos, kaddr + pos, n);
+		pos += n;
+		len -= n;
+	}
+	if (!len)
+		goto out;
+
+	size = ext4_xattr_inline_get(inode, iloc, NULL, 0);
+	if (size < 0 || pos + len - EXT4_MIN_INLINE_DATA_SIZE > size) {
+		ret = size < 0 ? size : -EIO;
+		goto out;
+	}
+	value = kmalloc(size, GFP_NOFS);
+	if (!value) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	ext4_xattr_inline_get(inode, iloc, value, size);
+	memcpy(value + pos - EXT4_MIN_INLINE_DATA_SIZE, kaddr + pos, len);
+	ret = ext4_xattr_inline_set(handle, inode, iloc, value, size);
+	kfree(value);
+out:
+	kunmap(page);
+	return ret;
+}
+
+int ext4_inline_write_end(struct inode *inode, loff_t pos, unsigned len,
+			  unsigned copied, struct page *page)
+{
+	handle_t *handle = ext4_journal_current_handle();
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_iloc iloc;
+	int ret, ret2;
+
+	down_write(&ei->xattr_sem);
+	ret = ext4_reserve_inode_write(handle, inode, &iloc);
+	if (!ret) {
+		if (copied)
+			ret = ext4_write_inline_data(handle, inode, &iloc,
+						     page, pos, copied);
+		if (!ret && pos + copied > inode->i_size)
+			i_size_write(inode, pos + copied);
+		if (!ret && pos + copied > ei->i_disksize)
+			ext4_update_i_disksize(inode, pos + copied);
+		ext4_update_inode_fsync_trans(handle, inode, 1);
+		ret2 = ext4_mark_iloc_dirty(handle, inode, &iloc);
+		if (!ret)
+			ret = ret2;
+	}
+	up_write(&ei->xattr_sem);
+
+	unlock_page(page);
+	page_cache_release(page);
+
+	ret2 = ext4_journal_stop(handle);
+	if (!ret)
+		ret = ret2;
+	return ret ? ret : copied;
+}
+
+int ext4_inline_data_fits(struct inode *inode, loff_t size)
+{
+	struct ext4_iloc iloc;
+	int ret;
+
+	if (size <= EXT4_MIN_INLINE_DATA_SIZE)
+		return 1;
+
+	if (ext4_get_inode_loc(inode, &iloc))
+		return 0;
+	down_read(&EXT4_I(inode)->xattr_sem);
+	ret = ext4_inline_capacity(inode, &iloc);
+	up_read(&EXT4_I(inode)->xattr_sem);
+	brelse(iloc.bh);
+	return ret > 0 && size <= ret;
+}
+
+static int ext4_commit_converted_page(handle_t *handle, struct inode *inode,
+				      struct page *page, unsigned len)
+{
+	struct buffer_head *bh, *head;
+	int ret;
+
+	ret = __block_write_begin(page, 0, len, ext4_get_block);
+	if (ret)
+		return ret;
+
+	if (!ext4_should_journal_data(inode)) {
+		if (ext4_should_order_data(inode))
+			ret = ext4_jbd2_file_inode(handle, inode);
+		block_commit_write(page, 0, len);
+		return ret;
+	}
+
+	bh = head = page_buffers(page);
+	do {
+		if (bh_offset(bh) >= len)
+			break;
+		ret = ext4_journal_get_write_access(handle, bh);
+		if (!ret) {
+			set_buffer_uptodate(bh);
+			ret = ext4_handle_dirty_metadata(handle, NULL, bh);
+		}
+	} while (!ret && (bh = bh->b_this_page) != head);
+	ext4_set_inode_state(inode, EXT4_STATE_JDATA);
+	return ret;
+}
+
+static int ext4_convert_inline_data_nolock(handle_t *handle,
+					   struct inode *inode,
+					   struct page *page)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	__le32 i_data[EXT4_N_BLOCKS];
+	struct ext4_iloc iloc;
+	void *value = NULL;
+	unsigned size;
+	int value_len, ret;
+
+	size = min_t(loff_t, i_size_read(inode), PAGE_CACHE_SIZE);
+	ret = ext4_reserve_inode_write(handle, inode, &iloc);
+	if (ret)
+		return ret;
+
+	if (!PageUptodate(page)) {
+		ret = ext4_fill_inline_page(inode, page, &iloc);
+		if (ret)
+			goto out;
+	}
+
+	value_len = ext4_xattr_inline_get(inode, &iloc, NULL, 0);
+	if (value_len < 0 && value_len != -ENODATA) {
+		ret = value_len;
+		goto out;
+	}
+	if (value_len > 0) {
+		value = kmalloc(value_len, GFP_NOFS);
+		if (!value) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		ext4_xattr_inline_get(inode, &iloc, value, value_len);
+	}
+	memcpy(i_data, ei->i_data, sizeof(i_data));
+
+	ret = ext4_xattr_inline_set(handle, inode, &iloc, NULL, 0);
+	if (ret)
+		goto out;
+	memset(ei->i_data, 0, sizeof(ei->i_data));
+	ext4_clear_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+	ret = ext4_mark_iloc_dirty(handle, inode, &iloc);
+	iloc.bh = NULL;
+	if (ret)
+		goto out;
+
+	if (EXT4_HAS_INCOMPAT_FEATURE(inode->i_sb,
+				      EXT4_FEATURE_INCOMPAT_EXTENTS)) {
+		ext4_set_inode_flag(inode, EXT4_INODE_EXTENTS);
+		ext4_ext_tree_init(handle, inode);
+	}
+
+	if (size)
+		ret = ext4_commit_converted_page(handle, inode, page, size);
+	if (!ret)
+		goto out;
+
+	if (ext4_reserve_inode_write(handle, inode, &iloc))
+		goto out;
+	ext4_clear_inode_flag(inode, EXT4_INODE_EXTENTS);
+	memcpy(ei->i_data, i_data, sizeof(i_data));
+	if (value_len >= 0)
+		ext4_xattr_inline_set(handle, inode, &iloc,
+				      value ? value : "", value_len);
+	ext4_set_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+	ext4_mark_iloc_dirty(handle, inode, &iloc);
+	iloc.bh = NULL;
+out:
+	brelse(iloc.bh);
+	kfree(value);
+	return ret;
+}
+
+int ext4_convert_inline_data(struct inode *inode)
+{
+	handle_t *handle;
+	struct page *page;
+	int ret, err, retries = 0;
+
+	if (!ext4_has_inline_data(inode))
+		return 0;
+
+retry:
+	handle = ext4_journal_start(inode,
+				    ext4_writepage_trans_blocks(inode) + 1);
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	page = grab_cache_page_write_begin(inode->i_mapping, 0, AOP_FLAG_NOFS);
+	if (!page) {
+		ext4_journal_stop(handle);
+		return -ENOMEM;
+	}
+
+	ret = 0;
+	down_write(&EXT4_I(inode)->xattr_sem);
+	if (ext4_has_inline_data(inode))
+		ret = ext4_convert_inline_data_nolock(handle, inode, page);
+	up_write(&EXT4_I(inode)->xattr_sem);
+
+	unlock_page(page);
+	page_cache_release(page);
+	err = ext4_journal_stop(handle);
+	if (!ret)
+		ret = err;
+
+	if (ret == -ENOSPC && ext4_should_retry_alloc(inode->i_sb, &retries))
+		goto retry;
+	return ret;
+}
+
+int ext4_inline_data_truncate(struct inode *inode)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	loff_t size = inode->i_size;
+	struct ext4_iloc iloc;
+	handle_t *handle;
+	void *value = NULL;
+	size_t want = 0;
+	int value_len, ret = 0, err, handled = 0;
+
+	handle = ext4_journal_start(inode, 3);
+	if (IS_ERR(handle)) {
+		ext4_std_error(inode->i_sb, PTR_ERR(handle));
+		return ext4_has_inline_data(inode);
+	}
+
+	down_write(&ei->xattr_sem);
+	if (!ext4_has_inline_data(inode))
+		goto out;
+	handled = 1;
+
+	ret = ext4_reserve_inode_write(handle, inode, &iloc);
+	if (ret)
+		goto out;
+
+	if (size < EXT4_MIN_INLINE_DATA_SIZE)
+		memset((void *)ei->i_data + size, 0,
+		       EXT4_MIN_INLINE_DATA_SIZE - size);
+	else
+		want = size - EXT4_MIN_INLINE_DATA_SIZE;
+
+	value_len = ext4_xattr_inline_get(inode, &iloc, NULL, 0);
+	if (value_len > 0 && want < value_len) {
+		if (want) {
+			value = kmalloc(want, GFP_NOFS);
+			if (!value)
+				ret = -ENOMEM;
+			else
+				ext4_xattr_inline_get(inode, &iloc,
+						      value, want);
+		}
+		if (!ret)
+			ret = ext4_xattr_inline_set(handle, inode, &iloc,
+						    value ? value : "", want);
+	}
+	if (!ret)
+		ext4_update_i_disksize(inode, size);
+	err = ext4_mark_iloc_dirty(handle, inode, &iloc);
+	if (!ret)
+		ret = err;
+out:
+	up_write(&ei->xattr_sem);
+	ext4_journal_stop(handle);
+	kfree(value);
+	if (handled && ret)
+		ext4_std_error(inode->i_sb, ret);
+	return handled;
+}
+
+int ext4_inline_data_fiemap(struct inode *inode,
+			    struct fiemap_extent_info *fieinfo)
+{
+	struct ext4_iloc iloc;
+	__u64 physical;
+	int ret;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	if (!ext4_has_inline_data(inode)) {
+		ret = -EAGAIN;
+		goto out;
+	}
+	ret = 0;
+	if (!i_size_read(inode))
+		goto out;
+
+	ret = ext4_get_inode_loc(inode, &iloc);
+	if (ret)
+		goto out;
+	physical = (__u64)iloc.bh->b_blocknr << inode->i_sb->s_blocksize_bits;
+	physical += (char *)ext4_raw_inode(&iloc) - iloc.bh->b_data;
+	physical += offsetof(struct ext4_inode, i_block);
+	brelse(iloc.bh);
+
+	ret = fiemap_fill_next_extent(fieinfo, 0, physical,
+				      i_size_read(inode),
+				      FIEMAP_EXTENT_DATA_INLINE |
+				      FIEMAP_EXTENT_NOT_ALIGNED |
+				      FIEMAP_EXTENT_LAST);
+	if (ret > 0)
+		ret = 0;
+out:
+	up_read(&EXT4_I(inode)->xattr_sem);
+	return ret;
+}
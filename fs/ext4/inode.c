@@ -368,6 +368,8 @@ int ext4_map_blocks(handle_t *handle, struct inode *inode,
 	ext_debug("ext4_map_blocks(): inode %lu, flag %d, max_blocks %u,"
 		  "logical block %lu\n", inode->i_ino, flags, map->m_len,
 		  (unsigned long) map->m_lblk);
+	if (WARN_ON_ONCE(ext4_has_inline_data(inode)))
+		return -EIO;
 	down_read((&EXT4_I(inode)->i_data_sem));
 	if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS)) {
 		retval = ext4_ext_map_blocks(handle, inode, map, flags &
@@ -614,6 +616,11 @@ static int ext4_write_begin(struct file *file, struct address_space *mapping,
 	unsigned from, to;
 
 	trace_ext4_write_begin(inode, pos, len, flags);
+	ret = ext4_try_inline_write_begin(mapping, inode, pos, len, flags,
+					  pagep);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
 	needed_blocks = ext4_writepage_trans_blocks(inode) + 1;
 	index = pos >> PAGE_CACHE_SHIFT;
 	from = pos & (PAGE_CACHE_SIZE - 1);
@@ -713,6 +720,9 @@ static int ext4_ordered_write_end(struct file *file,
 	int ret = 0, ret2;
 
 	trace_ext4_ordered_write_end(inode, pos, len, copied);
+	if (ext4_has_inline_data(inode))
+		return ext4_inline_write_end(inode, pos, len, copied, page);
+
 	ret = ext4_jbd2_file_inode(handle, inode);
 
 	if (ret == 0) {
@@ -752,6 +762,9 @@ static int ext4_writeback_write_end(struct file *file,
 	int ret = 0, ret2;
 
 	trace_ext4_writeback_write_end(inode, pos, len, copied);
+	if (ext4_has_inline_data(inode))
+		return ext4_inline_write_end(inode, pos, len, copied, page);
+
 	ret2 = ext4_generic_write_end(file, mapping, pos, len, copied,
 							page, fsdata);
 	copied = ret2;
@@ -787,6 +800,9 @@ static int ext4_journalled_write_end(struct file *file,
 	loff_t new_i_size;
 
 	trace_ext4_journalled_write_end(inode, pos, len, copied);
+	if (ext4_has_inline_data(inode))
+		return ext4_inline_write_end(inode, pos, len, copied, page);
+
 	from = pos & (PAGE_CACHE_SIZE - 1);
 	to = from + len;
 
@@ -1823,6 +1839,12 @@ static int ext4_da_write_begin(struct file *file, struct address_space *mapping,
 
 	index = pos >> PAGE_CACHE_SHIFT;
 
+	*fsdata = (void *)0;
+	ret = ext4_try_inline_write_begin(mapping, inode, pos, len, flags,
+					  pagep);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
 	if (ext4_nonda_switch(inode->i_sb)) {
 		*fsdata = (void *)FALL_BACK_TO_NONDELALLOC;
 		return ext4_write_begin(file, mapping, pos,
@@ -1892,6 +1914,9 @@ static int ext4_da_write_end(struct file *file,
 	unsigned long start, end;
 	int write_mode = (int)(unsigned long)fsdata;
 
+	if (ext4_has_inline_data(inode))
+		return ext4_inline_write_end(inode, pos, len, copied, page);
+
 	if (write_mode == FALL_BACK_TO_NONDELALLOC) {
 		switch (ext4_inode_journal_mode(inode)) {
 		case EXT4_INODE_ORDERED_DATA_MODE:
@@ -1982,6 +2007,9 @@ static sector_t ext4_bmap(struct address_space *mapping, sector_t block)
 	journal_t *journal;
 	int err;
 
+	if (ext4_has_inline_data(inode))
+		return 0;
+
 	if (mapping_tagged(mapping, PAGECACHE_TAG_DIRTY) &&
 			test_opt(inode->i_sb, DELALLOC)) {
 		filemap_write_and_wait(mapping);
@@ -2005,7 +2033,15 @@ static sector_t ext4_bmap(struct address_space *mapping, sector_t block)
 
 static int ext4_readpage(struct file *file, struct page *page)
 {
+	struct inode *inode = page->mapping->host;
+	int ret;
+
 	trace_ext4_readpage(page);
+	if (ext4_has_inline_data(inode)) {
+		ret = ext4_readpage_inline(inode, page);
+		if (ret != -EAGAIN)
+			return ret;
+	}
 	return mpage_readpage(page, ext4_get_block);
 }
 
@@ -2013,6 +2049,8 @@ static int
 ext4_readpages(struct file *file, struct address_space *mapping,
 		struct list_head *pages, unsigned nr_pages)
 {
+	if (ext4_has_inline_data(mapping->host))
+		return 0;
 	return mpage_readpages(mapping, pages, nr_pages, ext4_get_block);
 }
 
@@ -2298,7 +2336,7 @@ static ssize_t ext4_direct_IO(int rw, struct kiocb *iocb,
 	struct inode *inode = file->f_mapping->host;
 	ssize_t ret;
 
-	if (ext4_should_journal_data(inode))
+	if (ext4_should_journal_data(inode) || ext4_has_inline_data(inode))
 		return 0;
 
 	trace_ext4_direct_IO_enter(inode, offset, iov_iter_count(iter), rw);
@@ -2582,6 +2620,11 @@ void ext4_truncate(struct inode *inode)
 	if (inode->i_size == 0 && !test_opt(inode->i_sb, NO_AUTO_DA_ALLOC))
 		ext4_set_inode_state(inode, EXT4_STATE_DA_ALLOC_CLOSE);
 
+	if (ext4_has_inline_data(inode) && ext4_inline_data_truncate(inode)) {
+		trace_ext4_truncate_exit(inode);
+		return;
+	}
+
 	if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS))
 		ext4_ext_truncate(inode);
 	else
@@ -2892,6 +2935,12 @@ struct inode *ext4_iget(struct super_block *sb, unsigned long ino)
 				 ei->i_file_acl);
 		ret = -EIO;
 		goto bad_inode;
+	} else if (ext4_has_inline_data(inode)) {
+		if (!S_ISREG(inode->i_mode)) {
+			ext4_warning(sb, "inode %lu: inline data is only "
+				     "supported for regular files", ino);
+			ret = -EOPNOTSUPP;
+		}
 	} else if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS)) {
 		if (S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode) ||
 		    (S_ISLNK(inode->i_mode) &&
@@ -3183,6 +3232,14 @@ int ext4_setattr(struct dentry *dentry, struct iattr *attr)
 	if (attr->ia_valid & ATTR_SIZE) {
 		inode_dio_wait(inode);
 
+		if (ext4_has_inline_data(inode) &&
+		    attr->ia_size > inode->i_size &&
+		    !ext4_inline_data_fits(inode, attr->ia_size)) {
+			error = ext4_convert_inline_data(inode);
+			if (error)
+				return error;
+		}
+
 		if (!(ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS))) {
 			struct ext4_sb_info *sbi = EXT4_SB(inode->i_sb);
 
@@ -3424,7 +3481,8 @@ int ext4_mark_inode_dirty(handle_t *handle, struct inode *inode)
 	err = ext4_reserve_inode_write(handle, inode, &iloc);
 	if (ext4_handle_valid(handle) &&
 	    EXT4_I(inode)->i_extra_isize < sbi->s_want_extra_isize &&
-	    !ext4_test_inode_state(inode, EXT4_STATE_NO_EXPAND)) {
+	    !ext4_test_inode_state(inode, EXT4_STATE_NO_EXPAND) &&
+	    !ext4_has_inline_data(inode)) {
 		if ((jbd2_journal_extend(handle,
 			     EXT4_DATA_TRANS_BLOCKS(inode->i_sb))) == 0) {
 			ret = ext4_expand_extra_isize(inode,
@@ -3552,6 +3610,14 @@ int ext4_page_mkwrite(struct vm_area_struct *vma, struct vm_fault *vmf)
 	int retries = 0;
 
 	vfs_check_frozen(inode->i_sb, SB_FREEZE_WRITE);
+
+	if (ext4_has_inline_data(inode)) {
+		ret = ext4_convert_inline_data(inode);
+		if (ret) {
+			ret = VM_FAULT_SIGBUS;
+			goto out;
+		}
+	}
 	
 	if (test_opt(inode->i_sb, DELALLOC) &&
 	    !ext4_should_journal_data(inode) &&
@@ -1996,6 +1996,23 @@ static inline int ext4_issue_discard(struct super_block *sb,
 	return sb_issue_discard(sb, discard_block, count, GFP_NOFS, 0);
 }
 
+static int ext4_defer_discard(struct super_block *sb,
+		ext4_group_t block_group, ext4_grpblk_t cluster, int count)
+{
+	struct blk_discard_defer *dd = EXT4_SB(sb)->s_discard_defer;
+	int shift = sb->s_blocksize_bits - 9;
+	ext4_fsblk_t discard_block;
+
+	if (!dd || !test_opt(sb, DISCARD_DEFER))
+		return -EOPNOTSUPP;
+
+	discard_block = (EXT4_C2B(EXT4_SB(sb), cluster) +
+			 ext4_group_first_block_no(sb, block_group));
+	count = EXT4_C2B(EXT4_SB(sb), count);
+	return blk_discard_defer_add(dd, (sector_t)discard_block << shift,
+				     (sector_t)count << shift);
+}
+
 static void ext4_free_data_callback(struct super_block *sb,
 				    struct ext4_journal_cb_entry *jce,
 				    int rc)
@@ -2004,13 +2021,18 @@ static void ext4_free_data_callback(struct super_block *sb,
 	struct ext4_buddy e4b;
 	struct ext4_group_info *db;
 	int err, count = 0, count2 = 0;
+	bool discarded = false;
 
 	mb_debug(1, "gonna free %u blocks in group %u (0x%p):",
 		 entry->efd_count, entry->efd_group, entry);
 
-	if (test_opt(sb, DISCARD))
+	if (ext4_defer_discard(sb, entry->efd_group,
+			       entry->efd_start_cluster, entry->efd_count) &&
+	    test_opt(sb, DISCARD)) {
 		ext4_issue_discard(sb, entry->efd_group,
 				   entry->efd_start_cluster, entry->efd_count);
+		discarded = true;
+	}
 
 	err = ext4_mb_load_buddy(sb, entry->efd_group, &e4b);
 	
@@ -2026,7 +2048,7 @@ static void ext4_free_data_callback(struct super_block *sb,
 	rb_erase(&entry->efd_node, &(db->bb_free_root));
 	mb_free_blocks(NULL, &e4b, entry->efd_start_cluster, entry->efd_count);
 
-	if (!test_opt(sb, DISCARD))
+	if (!discarded)
 		EXT4_MB_GRP_CLEAR_TRIMMED(db);
 
 	if (!db->bb_free_root.rb_node) {
@@ -2165,6 +2187,11 @@ ext4_mb_mark_diskspace_used(struct ext4_allocation_context *ac,
 		goto out_err;
 	}
 
+	if (sbi->s_discard_defer)
+		blk_discard_defer_cancel(sbi->s_discard_defer,
+			(sector_t)block << (sb->s_blocksize_bits - 9),
+			(sector_t)len << (sb->s_blocksize_bits - 9));
+
 	ext4_lock_group(sb, ac->ac_b_ex.fe_group);
 #ifdef AGGRESSIVE_CHECK
 	{
@@ -791,6 +791,8 @@ static void ext4_put_super(struct super_block *sb)
 			ext4_abort(sb, "Couldn't clean up the journal");
 	}
 
+	blk_discard_defer_destroy(sbi->s_discard_defer);
+	sbi->s_discard_defer = NULL;
 	del_timer(&sbi->s_err_report);
 	ext4_release_system_zone(sb);
 	ext4_mb_release(sb);
@@ -1105,6 +1107,8 @@ enum {
 	Opt_inode_readahead_blks, Opt_journal_ioprio,
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
+	Opt_discard_defer, Opt_nodiscard_defer,
+	Opt_inline_data, Opt_noinline_data,
 };
 
 static const match_table_t tokens = {
@@ -1175,6 +1179,10 @@ static const match_table_t tokens = {
 	{Opt_dioread_lock, "dioread_lock"},
 	{Opt_discard, "discard"},
 	{Opt_nodiscard, "nodiscard"},
+	{Opt_discard_defer, "discard_defer"},
+	{Opt_nodiscard_defer, "nodiscard_defer"},
+	{Opt_inline_data, "inline_data"},
+	{Opt_noinline_data, "noinline_data"},
 	{Opt_init_itable, "init_itable=%u"},
 	{Opt_init_itable, "init_itable"},
 	{Opt_noinit_itable, "noinit_itable"},
@@ -1299,6 +1307,10 @@ static const struct mount_opts {
 	{Opt_dioread_lock, EXT4_MOUNT_DIOREAD_NOLOCK, MOPT_CLEAR},
 	{Opt_discard, EXT4_MOUNT_DISCARD, MOPT_SET},
 	{Opt_nodiscard, EXT4_MOUNT_DISCARD, MOPT_CLEAR},
+	{Opt_discard_defer, EXT4_MOUNT_DISCARD_DEFER, MOPT_SET},
+	{Opt_nodiscard_defer, EXT4_MOUNT_DISCARD_DEFER, MOPT_CLEAR},
+	{Opt_inline_data, EXT4_MOUNT_INLINE_DATA, MOPT_SET},
+	{Opt_noinline_data, EXT4_MOUNT_INLINE_DATA, MOPT_CLEAR},
 	{Opt_delalloc, EXT4_MOUNT_DELALLOC, MOPT_SET | MOPT_EXPLICIT},
 	{Opt_nodelalloc, EXT4_MOUNT_DELALLOC, MOPT_CLEAR | MOPT_EXPLICIT},
 	{Opt_journal_checksum, EXT4_MOUNT_JOURNAL_CHECKSUM, MOPT_SET},
@@ -2165,6 +2177,14 @@ static ssize_t delayed_allocation_blocks_show(struct ext4_attr *a,
 			percpu_counter_sum(&sbi->s_dirtyclusters_counter)));
 }
 
+static ssize_t discard_defer_stats_show(struct ext4_attr *a,
+					struct ext4_sb_info *sbi, char *buf)
+{
+	if (!sbi->s_discard_defer)
+		return snprintf(buf, PAGE_SIZE, "disabled\n");
+	return blk_discard_defer_show(sbi->s_discard_defer, buf);
+}
+
 static ssize_t session_write_kbytes_show(struct ext4_attr *a,
 					 struct ext4_sb_info *sbi, char *buf)
 {
@@ -2247,6 +2267,7 @@ static struct ext4_attr ext4_attr_##name = __ATTR(name, mode, show, store)
 EXT4_RO_ATTR(delayed_allocation_blocks);
 EXT4_RO_ATTR(session_write_kbytes);
 EXT4_RO_ATTR(lifetime_write_kbytes);
+EXT4_RO_ATTR(discard_defer_stats);
 EXT4_ATTR_OFFSET(inode_readahead_blks, 0644, sbi_ui_show,
 		 inode_readahead_blks_store, s_inode_readahead_blks);
 EXT4_RW_ATTR_SBI_UI(inode_goal, s_inode_goal);
@@ -2262,6 +2283,7 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(delayed_allocation_blocks),
 	ATTR_LIST(session_write_kbytes),
 	ATTR_LIST(lifetime_write_kbytes),
+	ATTR_LIST(discard_defer_stats),
 	ATTR_LIST(inode_readahead_blks),
 	ATTR_LIST(inode_goal),
 	ATTR_LIST(mb_stats),
@@ -3431,6 +3453,9 @@ no_journal:
 		goto failed_mount5;
 	}
 
+	if (test_opt(sb, DISCARD_DEFER))
+		sbi->s_discard_defer = blk_discard_defer_create(sb->s_bdev);
+
 	err = ext4_register_li_request(sb, first_not_zeroed);
 	if (err)
 		goto failed_mount6;
@@ -3477,6 +3502,8 @@ cantfind_ext4:
 failed_mount7:
 	ext4_unregister_li_request(sb);
 failed_mount6:
+	blk_discard_defer_destroy(sbi->s_discard_defer);
+	sbi->s_discard_defer = NULL;
 	ext4_mb_release(sb);
 failed_mount5:
 	ext4_ext_release(sb);
@@ -4075,6 +4102,9 @@ static int ext4_remount(struct super_block *sb, int *flags, char *data)
 		ext4_register_li_request(sb, first_not_zeroed);
 	}
 
+	if (test_opt(sb, DISCARD_DEFER) && !sbi->s_discard_defer)
+		sbi->s_discard_defer = blk_discard_defer_create(sb->s_bdev);
+
 	ext4_setup_system_zone(sb);
 	if (sbi->s_journal == NULL)
 		ext4_commit_super(sb, 1);
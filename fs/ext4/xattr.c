@@ -870,6 +870,73 @@ ext4_xattr_ibody_set(handle_t *handle, struct inode *inode,
 	return 0;
 }
 
+int
+ext4_xattr_inline_get(struct inode *inode, struct ext4_iloc *iloc,
+		      void *buffer, size_t buffer_size)
+{
+	struct ext4_inode *raw_inode = ext4_raw_inode(iloc);
+	struct ext4_xattr_ibody_header *header;
+	struct ext4_xattr_entry *entry;
+	size_t size;
+	void *end;
+	int error;
+
+	if (EXT4_I(inode)->i_extra_isize == 0 ||
+	    !ext4_test_inode_state(inode, EXT4_STATE_XATTR))
+		return -ENODATA;
+	header = IHDR(inode, raw_inode);
+	entry = IFIRST(header);
+	end = (void *)raw_inode + EXT4_SB(inode->i_sb)->s_inode_size;
+	error = ext4_xattr_check_names(entry, end);
+	if (error)
+		return error;
+	error = ext4_xattr_find_entry(&entry, EXT4_XATTR_INDEX_SYSTEM_DATA,
+				      EXT4_XATTR_SYSTEM_DATA,
+				      end - (void *)entry, 0);
+	if (error)
+		return error;
+	size = le32_to_cpu(entry->e_value_size);
+	if (buffer && size)
+		memcpy(buffer, (void *)IFIRST(header) +
+		       le16_to_cpu(entry->e_value_offs),
+		       min(size, buffer_size));
+	return size;
+}
+
+int
+ext4_xattr_inline_set(handle_t *handle, struct inode *inode,
+		      struct ext4_iloc *iloc, const void *value,
+		      size_t value_len)
+{
+	struct ext4_xattr_info i = {
+		.name_index = EXT4_XATTR_INDEX_SYSTEM_DATA,
+		.name = EXT4_XATTR_SYSTEM_DATA,
+		.value = value,
+		.value_len = value_len,
+	};
+	struct ext4_xattr_ibody_find is = {
+		.s = { .not_found = -ENODATA, },
+		.iloc = *iloc,
+	};
+	int error;
+
+	if (ext4_test_inode_state(inode, EXT4_STATE_NEW)) {
+		struct ext4_inode *raw_inode = ext4_raw_inode(iloc);
+		memset(raw_inode, 0, EXT4_SB(inode->i_sb)->s_inode_size);
+		ext4_clear_inode_state(inode, EXT4_STATE_NEW);
+	}
+
+	error = ext4_xattr_ibody_find(inode, &i, &is);
+	if (error)
+		return error;
+	if (!value && is.s.not_found)
+		return 0;
+	error = ext4_xattr_ibody_set(handle, inode, &i, &is);
+	if (!error && value)
+		ext4_xattr_update_super_block(handle, inode->i_sb);
+	return error;
+}
+
 int
 ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 		      const char *name, const void *value, size_t value_len,
@@ -11,6 +11,9 @@
 #define EXT4_XATTR_INDEX_TRUSTED		4
 #define	EXT4_XATTR_INDEX_LUSTRE			5
 #define EXT4_XATTR_INDEX_SECURITY	        6
+#define EXT4_XATTR_INDEX_SYSTEM_DATA		7
+
+#define EXT4_XATTR_SYSTEM_DATA		"data"
 
 struct ext4_xattr_header {
 	__le32	h_magic;	
@@ -73,6 +76,12 @@ extern void ext4_xattr_put_super(struct super_block *);
 extern int ext4_expand_extra_isize_ea(struct inode *inode, int new_extra_isize,
 			    struct ext4_inode *raw_inode, handle_t *handle);
 
+extern int ext4_xattr_inline_get(struct inode *inode, struct ext4_iloc *iloc,
+				 void *buffer, size_t buffer_size);
+extern int ext4_xattr_inline_set(handle_t *handle, struct inode *inode,
+				 struct ext4_iloc *iloc, const void *value,
+				 size_t value_len);
+
 extern int __init ext4_init_xattr(void);
 extern void ext4_exit_xattr(void);
 
@@ -618,6 +618,142 @@ const struct file_operations proc_clear_refs_operations = {
 	.llseek		= noop_llseek,
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+enum reclaim_type {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+};
+
+struct reclaim_param {
+	struct vm_area_struct *vma;
+	enum reclaim_type type;
+	unsigned long nr_to_reclaim;
+	unsigned long nr_reclaimed;
+};
+
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
+	unsigned long nr_isolated = 0;
+	LIST_HEAD(page_list);
+	pte_t *orig_pte, *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+
+	split_huge_page_pmd(walk->mm, pmd);
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+
+		if (page_mapcount(page) != 1)
+			continue;
+		if (PageAnon(page)) {
+			if (rp->type == RECLAIM_FILE || nr_swap_pages <= 0)
+				continue;
+		} else if (rp->type == RECLAIM_ANON) {
+			continue;
+		}
+
+		if (isolate_lru_page(page))
+			continue;
+		list_add(&page->lru, &page_list);
+		nr_isolated++;
+
+		if (rp->nr_to_reclaim &&
+		    rp->nr_reclaimed + nr_isolated >= rp->nr_to_reclaim)
+			break;
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+
+	if (nr_isolated)
+		rp->nr_reclaimed += reclaim_pages_from_list(&page_list);
+	cond_resched();
+
+	if (rp->nr_to_reclaim && rp->nr_reclaimed >= rp->nr_to_reclaim)
+		return 1;
+	return 0;
+}
+
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buffer[32];
+	char *type_buf, *nr_buf;
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	struct reclaim_param rp = { };
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count))
+		return -EFAULT;
+
+	nr_buf = strstrip(buffer);
+	type_buf = strsep(&nr_buf, " ");
+	if (!strcmp(type_buf, "file"))
+		rp.type = RECLAIM_FILE;
+	else if (!strcmp(type_buf, "anon"))
+		rp.type = RECLAIM_ANON;
+	else if (!strcmp(type_buf, "all"))
+		rp.type = RECLAIM_ALL;
+	else
+		return -EINVAL;
+	if (nr_buf && kstrtoul(skip_spaces(nr_buf), 10, &rp.nr_to_reclaim))
+		return -EINVAL;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+	mm = get_task_mm(task);
+	if (mm) {
+		struct mm_walk reclaim_walk = {
+			.pmd_entry = reclaim_pte_range,
+			.mm = mm,
+			.private = &rp,
+		};
+		down_read(&mm->mmap_sem);
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			if (is_vm_hugetlb_page(vma))
+				continue;
+			if (vma->vm_flags & (VM_LOCKED | VM_PFNMAP))
+				continue;
+			if (rp.type == RECLAIM_ANON && !vma->anon_vma)
+				continue;
+			if (rp.type == RECLAIM_FILE && !vma->vm_file)
+				continue;
+			rp.vma = vma;
+			if (walk_page_range(vma->vm_start, vma->vm_end,
+					&reclaim_walk))
+				break;
+		}
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return count;
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.write		= reclaim_write,
+	.llseek		= noop_llseek,
+};
+#endif
+
 typedef struct {
 	u64 pme;
 } pagemap_entry_t;
@@ -0,0 +1,75 @@
+#ifndef _LINUX_BLK_DISCARD_H
+#define _LINUX_BLK_DISCARD_H
+
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/rbtree.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <linux/list.h>
+
+struct block_device;
+
+struct blk_discard_stats {
+	u64		deferred;
+	u64		discarded;
+	u64		cancelled;
+	u64		dropped;
+	u64		pending;
+	unsigned int	bursts;
+	unsigned int	preempted;
+	unsigned int	errors;
+};
+
+struct blk_discard_defer {
+	struct block_device	*bdev;
+	struct list_head	list;
+	struct mutex		lock;
+	struct rb_root		root;
+	unsigned int		nr_extents;
+	sector_t		inflight_start;
+	sector_t		inflight_len;
+	wait_queue_head_t	wait;
+	struct delayed_work	work;
+	unsigned long		last_ios;
+	bool			disabled;
+	struct blk_discard_stats stats;
+};
+
+#ifdef CONFIG_BLK_DISCARD_DEFER
+extern struct blk_discard_defer *blk_discard_defer_create(
+		struct block_device *bdev);
+extern void blk_discard_defer_destroy(struct blk_discard_defer *dd);
+extern int blk_discard_defer_add(struct blk_discard_defer *dd,
+		sector_t sector, sector_t nr_sects);
+extern void blk_discard_defer_cancel(struct blk_discard_defer *dd,
+		sector_t sector, sector_t nr_sects);
+extern ssize_t blk_discard_defer_show(struct blk_discard_defer *dd,
+		char *buf);
+#else
+static inline struct blk_discard_defer *blk_discard_defer_create(
+		struct block_device *bdev)
+{
+	return NULL;
+}
+static inline void blk_discard_defer_destroy(struct blk_discard_defer *dd)
+{
+}
+static inline int blk_discard_defer_add(struct blk_discard_defer *dd,
+		sector_t sector, sector_t nr_sects)
+{
+	return -EOPNOTSUPP;
+}
+static inline void blk_discard_defer_cancel(struct blk_discard_defer *dd,
+		sector_t sector, sector_t nr_sects)
+{
+}
+static inline ssize_t blk_discard_defer_show(struct blk_discard_defer *dd,
+		char *buf)
+{
+	return 0;
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * boot_timeline.h: record initcalls, driver probes and async calls
+ * made during boot so that a timeline can be rendered afterwards.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_BOOT_TIMELINE_H
+#define _LINUX_BOOT_TIMELINE_H
+
+#include <linux/hrtimer.h>
+
+enum boot_timeline_type {
+	BOOT_TL_LEVEL,
+	BOOT_TL_INITCALL,
+	BOOT_TL_PROBE,
+	BOOT_TL_ASYNC,
+};
+
+#ifdef CONFIG_BOOT_TIMELINE
+static inline ktime_t boot_timeline_begin(void)
+{
+	return ktime_get();
+}
+
+extern __printf(4, 5)
+void boot_timeline_add(enum boot_timeline_type type, ktime_t start, int ret,
+		       const char *fmt, ...);
+#else
+static inline ktime_t boot_timeline_begin(void)
+{
+	return ktime_set(0, 0);
+}
+
+static inline __printf(4, 5)
+void boot_timeline_add(enum boot_timeline_type type, ktime_t start, int ret,
+		       const char *fmt, ...)
+{
+}
+#endif
+
+#endif
@@ -362,5 +362,20 @@ void cpufreq_frequency_table_get_attr(struct cpufreq_frequency_table *table,
 
 void cpufreq_frequency_table_put_attr(unsigned int cpu);
 
+struct task_struct;
+
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+extern void cpufreq_stats_task_switch(struct task_struct *prev,
+				      struct task_struct *next);
+extern void cpufreq_stats_tick(struct task_struct *curr);
+#else
+static inline void cpufreq_stats_task_switch(struct task_struct *prev,
+					     struct task_struct *next)
+{
+}
+static inline void cpufreq_stats_tick(struct task_struct *curr)
+{
+}
+#endif
 
 #endif 
@@ -21,6 +21,7 @@
 #include <linux/compiler.h>
 #include <linux/types.h>
 #include <linux/mutex.h>
+#include <linux/wait.h>
 #include <linux/pm.h>
 #include <linux/atomic.h>
 #include <asm/device.h>
@@ -147,9 +148,37 @@ struct device_driver {
 
 	const struct dev_pm_ops *pm;
 
+	struct device_async_domain *async_domain;
+
 	struct driver_private *p;
 };
 
+#define DEVICE_ASYNC_MAX_DEPS	4
+
+struct device_async_domain {
+	const char		*name;
+	struct list_head	domain;
+	struct device_async_domain *depends[DEVICE_ASYNC_MAX_DEPS];
+	unsigned int		queued;		/* attaches scheduled */
+	unsigned int		done;		/* attaches finished */
+	wait_queue_head_t	wait;
+};
+
+#define DEFINE_DEVICE_ASYNC_DOMAIN(_var, _name)			\
+	struct device_async_domain _var = {				\
+		.name	= _name,					\
+		.domain	= LIST_HEAD_INIT(_var.domain),			\
+		.wait	= __WAIT_QUEUE_HEAD_INITIALIZER(_var.wait),	\
+	}
+
+extern struct device_async_domain device_async_storage;
+extern struct device_async_domain device_async_display;
+extern struct device_async_domain device_async_audio;
+extern struct device_async_domain device_async_sensors;
+
+extern int device_async_depend(struct device_async_domain *domain,
+			       struct device_async_domain *dep);
+extern void device_async_synchronize(void);
 
 extern int __must_check driver_register(struct device_driver *drv);
 extern void driver_unregister(struct device_driver *drv);
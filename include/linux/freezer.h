@@ -45,11 +45,20 @@ extern bool set_freezable(void);
 
 #ifdef CONFIG_CGROUP_FREEZER
 extern bool cgroup_freezing(struct task_struct *task);
+extern void cgroup_freezer_adj_changed(struct task_struct *task);
+extern int cgroup_freezer_ipc(struct task_struct *task, bool oneway);
 #else 
 static inline bool cgroup_freezing(struct task_struct *task)
 {
 	return false;
 }
+static inline void cgroup_freezer_adj_changed(struct task_struct *task)
+{
+}
+static inline int cgroup_freezer_ipc(struct task_struct *task, bool oneway)
+{
+	return 0;
+}
 #endif 
 
 
@@ -176,6 +185,12 @@ static inline void thaw_kernel_threads(void) {}
 
 static inline bool try_to_freeze(void) { return false; }
 
+static inline void cgroup_freezer_adj_changed(struct task_struct *task) {}
+static inline int cgroup_freezer_ipc(struct task_struct *task, bool oneway)
+{
+	return 0;
+}
+
 static inline void freezer_do_not_count(void) {}
 static inline void freezer_count(void) {}
 static inline int freezer_should_skip(struct task_struct *p) { return 0; }
@@ -0,0 +1,29 @@
+/*
+ * include/linux/input/touch_boost.h
+ *
+ * Early notification of touch activity, sent by touchscreen drivers
+ * before the corresponding input events are reported.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __LINUX_INPUT_TOUCH_BOOST_H
+#define __LINUX_INPUT_TOUCH_BOOST_H
+
+#include <linux/notifier.h>
+
+#define TOUCH_BOOST_FINGER_DOWN	1
+
+int touch_boost_register_notifier(struct notifier_block *nb);
+int touch_boost_unregister_notifier(struct notifier_block *nb);
+void touch_boost_notify(unsigned long event);
+
+#endif
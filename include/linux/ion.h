@@ -108,6 +108,7 @@ struct ion_heap;
 struct ion_mapper;
 struct ion_client;
 struct ion_buffer;
+struct device;
 
 #define ion_phys_addr_t unsigned long
 #define ion_virt_addr_t unsigned long
@@ -137,6 +138,7 @@ struct ion_cp_heap_pdata {
 	int (*request_region)(void *);
 	int (*release_region)(void *);
 	void *(*setup_region)(void);
+	struct device *cma_dev;
 };
 
 struct ion_co_heap_pdata {
@@ -37,8 +37,20 @@ struct tsens_device {
 	uint32_t			sensor_num;
 };
 
+#define TSENS_THRESHOLD_OFF		LONG_MIN
+
+struct tsens_threshold {
+	uint32_t			sensor_num;
+	long				low_degC;
+	long				high_degC;
+	void				(*notify)(struct tsens_threshold *th,
+						  unsigned long temp);
+};
+
 int32_t tsens_get_sensor_temp(int sensor_num, unsigned long *temp);
 int32_t tsens_get_temp(struct tsens_device *dev, unsigned long *temp);
 int msm_tsens_early_init(struct tsens_platform_data *pdata);
+int tsens_set_threshold(struct tsens_threshold *th);
+void tsens_cancel_threshold(struct tsens_threshold *th);
 
 #endif 
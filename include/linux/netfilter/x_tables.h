@@ -375,6 +375,9 @@ extern struct xt_table_info *xt_replace_table(struct xt_table *table,
 					      struct xt_table_info *newinfo,
 					      int *error);
 
+extern int xt_register_table_notifier(struct notifier_block *nb);
+extern int xt_unregister_table_notifier(struct notifier_block *nb);
+
 extern struct xt_match *xt_find_match(u8 af, const char *name, u8 revision);
 extern struct xt_target *xt_find_target(u8 af, const char *name, u8 revision);
 extern struct xt_match *xt_request_find_match(u8 af, const char *name,
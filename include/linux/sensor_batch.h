@@ -0,0 +1,96 @@
+/* include/linux/sensor_batch.h
+ *
+ * Batched, timestamped delivery of motion sensor samples.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __LINUX_SENSOR_BATCH_H
+#define __LINUX_SENSOR_BATCH_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+struct sensor_batch_event {
+	__s64 timestamp;
+	__s32 data[3];
+	__u32 reserved;
+};
+
+#define SENSOR_BATCH_IOCTL_MAGIC 0xB7
+
+#define SENSOR_BATCH_IOCTL_SET_LATENCY _IOW(SENSOR_BATCH_IOCTL_MAGIC, 1, __u32)
+#define SENSOR_BATCH_IOCTL_GET_LATENCY _IOR(SENSOR_BATCH_IOCTL_MAGIC, 2, __u32)
+#define SENSOR_BATCH_IOCTL_FLUSH _IO(SENSOR_BATCH_IOCTL_MAGIC, 3)
+
+#ifdef __KERNEL__
+
+#include <linux/miscdevice.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/ktime.h>
+
+#define SENSOR_BATCH_MAX_LATENCY_MS	10000
+
+struct sensor_batch {
+	struct miscdevice misc;
+	char name[32];
+
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	struct sensor_batch_event *ring;
+	unsigned int size;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int users;
+	unsigned int max_latency_ms;
+	bool ready;
+
+	u32 events;
+	u32 wakeups;
+	u32 dropped;
+
+	void (*latency_changed)(struct sensor_batch *batch);
+	void *priv;
+};
+
+#ifdef CONFIG_SENSORS_BATCH
+int sensor_batch_register(struct sensor_batch *batch, const char *name,
+			  unsigned int size);
+void sensor_batch_unregister(struct sensor_batch *batch);
+void sensor_batch_push(struct sensor_batch *batch, s64 timestamp,
+		       int x, int y, int z);
+void sensor_batch_commit(struct sensor_batch *batch, unsigned int next_ms);
+
+static inline bool sensor_batch_active(struct sensor_batch *batch)
+{
+	return batch->users && batch->max_latency_ms;
+}
+#else
+static inline int sensor_batch_register(struct sensor_batch *batch,
+					const char *name, unsigned int size)
+{
+	return 0;
+}
+static inline void sensor_batch_unregister(struct sensor_batch *batch) {}
+static inline void sensor_batch_push(struct sensor_batch *batch,
+				     s64 timestamp, int x, int y, int z) {}
+static inline void sensor_batch_commit(struct sensor_batch *batch,
+				       unsigned int next_ms) {}
+static inline bool sensor_batch_active(struct sensor_batch *batch)
+{
+	return false;
+}
+#endif
+
+#endif
+
+#endif
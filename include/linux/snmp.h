@@ -201,6 +201,7 @@ enum
 	LINUX_MIB_TCPREQQFULLDROP,		
 	LINUX_MIB_TCPRETRANSFAIL,		
 	LINUX_MIB_TCPRCVCOALESCE,			
+	LINUX_MIB_TCPSMALLQUEUETHROTTLED,	
 	__LINUX_MIB_MAX
 };
 
@@ -0,0 +1,81 @@
+/* include/linux/taskstats_bulk.h
+ *
+ * Bulk binary snapshot of per-task statistics.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __LINUX_TASKSTATS_BULK_H
+#define __LINUX_TASKSTATS_BULK_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define TSB_VERSION		1
+#define TSB_COMM_LEN		16
+#define TSB_MAX_PIDS		64
+
+/* tsb_filter.flags */
+#define TSB_FILTER_UID		0x1	/* only tasks owned by filter.uid */
+#define TSB_FILTER_PIDS		0x2	/* only the tgids in filter.pids */
+#define TSB_THREADS		0x4	/* one record per thread */
+#define TSB_CHANGED		0x8	/* only tasks changed since last read */
+
+/* tsb_header.flags */
+#define TSB_TRUNCATED		0x1	/* buffer too small, read again */
+
+/* tsb_record.flags */
+#define TSB_RECORD_EXITED	0x1	/* gone since the previous read */
+
+struct tsb_filter {
+	__u32 flags;
+	__u32 uid;
+	__u32 nr_pids;
+	__u32 pids[TSB_MAX_PIDS];
+};
+
+struct tsb_header {
+	__u16 version;
+	__u16 record_size;
+	__u32 flags;
+	__u64 generation;
+	__u64 since;
+	__u32 nr_records;
+	__u32 nr_tasks;
+};
+
+struct tsb_record {
+	__u32 pid;
+	__u32 tgid;
+	__u32 ppid;
+	__u32 uid;
+	__u64 utime;		/* clock ticks */
+	__u64 stime;		/* clock ticks */
+	__u64 minflt;
+	__u64 majflt;
+	__u64 rss;		/* pages */
+	__u64 vsize;		/* bytes */
+	__u64 start_time;	/* clock ticks after boot */
+	__s32 nice;
+	__s32 oom_score_adj;
+	__u32 nr_threads;
+	__u8 state;		/* as in /proc/<pid>/stat */
+	__u8 flags;
+	__u8 pad[2];
+	char comm[TSB_COMM_LEN];
+};
+
+#define TSB_IOC_MAGIC 0xB8
+
+#define TSB_IOC_SET_FILTER _IOW(TSB_IOC_MAGIC, 1, struct tsb_filter)
+#define TSB_IOC_RESET _IO(TSB_IOC_MAGIC, 2)
+
+#endif
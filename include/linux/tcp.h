@@ -351,6 +351,9 @@ struct tcp_sock {
 	u32	prr_delivered;	
 	u32	prr_out;	
 
+	struct list_head tsq_node; 
+	unsigned long	tsq_flags;
+
  	u32	rcv_wnd;	
 	u32	write_seq;	
 	u32	pushed_seq;	
@@ -420,6 +423,12 @@ struct tcp_sock {
 	struct tcp_cookie_values  *cookie_values;
 };
 
+enum tsq_flags {
+	TSQ_THROTTLED,
+	TSQ_QUEUED,
+	TSQ_OWNED, 
+};
+
 static inline struct tcp_sock *tcp_sk(const struct sock *sk)
 {
 	return (struct tcp_sock *)sk;
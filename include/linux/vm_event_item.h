@@ -52,6 +52,11 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		UNEVICTABLE_PGCLEARED,	
 		UNEVICTABLE_PGSTRANDED,	
 		UNEVICTABLE_MLOCKFREED,
+#ifdef CONFIG_PROCESS_RECLAIM
+		PROC_RECLAIM_SCANNED,
+		PROC_RECLAIM_ANON,
+		PROC_RECLAIM_FILE,
+#endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 		THP_FAULT_ALLOC,
 		THP_FAULT_FALLBACK,
@@ -14,11 +14,14 @@
 #ifndef VIDC_INIT_H
 #define VIDC_INIT_H
 #include <linux/ion.h>
+#include <linux/ktime.h>
 #include <media/msm/vidc_type.h>
 #include <media/msm/vcd_property.h>
 
 #define VIDC_MAX_NUM_CLIENTS 4
 #define MAX_VIDEO_NUM_OF_BUFF 100
+#define VIDC_ADDR_HASH_BITS 8
+#define VIDC_ADDR_HASH_SIZE (1 << VIDC_ADDR_HASH_BITS)
 
 enum buffer_dir {
 	BUFFER_TYPE_INPUT,
@@ -37,12 +40,19 @@ struct buf_addr_table {
 	void *client_data;
 };
 
+struct buf_addr_hash {
+	u8 user_vaddr[VIDC_ADDR_HASH_SIZE];
+	u8 kernel_vaddr[VIDC_ADDR_HASH_SIZE];
+};
+
 struct video_client_ctx {
 	void *vcd_handle;
 	u32 num_of_input_buffers;
 	u32 num_of_output_buffers;
 	struct buf_addr_table input_buf_addr_table[MAX_VIDEO_NUM_OF_BUFF];
 	struct buf_addr_table output_buf_addr_table[MAX_VIDEO_NUM_OF_BUFF];
+	struct buf_addr_hash input_buf_addr_hash;
+	struct buf_addr_hash output_buf_addr_hash;
 	struct list_head msg_queue;
 	struct mutex msg_queue_lock;
 	struct mutex enrty_queue_lock;
@@ -89,6 +99,10 @@ u32 vidc_delete_addr_table(struct video_client_ctx *client_ctx,
 	unsigned long *kernel_vaddr);
 void vidc_cleanup_addr_table(struct video_client_ctx *client_ctx,
 		enum buffer_dir buffer);
+void vidc_cache_op(struct video_client_ctx *client_ctx,
+	struct ion_handle *buff_handle, void *vaddr,
+	unsigned long len, unsigned int cmd);
+void vidc_frame_overhead(ktime_t start);
 
 u32 vidc_timer_create(void (*timer_handler)(void *),
 	void *user_data, void **timer_handle);
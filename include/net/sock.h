@@ -683,6 +683,8 @@ struct proto {
 	int			(*backlog_rcv) (struct sock *sk, 
 						struct sk_buff *skb);
 
+	void		(*release_cb)(struct sock *sk);
+
 	
 	void			(*hash)(struct sock *sk);
 	void			(*unhash)(struct sock *sk);
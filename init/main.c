@@ -68,6 +68,7 @@
 #include <linux/shmem_fs.h>
 #include <linux/slab.h>
 #include <linux/perf_event.h>
+#include <linux/boot_timeline.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -606,11 +607,15 @@ int __init_or_module do_one_initcall(initcall_t fn)
 	int count = preempt_count();
 	int ret;
 
+	ktime_t start = boot_timeline_begin();
+
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
 
+	boot_timeline_add(BOOT_TL_INITCALL, start, ret, "%pf", fn);
+
 	msgbuf[0] = 0;
 
 	if (ret && ret != -ENODEV && initcall_debug)
@@ -670,6 +675,7 @@ static void __init do_initcall_level(int level)
 {
 	extern const struct kernel_param __start___param[], __stop___param[];
 	initcall_t *fn;
+	ktime_t start = boot_timeline_begin();
 
 	strcpy(static_command_line, saved_command_line);
 	parse_args(initcall_level_names[level],
@@ -680,14 +686,19 @@ static void __init do_initcall_level(int level)
 
 	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
 		do_one_initcall(*fn);
+
+	boot_timeline_add(BOOT_TL_LEVEL, start, 0, "%d", level);
 }
 
 static void __init do_initcalls(void)
 {
 	int level;
 
-	for (level = 0; level < ARRAY_SIZE(initcall_levels) - 1; level++)
+	for (level = 0; level < ARRAY_SIZE(initcall_levels) - 1; level++) {
+		if (level == ARRAY_SIZE(initcall_levels) - 2)
+			device_async_synchronize();
 		do_initcall_level(level);
+	}
 }
 
 static void __init do_basic_setup(void)
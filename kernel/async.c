@@ -20,6 +20,7 @@
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
+#include <linux/boot_timeline.h>
 
 static async_cookie_t next_cookie = 1;
 
@@ -77,6 +78,7 @@ static void async_run_entry_fn(struct work_struct *work)
 		container_of(work, struct async_entry, work);
 	unsigned long flags;
 	ktime_t uninitialized_var(calltime), delta, rettime;
+	ktime_t start = boot_timeline_begin();
 
 	
 	spin_lock_irqsave(&async_lock, flags);
@@ -91,6 +93,8 @@ static void async_run_entry_fn(struct work_struct *work)
 		calltime = ktime_get();
 	}
 	entry->func(entry->data, entry->cookie);
+	boot_timeline_add(BOOT_TL_ASYNC, start, 0, "%lli_%pf",
+			  (long long)entry->cookie, entry->func);
 	if (initcall_debug && system_state == SYSTEM_BOOTING) {
 		rettime = ktime_get();
 		delta = ktime_sub(rettime, calltime);
@@ -0,0 +1,121 @@
+/*
+ * boot_timeline.c: boot time initcall/probe/async timeline
+ *
+ * Every initcall level, initcall, driver probe and async call made
+ * while the system is booting is recorded with its start and end time,
+ * cpu and task.  The result is exported in debugfs as "boot_timeline"
+ * and can be rendered with tools/boot/boot_timeline.py.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include <linux/boot_timeline.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/export.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/smp.h>
+
+#define BOOT_TIMELINE_ENTRIES	CONFIG_BOOT_TIMELINE_ENTRIES
+#define BOOT_TIMELINE_NAME_LEN	48
+
+struct boot_timeline_entry {
+	s64 start_us;
+	s64 end_us;
+	int ret;
+	pid_t pid;
+	u16 cpu;
+	u8 type;
+	u8 valid;
+	char name[BOOT_TIMELINE_NAME_LEN];
+};
+
+static struct boot_timeline_entry boot_timeline[BOOT_TIMELINE_ENTRIES];
+static atomic_t boot_timeline_next = ATOMIC_INIT(0);
+
+static const char *boot_timeline_types[] = {
+	[BOOT_TL_LEVEL]		= "level",
+	[BOOT_TL_INITCALL]	= "initcall",
+	[BOOT_TL_PROBE]		= "probe",
+	[BOOT_TL_ASYNC]		= "async",
+};
+
+void boot_timeline_add(enum boot_timeline_type type, ktime_t start, int ret,
+		       const char *fmt, ...)
+{
+	struct boot_timeline_entry *e;
+	va_list args;
+	int idx;
+
+	if (system_state != SYSTEM_BOOTING)
+		return;
+
+	idx = atomic_inc_return(&boot_timeline_next) - 1;
+	if (idx >= BOOT_TIMELINE_ENTRIES)
+		return;
+
+	e = &boot_timeline[idx];
+	e->start_us = ktime_to_us(start);
+	e->end_us = ktime_to_us(ktime_get());
+	e->ret = ret;
+	e->pid = task_pid_nr(current);
+	e->cpu = raw_smp_processor_id();
+	e->type = type;
+
+	va_start(args, fmt);
+	vsnprintf(e->name, sizeof(e->name), fmt, args);
+	va_end(args);
+
+	smp_wmb();
+	e->valid = 1;
+}
+EXPORT_SYMBOL_GPL(boot_timeline_add);
+
+static int boot_timeline_show(struct seq_file *m, void *unused)
+{
+	int i, n = atomic_read(&boot_timeline_next);
+
+	seq_printf(m, "# type cpu pid start_us end_us ret name\n");
+	if (n > BOOT_TIMELINE_ENTRIES) {
+		seq_printf(m, "# dropped %d entries\n",
+			   n - BOOT_TIMELINE_ENTRIES);
+		n = BOOT_TIMELINE_ENTRIES;
+	}
+
+	for (i = 0; i < n; i++) {
+		struct boot_timeline_entry *e = &boot_timeline[i];
+
+		if (!e->valid)
+			continue;
+		smp_rmb();
+		seq_printf(m, "%s %u %d %lld %lld %d %s\n",
+			   boot_timeline_types[e->type], e->cpu, e->pid,
+			   e->start_us, e->end_us, e->ret, e->name);
+	}
+	return 0;
+}
+
+static int boot_timeline_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_timeline_show, NULL);
+}
+
+static const struct file_operations boot_timeline_fops = {
+	.open		= boot_timeline_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init boot_timeline_init(void)
+{
+	debugfs_create_file("boot_timeline", S_IRUGO, NULL, NULL,
+			    &boot_timeline_fops);
+	return 0;
+}
+postcore_initcall(boot_timeline_init);
@@ -21,6 +21,11 @@
 #include <linux/uaccess.h>
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/workqueue.h>
+#include <linux/oom.h>
 
 enum freezer_state {
 	CGROUP_THAWED = 0,
@@ -28,10 +33,40 @@ enum freezer_state {
 	CGROUP_FROZEN,
 };
 
+struct freezer_stats {
+	unsigned int freezes;
+	unsigned int thaws;
+	unsigned int timeouts;
+	unsigned int freeze_last_us;
+	unsigned int freeze_max_us;
+	unsigned int binder_thaws;
+	unsigned int binder_deferred;
+	unsigned int binder_rejected;
+	u64 frozen_ms;
+	u64 cpu_saved_ms;
+	u64 wakeups_saved;
+};
+
 struct freezer {
 	struct cgroup_subsys_state css;
 	enum freezer_state state;
 	spinlock_t lock; 
+
+	unsigned int freeze_timeout_ms;
+	unsigned int auto_freeze_ms;
+	int auto_min_adj;
+	unsigned long auto_since;
+	struct delayed_work auto_work;
+
+	unsigned long thawed_at;
+	unsigned long frozen_at;
+	bool sampled;
+	u64 thaw_cpu_ms;
+	u64 thaw_switches;
+	u64 rate_cpu_ms;
+	u64 rate_switches;
+	unsigned int rate_span_ms;
+	struct freezer_stats stats;
 };
 
 static inline struct freezer *cgroup_freezer(
@@ -68,11 +103,15 @@ static const char *freezer_state_strs[] = {
 };
 
 
+#define FREEZER_AUTO_MIN_ADJ	529
+
 struct cgroup_subsys freezer_subsys;
 
+static void freezer_auto_work(struct work_struct *work);
+
 static struct cgroup_subsys_state *freezer_create(struct cgroup *cgroup)
 {
-	struct freezer *freezer;
+	struct freezer *freezer, *parent;
 
 	freezer = kzalloc(sizeof(struct freezer), GFP_KERNEL);
 	if (!freezer)
@@ -80,6 +119,16 @@ static struct cgroup_subsys_state *freezer_create(struct cgroup *cgroup)
 
 	spin_lock_init(&freezer->lock);
 	freezer->state = CGROUP_THAWED;
+	freezer->auto_min_adj = FREEZER_AUTO_MIN_ADJ;
+	freezer->thawed_at = jiffies;
+	INIT_DELAYED_WORK_DEFERRABLE(&freezer->auto_work, freezer_auto_work);
+
+	if (cgroup->parent) {
+		parent = cgroup_freezer(cgroup->parent);
+		freezer->freeze_timeout_ms = parent->freeze_timeout_ms;
+		freezer->auto_freeze_ms = parent->auto_freeze_ms;
+		freezer->auto_min_adj = parent->auto_min_adj;
+	}
 	return &freezer->css;
 }
 
@@ -87,6 +136,7 @@ static void freezer_destroy(struct cgroup *cgroup)
 {
 	struct freezer *freezer = cgroup_freezer(cgroup);
 
+	cancel_delayed_work_sync(&freezer->auto_work);
 	if (freezer->state != CGROUP_THAWED)
 		atomic_dec(&system_freezing_cnt);
 	kfree(freezer);
@@ -103,18 +153,41 @@ static int freezer_can_attach(struct cgroup *new_cgroup,
 {
 	struct freezer *freezer;
 	struct task_struct *task;
+	enum freezer_state state;
 
 	cgroup_taskset_for_each(task, new_cgroup, tset)
 		if (cgroup_freezing(task))
 			return -EBUSY;
 
 	freezer = cgroup_freezer(new_cgroup);
-	if (freezer->state != CGROUP_THAWED)
+	spin_lock_irq(&freezer->lock);
+	state = freezer->state;
+	spin_unlock_irq(&freezer->lock);
+	if (state != CGROUP_THAWED)
 		return -EBUSY;
 
 	return 0;
 }
 
+/*
+ * The automatic freeze runs without cgroup_mutex, so the group may have
+ * started freezing since can_attach.  Freeze the new tasks along with it.
+ */
+static void freezer_attach(struct cgroup *new_cgroup,
+			   struct cgroup_taskset *tset)
+{
+	struct freezer *freezer = cgroup_freezer(new_cgroup);
+	struct task_struct *task;
+
+	spin_lock_irq(&freezer->lock);
+	if (freezer->state != CGROUP_THAWED) {
+		freezer->state = CGROUP_FREEZING;
+		cgroup_taskset_for_each(task, new_cgroup, tset)
+			freeze_task(task);
+	}
+	spin_unlock_irq(&freezer->lock);
+}
+
 static void freezer_fork(struct task_struct *task)
 {
 	struct freezer *freezer;
@@ -127,11 +200,11 @@ static void freezer_fork(struct task_struct *task)
 		return;
 
 	spin_lock_irq(&freezer->lock);
-	BUG_ON(freezer->state == CGROUP_FROZEN);
-
-	
-	if (freezer->state == CGROUP_FREEZING)
+	/* a FROZEN group can gain a task through a racing attach */
+	if (freezer->state != CGROUP_THAWED) {
+		freezer->state = CGROUP_FREEZING;
 		freeze_task(task);
+	}
 	spin_unlock_irq(&freezer->lock);
 }
 
@@ -145,6 +218,8 @@ static void update_if_frozen(struct cgroup *cgroup,
 
 	cgroup_iter_start(cgroup, &it);
 	while ((task = cgroup_iter_next(cgroup, &it))) {
+		if (__fatal_signal_pending(task))
+			continue;
 		ntotal++;
 		if (freezing(task) && is_task_frozen_enough(task))
 			nfrozen++;
@@ -155,8 +230,8 @@ static void update_if_frozen(struct cgroup *cgroup,
 	} else if (old_state == CGROUP_FREEZING) {
 		if (nfrozen == ntotal)
 			freezer->state = CGROUP_FROZEN;
-	} else { 
-		BUG_ON(nfrozen != ntotal);
+	} else if (nfrozen != ntotal) {
+		freezer->state = CGROUP_FREEZING;
 	}
 
 	cgroup_iter_end(cgroup, &it);
@@ -217,6 +292,237 @@ static void unfreeze_cgroup(struct cgroup *cgroup, struct freezer *freezer)
 	cgroup_iter_end(cgroup, &it);
 }
 
+static void freezer_sample(struct freezer *freezer, u64 *cpu_ms,
+			   u64 *switches)
+{
+	struct cgroup *cgroup = freezer->css.cgroup;
+	struct cgroup_iter it;
+	struct task_struct *task;
+	u64 cpu_ns = 0;
+
+	*switches = 0;
+	cgroup_iter_start(cgroup, &it);
+	while ((task = cgroup_iter_next(cgroup, &it))) {
+		cpu_ns += task->se.sum_exec_runtime;
+		*switches += task->nvcsw + task->nivcsw;
+	}
+	cgroup_iter_end(cgroup, &it);
+	*cpu_ms = div_u64(cpu_ns, NSEC_PER_MSEC);
+}
+
+/*
+ * What a group would have burnt while frozen is estimated from its CPU
+ * time and context switches over the thawed period just before the
+ * freeze, so nothing is credited until the group has been thawed once.
+ */
+static void freezer_account_freeze(struct freezer *freezer)
+{
+	u64 cpu_ms, switches;
+
+	freezer->stats.freezes++;
+	freezer->frozen_at = jiffies;
+	freezer->rate_span_ms = 0;
+	if (!freezer->sampled)
+		return;
+
+	freezer_sample(freezer, &cpu_ms, &switches);
+	freezer->rate_span_ms = jiffies_to_msecs(jiffies - freezer->thawed_at);
+	freezer->rate_cpu_ms = cpu_ms > freezer->thaw_cpu_ms ?
+				cpu_ms - freezer->thaw_cpu_ms : 0;
+	freezer->rate_switches = switches > freezer->thaw_switches ?
+				switches - freezer->thaw_switches : 0;
+}
+
+static void freezer_account_thaw(struct freezer *freezer)
+{
+	unsigned int frozen_ms;
+
+	frozen_ms = jiffies_to_msecs(jiffies - freezer->frozen_at);
+	freezer->stats.thaws++;
+	freezer->stats.frozen_ms += frozen_ms;
+	if (freezer->rate_span_ms) {
+		freezer->stats.cpu_saved_ms += div_u64(freezer->rate_cpu_ms *
+				frozen_ms, freezer->rate_span_ms);
+		freezer->stats.wakeups_saved += div_u64(freezer->rate_switches *
+				frozen_ms, freezer->rate_span_ms);
+	}
+
+	freezer_sample(freezer, &freezer->thaw_cpu_ms, &freezer->thaw_switches);
+	freezer->thawed_at = jiffies;
+	freezer->sampled = true;
+}
+
+static void freezer_thaw_locked(struct freezer *freezer)
+{
+	if (freezer->state != CGROUP_THAWED) {
+		atomic_dec(&system_freezing_cnt);
+		freezer_account_thaw(freezer);
+	}
+	freezer->state = CGROUP_THAWED;
+	unfreeze_cgroup(freezer->css.cgroup, freezer);
+}
+
+static int freezer_freeze_locked(struct freezer *freezer)
+{
+	if (freezer->state == CGROUP_THAWED) {
+		atomic_inc(&system_freezing_cnt);
+		freezer_account_freeze(freezer);
+	}
+	freezer->state = CGROUP_FREEZING;
+	return try_to_freeze_cgroup(freezer->css.cgroup, freezer);
+}
+
+/*
+ * Wait, without cgroup_mutex, for a group that was just told to freeze.
+ * If it is not frozen within freeze_timeout_ms it is thawed back, so the
+ * caller sees either a frozen group or an untouched one.
+ */
+static int freezer_wait_frozen(struct freezer *freezer, ktime_t start)
+{
+	s64 us;
+	int ret = 0;
+
+	if (!freezer->freeze_timeout_ms)
+		return 0;
+
+	spin_lock_irq(&freezer->lock);
+	for (;;) {
+		if (freezer->state == CGROUP_FREEZING)
+			update_if_frozen(freezer->css.cgroup, freezer);
+		if (freezer->state != CGROUP_FREEZING)
+			break;
+		us = ktime_us_delta(ktime_get(), start);
+		if (us >= (s64)freezer->freeze_timeout_ms * USEC_PER_MSEC) {
+			freezer->stats.timeouts++;
+			freezer_thaw_locked(freezer);
+			break;
+		}
+		spin_unlock_irq(&freezer->lock);
+		usleep_range(500, 1000);
+		spin_lock_irq(&freezer->lock);
+	}
+
+	if (freezer->state == CGROUP_FROZEN) {
+		us = ktime_us_delta(ktime_get(), start);
+		freezer->stats.freeze_last_us = us;
+		if (us > freezer->stats.freeze_max_us)
+			freezer->stats.freeze_max_us = us;
+	} else {
+		ret = -EBUSY;
+	}
+	spin_unlock_irq(&freezer->lock);
+
+	return ret;
+}
+
+static bool freezer_all_cached(struct freezer *freezer)
+{
+	struct cgroup *cgroup = freezer->css.cgroup;
+	struct cgroup_iter it;
+	struct task_struct *task;
+	bool cached = false;
+
+	cgroup_iter_start(cgroup, &it);
+	while ((task = cgroup_iter_next(cgroup, &it))) {
+		if (task->signal->oom_score_adj < freezer->auto_min_adj) {
+			cached = false;
+			break;
+		}
+		cached = true;
+	}
+	cgroup_iter_end(cgroup, &it);
+
+	return cached;
+}
+
+static void freezer_auto_arm(struct freezer *freezer)
+{
+	freezer->auto_since = jiffies;
+	schedule_delayed_work(&freezer->auto_work,
+			      msecs_to_jiffies(freezer->auto_freeze_ms));
+}
+
+static void freezer_auto_work(struct work_struct *work)
+{
+	struct freezer *freezer = container_of(to_delayed_work(work),
+					       struct freezer, auto_work);
+	ktime_t start = ktime_get();
+	unsigned long due;
+
+	spin_lock_irq(&freezer->lock);
+	if (!freezer->auto_freeze_ms || freezer->state != CGROUP_THAWED ||
+	    !freezer_all_cached(freezer))
+		goto out;
+
+	due = freezer->auto_since + msecs_to_jiffies(freezer->auto_freeze_ms);
+	if (time_before(jiffies, due)) {
+		schedule_delayed_work(&freezer->auto_work, due - jiffies);
+		goto out;
+	}
+
+	freezer_freeze_locked(freezer);
+	spin_unlock_irq(&freezer->lock);
+
+	freezer_wait_frozen(freezer, start);
+	return;
+out:
+	spin_unlock_irq(&freezer->lock);
+}
+
+void cgroup_freezer_adj_changed(struct task_struct *task)
+{
+	struct freezer *freezer;
+	unsigned long flags;
+
+	rcu_read_lock();
+	freezer = task_freezer(task);
+	if (!freezer->css.cgroup->parent || !freezer->auto_freeze_ms)
+		goto out;
+
+	spin_lock_irqsave(&freezer->lock, flags);
+	if (task->signal->oom_score_adj < freezer->auto_min_adj) {
+		if (freezer->state != CGROUP_THAWED)
+			freezer_thaw_locked(freezer);
+	} else if (freezer->state == CGROUP_THAWED)
+		freezer_auto_arm(freezer);
+	spin_unlock_irqrestore(&freezer->lock, flags);
+out:
+	rcu_read_unlock();
+}
+
+int cgroup_freezer_ipc(struct task_struct *task, bool oneway)
+{
+	struct freezer *freezer;
+	unsigned long flags;
+	int ret = 0;
+
+	if (likely(!atomic_read(&system_freezing_cnt)))
+		return 0;
+
+	rcu_read_lock();
+	freezer = task_freezer(task);
+	spin_lock_irqsave(&freezer->lock, flags);
+	if (freezer->state == CGROUP_THAWED)
+		goto out;
+
+	if (oneway) {
+		freezer->stats.binder_deferred++;
+	} else if (freezer->auto_freeze_ms) {
+		freezer->stats.binder_thaws++;
+		freezer_thaw_locked(freezer);
+		freezer_auto_arm(freezer);
+	} else {
+		freezer->stats.binder_rejected++;
+		ret = -EBUSY;
+	}
+out:
+	spin_unlock_irqrestore(&freezer->lock, flags);
+	rcu_read_unlock();
+
+	return ret;
+}
+EXPORT_SYMBOL(cgroup_freezer_ipc);
+
 static int freezer_change_state(struct cgroup *cgroup,
 				enum freezer_state goal_state)
 {
@@ -231,16 +537,10 @@ static int freezer_change_state(struct cgroup *cgroup,
 
 	switch (goal_state) {
 	case CGROUP_THAWED:
-		if (freezer->state != CGROUP_THAWED)
-			atomic_dec(&system_freezing_cnt);
-		freezer->state = CGROUP_THAWED;
-		unfreeze_cgroup(cgroup, freezer);
+		freezer_thaw_locked(freezer);
 		break;
 	case CGROUP_FROZEN:
-		if (freezer->state == CGROUP_THAWED)
-			atomic_inc(&system_freezing_cnt);
-		freezer->state = CGROUP_FREEZING;
-		retval = try_to_freeze_cgroup(cgroup, freezer);
+		retval = freezer_freeze_locked(freezer);
 		break;
 	default:
 		BUG();
@@ -257,6 +557,7 @@ static int freezer_write(struct cgroup *cgroup,
 {
 	int retval;
 	enum freezer_state goal_state;
+	ktime_t start = ktime_get();
 
 	if (strcmp(buffer, freezer_state_strs[CGROUP_THAWED]) == 0)
 		goal_state = CGROUP_THAWED;
@@ -269,15 +570,106 @@ static int freezer_write(struct cgroup *cgroup,
 		return -ENODEV;
 	retval = freezer_change_state(cgroup, goal_state);
 	cgroup_unlock();
+
+	if (!retval && goal_state == CGROUP_FROZEN)
+		retval = freezer_wait_frozen(cgroup_freezer(cgroup), start);
 	return retval;
 }
 
+static u64 freezer_read_u64(struct cgroup *cgroup, struct cftype *cft)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+
+	if (cft->private)
+		return freezer->auto_freeze_ms;
+	return freezer->freeze_timeout_ms;
+}
+
+static int freezer_write_u64(struct cgroup *cgroup, struct cftype *cft,
+			     u64 val)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+
+	if (val > UINT_MAX)
+		return -EINVAL;
+
+	spin_lock_irq(&freezer->lock);
+	if (!cft->private) {
+		freezer->freeze_timeout_ms = val;
+	} else {
+		freezer->auto_freeze_ms = val;
+		if (val)
+			freezer_auto_arm(freezer);
+	}
+	spin_unlock_irq(&freezer->lock);
+
+	if (cft->private && !val)
+		cancel_delayed_work_sync(&freezer->auto_work);
+	return 0;
+}
+
+static s64 freezer_read_adj(struct cgroup *cgroup, struct cftype *cft)
+{
+	return cgroup_freezer(cgroup)->auto_min_adj;
+}
+
+static int freezer_write_adj(struct cgroup *cgroup, struct cftype *cft,
+			     s64 val)
+{
+	if (val < OOM_SCORE_ADJ_MIN || val > OOM_SCORE_ADJ_MAX)
+		return -EINVAL;
+	cgroup_freezer(cgroup)->auto_min_adj = val;
+	return 0;
+}
+
+static int freezer_read_stats(struct cgroup *cgroup, struct cftype *cft,
+			      struct seq_file *m)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct freezer_stats stats;
+
+	spin_lock_irq(&freezer->lock);
+	stats = freezer->stats;
+	spin_unlock_irq(&freezer->lock);
+
+	seq_printf(m, "freezes %u\nthaws %u\ntimeouts %u\n",
+		   stats.freezes, stats.thaws, stats.timeouts);
+	seq_printf(m, "freeze_last_us %u\nfreeze_max_us %u\n",
+		   stats.freeze_last_us, stats.freeze_max_us);
+	seq_printf(m, "frozen_ms %llu\ncpu_saved_ms %llu\nwakeups_saved %llu\n",
+		   stats.frozen_ms, stats.cpu_saved_ms, stats.wakeups_saved);
+	seq_printf(m, "binder_thaws %u\nbinder_deferred %u\n"
+		   "binder_rejected %u\n", stats.binder_thaws,
+		   stats.binder_deferred, stats.binder_rejected);
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "state",
 		.read_seq_string = freezer_read,
 		.write_string = freezer_write,
 	},
+	{
+		.name = "freeze_timeout_ms",
+		.read_u64 = freezer_read_u64,
+		.write_u64 = freezer_write_u64,
+	},
+	{
+		.name = "auto_freeze_ms",
+		.read_u64 = freezer_read_u64,
+		.write_u64 = freezer_write_u64,
+		.private = 1,
+	},
+	{
+		.name = "auto_min_adj",
+		.read_s64 = freezer_read_adj,
+		.write_s64 = freezer_write_adj,
+	},
+	{
+		.name = "stats",
+		.read_seq_string = freezer_read_stats,
+	},
 };
 
 static int freezer_populate(struct cgroup_subsys *ss, struct cgroup *cgroup)
@@ -294,5 +686,6 @@ struct cgroup_subsys freezer_subsys = {
 	.populate	= freezer_populate,
 	.subsys_id	= freezer_subsys_id,
 	.can_attach	= freezer_can_attach,
+	.attach		= freezer_attach,
 	.fork		= freezer_fork,
 };
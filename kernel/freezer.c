@@ -19,7 +19,10 @@ bool freezing_slow_path(struct task_struct *p)
 	if (p->flags & PF_NOFREEZE)
 		return false;
 
-	if (pm_nosig_freezing || cgroup_freezing(p))
+	if (pm_nosig_freezing)
+		return true;
+
+	if (cgroup_freezing(p) && !__fatal_signal_pending(p))
 		return true;
 
 	if (pm_freezing && !(p->flags & PF_KTHREAD))
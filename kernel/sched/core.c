@@ -72,6 +72,7 @@
 #include <linux/slab.h>
 #include <linux/init_task.h>
 #include <linux/binfmts.h>
+#include <linux/cpufreq.h>
 
 #include <asm/switch_to.h>
 #include <asm/tlb.h>
@@ -2339,6 +2340,7 @@ void scheduler_tick(void)
 	curr->sched_class->task_tick(rq, curr, 0);
 	raw_spin_unlock(&rq->lock);
 
+	cpufreq_stats_tick(curr);
 	perf_event_task_tick();
 
 #ifdef CONFIG_SMP
@@ -2503,6 +2505,7 @@ need_resched:
 		rq->curr = next;
 		++*switch_count;
 
+		cpufreq_stats_task_switch(prev, next);
 		context_switch(rq, prev, next); 
 		cpu = smp_processor_id();
 		rq = cpu_rq(cpu);
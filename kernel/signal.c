@@ -514,6 +514,8 @@ void signal_wake_up(struct task_struct *t, int resume)
 	mask = TASK_INTERRUPTIBLE;
 	if (resume)
 		mask |= TASK_WAKEKILL;
+	if (unlikely(frozen(t)) && __fatal_signal_pending(t))
+		mask |= TASK_UNINTERRUPTIBLE;
 	if (!wake_up_state(t, mask))
 		kick_process(t);
 }
@@ -0,0 +1,390 @@
+/* kernel/taskstats_bulk.c
+ *
+ * Bulk binary snapshot of per-task statistics.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/bsearch.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/taskstats_bulk.h>
+
+#define E(x...) printk(KERN_ERR "[TSB] " x)
+
+#define TSB_MAX_RECORDS		8192
+#define TSB_SNAP_SLACK		64
+
+static const char tsb_state_chars[] = "RSDTtZXxKW";
+
+struct tsb_snap {
+	pid_t pid;
+	unsigned long rss;
+	u64 cputime;
+	u64 faults;
+};
+
+struct tsb_file {
+	struct mutex lock;
+	struct tsb_filter filter;
+	u64 generation;
+	struct tsb_snap *snap;
+	unsigned int nr_snap;
+};
+
+struct tsb_scan {
+	struct tsb_file *tf;
+	struct tsb_record *recs;
+	unsigned int max_records;
+	unsigned int nr_records;
+	struct tsb_snap *snap;
+	unsigned int max_snap;
+	unsigned int nr_snap;
+	unsigned int nr_tasks;
+	bool truncated;
+};
+
+static int tsb_snap_cmp(const void *a, const void *b)
+{
+	const struct tsb_snap *x = a, *y = b;
+
+	if (x->pid < y->pid)
+		return -1;
+	return x->pid > y->pid;
+}
+
+static struct tsb_snap *tsb_snap_find(struct tsb_snap *snap, unsigned int nr,
+				      pid_t pid)
+{
+	struct tsb_snap key = { .pid = pid };
+
+	if (!snap)
+		return NULL;
+	return bsearch(&key, snap, nr, sizeof(*snap), tsb_snap_cmp);
+}
+
+static bool tsb_match(struct tsb_filter *f, struct task_struct *p)
+{
+	unsigned int i;
+	pid_t tgid;
+
+	if ((f->flags & TSB_FILTER_UID) && task_uid(p) != f->uid)
+		return false;
+	if (!(f->flags & TSB_FILTER_PIDS))
+		return true;
+
+	tgid = task_tgid_vnr(p);
+	for (i = 0; i < f->nr_pids; i++)
+		if (f->pids[i] == tgid)
+			return true;
+	return false;
+}
+
+static void tsb_fill(struct task_struct *t, bool whole, struct tsb_record *r,
+		     struct tsb_snap *s)
+{
+	unsigned int state = (t->state & TASK_REPORT) | t->exit_state;
+	cputime_t utime = 0, stime = 0;
+	struct mm_struct *mm;
+	unsigned long flags;
+
+	memset(r, 0, sizeof(*r));
+	r->pid = task_pid_vnr(t);
+	r->tgid = task_tgid_vnr(t);
+	r->ppid = task_tgid_vnr(rcu_dereference(t->real_parent));
+	r->uid = task_uid(t);
+	r->nice = task_nice(t);
+	r->state = tsb_state_chars[min_t(unsigned int, fls(state),
+					 sizeof(tsb_state_chars) - 2)];
+	r->start_time = nsec_to_clock_t(timespec_to_ns(&t->real_start_time));
+
+	task_lock(t);
+	mm = t->mm;
+	if (mm) {
+		r->rss = get_mm_rss(mm);
+		r->vsize = (u64)mm->total_vm << PAGE_SHIFT;
+	}
+	strlcpy(r->comm, t->comm, sizeof(r->comm));
+	task_unlock(t);
+
+	if (lock_task_sighand(t, &flags)) {
+		struct signal_struct *sig = t->signal;
+
+		r->nr_threads = get_nr_threads(t);
+		r->oom_score_adj = sig->oom_score_adj;
+		if (whole) {
+			struct task_struct *th = t;
+
+			do {
+				r->minflt += th->min_flt;
+				r->majflt += th->maj_flt;
+				th = next_thread(th);
+			} while (th != t);
+			r->minflt += sig->min_flt;
+			r->majflt += sig->maj_flt;
+			thread_group_times(t, &utime, &stime);
+		}
+		unlock_task_sighand(t, &flags);
+	}
+	if (!whole) {
+		r->minflt = t->min_flt;
+		r->majflt = t->maj_flt;
+		task_times(t, &utime, &stime);
+	}
+	r->utime = cputime_to_clock_t(utime);
+	r->stime = cputime_to_clock_t(stime);
+
+	s->pid = r->pid;
+	s->rss = r->rss;
+	s->cputime = (u64)utime + stime;
+	s->faults = r->minflt + r->majflt;
+}
+
+static void tsb_add(struct tsb_scan *sc, struct task_struct *t, bool whole)
+{
+	struct tsb_file *tf = sc->tf;
+	struct tsb_record r;
+	struct tsb_snap s, *old = NULL;
+
+	if (sc->nr_snap >= sc->max_snap) {
+		sc->truncated = true;
+		return;
+	}
+	sc->nr_tasks++;
+
+	tsb_fill(t, whole, &r, &s);
+
+	if (tf->filter.flags & TSB_CHANGED) {
+		old = tsb_snap_find(tf->snap, tf->nr_snap, s.pid);
+		if (old && old->cputime == s.cputime &&
+		    old->faults == s.faults && old->rss == s.rss) {
+			sc->snap[sc->nr_snap++] = s;
+			return;
+		}
+	}
+
+	if (sc->nr_records >= sc->max_records) {
+		/* not reported: keep what the reader last saw */
+		sc->truncated = true;
+		if (old)
+			s = *old;
+		else
+			s.cputime = ~0ULL;
+		sc->snap[sc->nr_snap++] = s;
+		return;
+	}
+
+	sc->recs[sc->nr_records++] = r;
+	sc->snap[sc->nr_snap++] = s;
+}
+
+static void tsb_add_exited(struct tsb_scan *sc)
+{
+	struct tsb_file *tf = sc->tf;
+	unsigned int i, nr = sc->nr_snap;
+	struct tsb_record *r;
+
+	for (i = 0; i < tf->nr_snap; i++) {
+		struct tsb_snap *old = &tf->snap[i];
+
+		if (tsb_snap_find(sc->snap, nr, old->pid))
+			continue;
+		if (sc->nr_records < sc->max_records) {
+			r = &sc->recs[sc->nr_records++];
+			memset(r, 0, sizeof(*r));
+			r->pid = old->pid;
+			r->state = 'X';
+			r->flags = TSB_RECORD_EXITED;
+		} else {
+			sc->truncated = true;
+			if (sc->nr_snap < sc->max_snap)
+				sc->snap[sc->nr_snap++] = *old;
+		}
+	}
+	if (sc->nr_snap != nr)
+		sort(sc->snap, sc->nr_snap, sizeof(*sc->snap), tsb_snap_cmp,
+		     NULL);
+}
+
+static int tsb_open(struct inode *inode, struct file *file)
+{
+	struct tsb_file *tf;
+
+	tf = kzalloc(sizeof(*tf), GFP_KERNEL);
+	if (!tf)
+		return -ENOMEM;
+	mutex_init(&tf->lock);
+	file->private_data = tf;
+
+	return nonseekable_open(inode, file);
+}
+
+static int tsb_release(struct inode *inode, struct file *file)
+{
+	struct tsb_file *tf = file->private_data;
+
+	vfree(tf->snap);
+	kfree(tf);
+	return 0;
+}
+
+static ssize_t tsb_read(struct file *file, char __user *buf, size_t count,
+			loff_t *ppos)
+{
+	struct tsb_file *tf = file->private_data;
+	struct task_struct *p, *t;
+	struct tsb_header hdr;
+	struct tsb_scan sc;
+	bool threads;
+	size_t len;
+	ssize_t ret;
+
+	if (count < sizeof(hdr) + sizeof(struct tsb_record))
+		return -EINVAL;
+
+	memset(&sc, 0, sizeof(sc));
+	sc.tf = tf;
+	sc.max_records = min_t(size_t, (count - sizeof(hdr)) /
+			       sizeof(struct tsb_record), TSB_MAX_RECORDS);
+	sc.recs = vmalloc(sc.max_records * sizeof(*sc.recs));
+	if (!sc.recs)
+		return -ENOMEM;
+
+	mutex_lock(&tf->lock);
+	threads = tf->filter.flags & TSB_THREADS;
+	sc.max_snap = (threads ? nr_threads : nr_processes()) +
+		      tf->nr_snap + TSB_SNAP_SLACK;
+	sc.snap = vmalloc(sc.max_snap * sizeof(*sc.snap));
+	if (!sc.snap) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (!tsb_match(&tf->filter, p))
+			continue;
+		if (!threads) {
+			tsb_add(&sc, p, true);
+			continue;
+		}
+		t = p;
+		do {
+			tsb_add(&sc, t, false);
+		} while_each_thread(p, t);
+	}
+	rcu_read_unlock();
+
+	sort(sc.snap, sc.nr_snap, sizeof(*sc.snap), tsb_snap_cmp, NULL);
+	if (tf->filter.flags & TSB_CHANGED)
+		tsb_add_exited(&sc);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.version = TSB_VERSION;
+	hdr.record_size = sizeof(struct tsb_record);
+	hdr.flags = sc.truncated ? TSB_TRUNCATED : 0;
+	hdr.since = tf->generation;
+	hdr.generation = tf->generation + 1;
+	hdr.nr_records = sc.nr_records;
+	hdr.nr_tasks = sc.nr_tasks;
+
+	len = sc.nr_records * sizeof(*sc.recs);
+	if (copy_to_user(buf, &hdr, sizeof(hdr)) ||
+	    copy_to_user(buf + sizeof(hdr), sc.recs, len)) {
+		vfree(sc.snap);
+		ret = -EFAULT;
+		goto out;
+	}
+
+	vfree(tf->snap);
+	tf->snap = sc.snap;
+	tf->nr_snap = sc.nr_snap;
+	tf->generation++;
+	ret = sizeof(hdr) + len;
+out:
+	mutex_unlock(&tf->lock);
+	vfree(sc.recs);
+	return ret;
+}
+
+static void tsb_reset(struct tsb_file *tf)
+{
+	vfree(tf->snap);
+	tf->snap = NULL;
+	tf->nr_snap = 0;
+}
+
+static long tsb_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct tsb_file *tf = file->private_data;
+	struct tsb_filter filter;
+
+	switch (cmd) {
+	case TSB_IOC_SET_FILTER:
+		if (copy_from_user(&filter, (void __user *)arg, sizeof(filter)))
+			return -EFAULT;
+		if (filter.flags & ~(TSB_FILTER_UID | TSB_FILTER_PIDS |
+				     TSB_THREADS | TSB_CHANGED))
+			return -EINVAL;
+		if (filter.nr_pids > TSB_MAX_PIDS)
+			return -EINVAL;
+		mutex_lock(&tf->lock);
+		tf->filter = filter;
+		tsb_reset(tf);
+		mutex_unlock(&tf->lock);
+		return 0;
+	case TSB_IOC_RESET:
+		mutex_lock(&tf->lock);
+		tsb_reset(tf);
+		mutex_unlock(&tf->lock);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations tsb_fops = {
+	.owner		= THIS_MODULE,
+	.open		= tsb_open,
+	.release	= tsb_release,
+	.read		= tsb_read,
+	.unlocked_ioctl	= tsb_ioctl,
+	.llseek		= no_llseek,
+};
+
+static struct miscdevice tsb_misc = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "taskstats_bulk",
+	.fops	= &tsb_fops,
+	.mode	= S_IRUGO,
+};
+
+static int __init taskstats_bulk_init(void)
+{
+	int ret;
+
+	ret = misc_register(&tsb_misc);
+	if (ret < 0)
+		E("%s: misc_register failed, ret = %d\n", __func__, ret);
+	return ret;
+}
+device_initcall(taskstats_bulk_init);
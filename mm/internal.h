@@ -56,7 +56,6 @@ static inline void get_page_foll(struct page *page)
 
 extern unsigned long highest_memmap_pfn;
 
-extern int isolate_lru_page(struct page *page);
 extern void putback_lru_page(struct page *page);
 
 extern void __free_pages_bootmem(struct page *page, unsigned int order);
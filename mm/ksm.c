@@ -36,6 +36,12 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/cgroup.h>
+#include <linux/math64.h>
+#include <linux/power_supply.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -86,12 +92,14 @@
  * @mm_list: link into the mm_slots list, rooted in ksm_mm_head
  * @rmap_list: head for this mm_slot's singly-linked list of rmap_items
  * @mm: the mm that this information is valid for
+ * @in_cgroup: whether @mm is in scan_cgroup, decided when its scan starts
  */
 struct mm_slot {
 	struct hlist_node link;
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	bool in_cgroup;
 };
 
 /**
@@ -189,6 +197,30 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Only scan mms of tasks at or below this cgroup path, when it is set */
+#define KSM_CGROUP_PATH_MAX	128
+static char ksm_cgroup_path[KSM_CGROUP_PATH_MAX];
+static char ksm_cgroup_buf[KSM_CGROUP_PATH_MAX];
+
+/* Hold ksmd while the screen is on */
+static unsigned int ksm_pause_screen_on = 1;
+
+/* Hold ksmd while discharging below this battery capacity (percent) */
+static unsigned int ksm_pause_battery_pct = 20;
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static bool ksm_screen_on = true;
+#else
+static bool ksm_screen_on;
+#endif
+
+/* How often ksmd rechecks the battery while it is held */
+#define KSM_PAUSE_POLL		(10 * HZ)
+
+/* CPU time ksmd has spent scanning, and the page slots it merged in it */
+static u64 ksm_scan_cpu_ns;
+static unsigned long ksm_pages_merged;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -1157,9 +1189,10 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 	rmap_item->address |= STABLE_FLAG;
 	hlist_add_head(&rmap_item->hlist, &stable_node->hlist);
 
-	if (rmap_item->hlist.next)
+	if (rmap_item->hlist.next) {
 		ksm_pages_sharing++;
-	else
+		ksm_pages_merged++;
+	} else
 		ksm_pages_shared++;
 }
 
@@ -1276,6 +1309,63 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+#ifdef CONFIG_CGROUPS
+static bool ksm_mm_in_cgroup(struct mm_struct *mm)
+{
+	struct task_struct *p;
+	size_t len = strlen(ksm_cgroup_path);
+	bool match = false;
+	int i;
+
+	if (!len)
+		return true;
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (p->mm != mm)
+			continue;
+		for (i = 0; i < CGROUP_BUILTIN_SUBSYS_COUNT && !match; i++) {
+			if (cgroup_path(task_cgroup(p, i), ksm_cgroup_buf,
+					sizeof(ksm_cgroup_buf)))
+				continue;
+			if (!strncmp(ksm_cgroup_buf, ksm_cgroup_path, len) &&
+			    (ksm_cgroup_buf[len] == '\0' ||
+			     ksm_cgroup_buf[len] == '/'))
+				match = true;
+		}
+		break;
+	}
+	rcu_read_unlock();
+
+	return match;
+}
+#else
+static inline bool ksm_mm_in_cgroup(struct mm_struct *mm)
+{
+	return true;
+}
+#endif
+
+/*
+ * Step over an mm outside the target cgroup.  Its stable rmap_items stay
+ * where they are, but unstable ones must go now: they would be stale by
+ * more than one scan when we next come back to this mm.
+ */
+static void skip_mm_slot(struct mm_slot *mm_slot)
+{
+	struct rmap_item *rmap_item;
+
+	for (rmap_item = mm_slot->rmap_list; rmap_item;
+	     rmap_item = rmap_item->rmap_list)
+		if (rmap_item->address & UNSTABLE_FLAG)
+			remove_rmap_item_from_tree(rmap_item);
+
+	spin_lock(&ksm_mmlist_lock);
+	ksm_scan.mm_slot = list_entry(mm_slot->mm_list.next,
+						struct mm_slot, mm_list);
+	spin_unlock(&ksm_mmlist_lock);
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1315,9 +1405,15 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 next_mm:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
+		slot->in_cgroup = ksm_mm_in_cgroup(slot->mm);
 	}
 
 	mm = slot->mm;
+	if (!ksm_test_exit(mm) && !slot->in_cgroup) {
+		skip_mm_slot(slot);
+		goto next_slot;
+	}
+
 	down_read(&mm->mmap_sem);
 	if (ksm_test_exit(mm))
 		vma = NULL;
@@ -1398,6 +1494,7 @@ next_mm:
 		up_read(&mm->mmap_sem);
 	}
 
+next_slot:
 	/* Repeat until we've completed scanning the whole list */
 	slot = ksm_scan.mm_slot;
 	if (slot != &ksm_mm_head)
@@ -1432,22 +1529,70 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+static bool ksm_battery_low(void)
+{
+#ifdef CONFIG_POWER_SUPPLY
+	static struct power_supply *psy;
+	static unsigned long next_check;
+	static bool low;
+	union power_supply_propval val;
+
+	if (!ksm_pause_battery_pct)
+		return false;
+	if (next_check && time_before(jiffies, next_check))
+		return low;
+	next_check = jiffies + KSM_PAUSE_POLL;
+
+	if (!psy)
+		psy = power_supply_get_by_name("battery");
+	low = false;
+	if (!psy || !psy->get_property)
+		return false;
+	if (!psy->get_property(psy, POWER_SUPPLY_PROP_STATUS, &val) &&
+	    (val.intval == POWER_SUPPLY_STATUS_CHARGING ||
+	     val.intval == POWER_SUPPLY_STATUS_FULL))
+		return false;
+	if (!psy->get_property(psy, POWER_SUPPLY_PROP_CAPACITY, &val) &&
+	    val.intval < ksm_pause_battery_pct)
+		low = true;
+	return low;
+#else
+	return false;
+#endif
+}
+
+static bool ksmd_paused(void)
+{
+	if (ksm_pause_screen_on && ksm_screen_on)
+		return true;
+	return ksm_battery_low();
+}
+
 static int ksm_scan_thread(void *nothing)
 {
+	u64 start;
+
 	set_freezable();
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
+		if (ksmd_should_run() && !ksmd_paused()) {
+			start = task_sched_runtime(current);
 			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_scan_cpu_ns += task_sched_runtime(current) - start;
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
-		if (ksmd_should_run()) {
+		if (ksmd_should_run() && !ksmd_paused()) {
 			schedule_timeout_interruptible(
 				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+		} else if (ksmd_should_run()) {
+			wait_event_freezable_timeout(ksm_thread_wait,
+				!ksmd_paused() || kthread_should_stop(),
+				KSM_PAUSE_POLL);
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1971,6 +2116,118 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t scan_cgroup_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	ssize_t ret;
+
+	mutex_lock(&ksm_thread_mutex);
+	ret = sprintf(buf, "%s\n", ksm_cgroup_path);
+	mutex_unlock(&ksm_thread_mutex);
+
+	return ret;
+}
+
+static ssize_t scan_cgroup_store(struct kobject *kobj,
+				 struct kobj_attribute *attr,
+				 const char *buf, size_t count)
+{
+	size_t len = count;
+
+	if (len && buf[len - 1] == '\n')
+		len--;
+	while (len && buf[len - 1] == '/')
+		len--;
+	if (len >= KSM_CGROUP_PATH_MAX || (len && buf[0] != '/'))
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	memcpy(ksm_cgroup_path, buf, len);
+	ksm_cgroup_path[len] = '\0';
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(scan_cgroup);
+
+static ssize_t pause_screen_on_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_pause_screen_on);
+}
+
+static ssize_t pause_screen_on_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 1)
+		return -EINVAL;
+
+	ksm_pause_screen_on = val;
+	wake_up_interruptible(&ksm_thread_wait);
+
+	return count;
+}
+KSM_ATTR(pause_screen_on);
+
+static ssize_t pause_battery_pct_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_pause_battery_pct);
+}
+
+static ssize_t pause_battery_pct_store(struct kobject *kobj,
+				       struct kobj_attribute *attr,
+				       const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 100)
+		return -EINVAL;
+
+	ksm_pause_battery_pct = val;
+	wake_up_interruptible(&ksm_thread_wait);
+
+	return count;
+}
+KSM_ATTR(pause_battery_pct);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scan_cpu_ms_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n", div_u64(ksm_scan_cpu_ns, NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(scan_cpu_ms);
+
+static ssize_t merged_per_cpu_sec_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	u64 cpu_ns = ksm_scan_cpu_ns;
+	u64 rate = 0;
+
+	/*
+	 * Page slots merged per second of ksmd CPU time, over its lifetime;
+	 * that is what decides whether the scanning is paying for itself.
+	 */
+	if (cpu_ns)
+		rate = div64_u64((u64)ksm_pages_merged * NSEC_PER_SEC, cpu_ns);
+	return sprintf(buf, "%llu\n", rate);
+}
+KSM_ATTR_RO(merged_per_cpu_sec);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -1980,6 +2237,12 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&scan_cgroup_attr.attr,
+	&pause_screen_on_attr.attr,
+	&pause_battery_pct_attr.attr,
+	&pages_merged_attr.attr,
+	&scan_cpu_ms_attr.attr,
+	&merged_per_cpu_sec_attr.attr,
 	NULL,
 };
 
@@ -1989,6 +2252,25 @@ static struct attribute_group ksm_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void ksm_early_suspend(struct early_suspend *h)
+{
+	ksm_screen_on = false;
+	wake_up_interruptible(&ksm_thread_wait);
+}
+
+static void ksm_late_resume(struct early_suspend *h)
+{
+	ksm_screen_on = true;
+}
+
+static struct early_suspend ksm_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1,
+	.suspend = ksm_early_suspend,
+	.resume = ksm_late_resume,
+};
+#endif
+
 static int __init ksm_init(void)
 {
 	struct task_struct *ksm_thread;
@@ -2023,6 +2305,9 @@ static int __init ksm_init(void)
 	 * later callbacks could only be taking locks which nest within that.
 	 */
 	hotplug_memory_notifier(ksm_memory_callback, 100);
+#endif
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&ksm_early_suspend_desc);
 #endif
 	return 0;
 
@@ -566,7 +566,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			goto keep;
 
 		VM_BUG_ON(PageActive(page));
-		VM_BUG_ON(page_zone(page) != mz->zone);
+		VM_BUG_ON(mz && page_zone(page) != mz->zone);
 
 		sc->nr_scanned++;
 
@@ -594,7 +594,10 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		references = page_check_references(page, mz, sc);
+		if (mz)
+			references = page_check_references(page, mz, sc);
+		else
+			references = PAGEREF_RECLAIM;
 		switch (references) {
 		case PAGEREF_ACTIVATE:
 			goto activate_locked;
@@ -744,7 +747,7 @@ keep_lumpy:
 		VM_BUG_ON(PageLRU(page) || PageUnevictable(page));
 	}
 
-	if (nr_dirty && nr_dirty == nr_congested && global_reclaim(sc))
+	if (nr_dirty && nr_dirty == nr_congested && mz && global_reclaim(sc))
 		zone_set_flag(mz->zone, ZONE_CONGESTED);
 
 	free_hot_cold_page_list(&free_pages, 1);
@@ -756,6 +759,52 @@ keep_lumpy:
 	return nr_reclaimed;
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * Reclaim pages isolated by the caller without looking at the referenced
+ * bits; whatever cannot be freed is put back on the LRU.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+	};
+	unsigned long nr_dirty = 0, nr_writeback = 0;
+	unsigned long nr_anon = 0, nr_file = 0;
+	unsigned long nr_reclaimed;
+	struct page *page;
+
+	list_for_each_entry(page, page_list, lru) {
+		ClearPageActive(page);
+		if (page_is_file_cache(page))
+			nr_file++;
+		else
+			nr_anon++;
+	}
+
+	nr_reclaimed = shrink_page_list(page_list, NULL, &sc, DEF_PRIORITY,
+					&nr_dirty, &nr_writeback);
+
+	while (!list_empty(page_list)) {
+		page = lru_to_page(page_list);
+		list_del(&page->lru);
+		if (page_is_file_cache(page))
+			nr_file--;
+		else
+			nr_anon--;
+		putback_lru_page(page);
+	}
+
+	count_vm_events(PROC_RECLAIM_SCANNED, sc.nr_scanned);
+	count_vm_events(PROC_RECLAIM_ANON, nr_anon);
+	count_vm_events(PROC_RECLAIM_FILE, nr_file);
+	return nr_reclaimed;
+}
+#endif
+
 int __isolate_lru_page(struct page *page, isolate_mode_t mode, int file)
 {
 	bool all_lru_mode;
@@ -603,6 +603,12 @@ const char * const vmstat_text[] = {
 	"unevictable_pgs_stranded",
 	"unevictable_pgs_mlockfreed",
 
+#ifdef CONFIG_PROCESS_RECLAIM
+	"proc_reclaim_scanned",
+	"proc_reclaim_anon",
+	"proc_reclaim_file",
+#endif
+
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	"thp_fault_alloc",
 	"thp_fault_fallback",
@@ -0,0 +1,677 @@
+/*
+ * IPv4 forwarding flow cache
+ *
+ * Once a forwarded connection is established in conntrack, packets
+ * matching its 5-tuple on the same ingress device are NATed, have
+ * their TTL decremented and are handed to the egress neighbour
+ * directly from PRE_ROUTING, bypassing conntrack and routing.  The
+ * FORWARD hooks still run, so filter and mangle rules, counters and
+ * quotas there keep seeing every packet.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/types.h>
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/netdevice.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/netfilter/x_tables.h>
+#include <linux/module.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+#include <net/checksum.h>
+#include <net/dst.h>
+#include <net/ip.h>
+#include <net/neighbour.h>
+#include <net/route.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_core.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define NF_FLOW_CACHE_HASH_BITS	10
+#define NF_FLOW_CACHE_HASH_SIZE	(1 << NF_FLOW_CACHE_HASH_BITS)
+#define NF_FLOW_CACHE_GC_INTERVAL	(5 * HZ)
+
+static bool enable;
+module_param(enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Forward established flows through the cache");
+
+static unsigned int max_entries = 4096;
+module_param(max_entries, uint, 0644);
+MODULE_PARM_DESC(max_entries, "Maximum number of cached flows");
+
+static unsigned int idle_timeout = 30;
+module_param(idle_timeout, uint, 0644);
+MODULE_PARM_DESC(idle_timeout, "Seconds before an unused flow is evicted");
+
+struct nf_flow_cache_entry {
+	struct hlist_node	hnode;
+	struct rcu_head		rcu;
+
+	__be32			saddr;
+	__be32			daddr;
+	__be16			sport;
+	__be16			dport;
+	u8			protonum;
+	u8			dead;
+	int			iif;
+
+	__be32			new_saddr;
+	__be32			new_daddr;
+	__be16			new_sport;
+	__be16			new_dport;
+
+	struct nf_conn		*ct;
+	enum ip_conntrack_info	ctinfo;
+	struct dst_entry	*dst;
+	unsigned long		ct_timeout;
+	unsigned long		last_used;
+	unsigned long		hits;
+};
+
+struct nf_flow_cache_stats {
+	unsigned int	hit;
+	unsigned int	miss;
+	unsigned int	slowpath;
+	unsigned int	insert;
+	unsigned int	insert_failed;
+	unsigned int	evict;
+};
+
+static struct hlist_head nf_flow_cache_hash[NF_FLOW_CACHE_HASH_SIZE];
+static DEFINE_SPINLOCK(nf_flow_cache_lock);
+static atomic_t nf_flow_cache_count = ATOMIC_INIT(0);
+static struct kmem_cache *nf_flow_cache_cachep __read_mostly;
+static u32 nf_flow_cache_rnd __read_mostly;
+static DEFINE_PER_CPU(struct nf_flow_cache_stats, nf_flow_cache_stats);
+static struct delayed_work nf_flow_cache_gc_work;
+
+#define NF_FLOW_CACHE_STAT_INC(count) \
+	__this_cpu_inc(nf_flow_cache_stats.count)
+
+static inline u32 nf_flow_cache_hashfn(__be32 saddr, __be32 daddr,
+				       __be16 sport, __be16 dport,
+				       u8 protonum, int iif)
+{
+	return jhash_3words((__force u32)saddr,
+			    (__force u32)daddr ^ iif,
+			    ((__force u32)sport << 16 | (__force u32)dport) ^
+			    protonum,
+			    nf_flow_cache_rnd) &
+		(NF_FLOW_CACHE_HASH_SIZE - 1);
+}
+
+static struct nf_flow_cache_entry *
+nf_flow_cache_lookup(__be32 saddr, __be32 daddr, __be16 sport, __be16 dport,
+		     u8 protonum, int iif)
+{
+	struct nf_flow_cache_entry *e;
+	struct hlist_node *n;
+	u32 hash = nf_flow_cache_hashfn(saddr, daddr, sport, dport,
+					protonum, iif);
+
+	hlist_for_each_entry_rcu(e, n, &nf_flow_cache_hash[hash], hnode) {
+		if (e->saddr == saddr && e->daddr == daddr &&
+		    e->sport == sport && e->dport == dport &&
+		    e->protonum == protonum && e->iif == iif)
+			return e;
+	}
+	return NULL;
+}
+
+static void nf_flow_cache_free_rcu(struct rcu_head *head)
+{
+	struct nf_flow_cache_entry *e =
+		container_of(head, struct nf_flow_cache_entry, rcu);
+
+	dst_release(e->dst);
+	nf_ct_put(e->ct);
+	kmem_cache_free(nf_flow_cache_cachep, e);
+}
+
+static void __nf_flow_cache_remove(struct nf_flow_cache_entry *e)
+{
+	if (e->dead)
+		return;
+	e->dead = 1;
+	hlist_del_rcu(&e->hnode);
+	atomic_dec(&nf_flow_cache_count);
+	call_rcu(&e->rcu, nf_flow_cache_free_rcu);
+}
+
+static void nf_flow_cache_remove(struct nf_flow_cache_entry *e)
+{
+	spin_lock_bh(&nf_flow_cache_lock);
+	__nf_flow_cache_remove(e);
+	spin_unlock_bh(&nf_flow_cache_lock);
+	NF_FLOW_CACHE_STAT_INC(evict);
+}
+
+static void nf_flow_cache_flush(void)
+{
+	struct nf_flow_cache_entry *e;
+	struct hlist_node *n, *tmp;
+	int i;
+
+	spin_lock_bh(&nf_flow_cache_lock);
+	for (i = 0; i < NF_FLOW_CACHE_HASH_SIZE; i++)
+		hlist_for_each_entry_safe(e, n, tmp, &nf_flow_cache_hash[i],
+					  hnode)
+			__nf_flow_cache_remove(e);
+	spin_unlock_bh(&nf_flow_cache_lock);
+}
+
+static inline bool nf_flow_cache_stale(struct nf_flow_cache_entry *e)
+{
+	return nf_ct_is_dying(e->ct) || dst_check(e->dst, 0) == NULL;
+}
+
+static void nf_flow_cache_gc(struct work_struct *work)
+{
+	struct nf_flow_cache_entry *e;
+	struct hlist_node *n, *tmp;
+	unsigned long idle = idle_timeout * HZ;
+	int i;
+
+	if (!enable) {
+		nf_flow_cache_flush();
+		goto out;
+	}
+
+	spin_lock_bh(&nf_flow_cache_lock);
+	for (i = 0; i < NF_FLOW_CACHE_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(e, n, tmp, &nf_flow_cache_hash[i],
+					  hnode) {
+			if (nf_flow_cache_stale(e) ||
+			    time_after(jiffies, e->last_used + idle))
+				__nf_flow_cache_remove(e);
+		}
+	}
+	spin_unlock_bh(&nf_flow_cache_lock);
+out:
+	schedule_delayed_work(&nf_flow_cache_gc_work,
+			      NF_FLOW_CACHE_GC_INTERVAL);
+}
+
+/*
+ * Rewrite the source (src) or destination address and port.  As on the
+ * slow path, the destination is translated before the FORWARD hooks and
+ * the source after them.
+ */
+static void nf_flow_cache_nat(struct sk_buff *skb, unsigned int thoff,
+			      bool src, __be32 addr, __be16 port)
+{
+	struct iphdr *iph = ip_hdr(skb);
+	__be16 *ports = (__be16 *)((void *)iph + thoff);
+	__be32 *iaddr = src ? &iph->saddr : &iph->daddr;
+	__be16 *iport = src ? &ports[0] : &ports[1];
+	__sum16 *check = NULL;
+	bool udp = false;
+
+	if (iph->protocol == IPPROTO_TCP) {
+		check = &((struct tcphdr *)ports)->check;
+	} else {
+		struct udphdr *uh = (struct udphdr *)ports;
+
+		udp = true;
+		if (uh->check || skb->ip_summed == CHECKSUM_PARTIAL)
+			check = &uh->check;
+	}
+
+	if (*iaddr != addr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, *iaddr, addr, 1);
+		csum_replace4(&iph->check, *iaddr, addr);
+		*iaddr = addr;
+	}
+	if (*iport != port) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, *iport, port, 0);
+		*iport = port;
+	}
+	if (udp && check && !*check)
+		*check = CSUM_MANGLED_0;
+}
+
+/* okfn of the FORWARD hook, may run later from a queue */
+static int nf_flow_cache_xmit(struct sk_buff *skb)
+{
+	const struct nf_conntrack_tuple *repl;
+	enum ip_conntrack_info ctinfo;
+	struct dst_entry *dst = skb_dst(skb);
+	unsigned int thoff = ip_hdrlen(skb);
+	unsigned int hdrsize;
+	struct neighbour *neigh;
+	struct nf_conn *ct;
+	int ret;
+
+	hdrsize = ip_hdr(skb)->protocol == IPPROTO_TCP ?
+		  sizeof(struct tcphdr) : sizeof(struct udphdr);
+	ct = nf_ct_get(skb, &ctinfo);
+	if (unlikely(!ct || !skb_make_writable(skb, thoff + hdrsize)))
+		goto drop;
+
+	repl = &ct->tuplehash[!CTINFO2DIR(ctinfo)].tuple;
+	nf_flow_cache_nat(skb, thoff, true, repl->dst.u3.ip, repl->dst.u.all);
+	skb->dev = dst->dev;
+
+	rcu_read_lock();
+	neigh = dst_get_neighbour_noref(dst);
+	if (unlikely(!neigh)) {
+		rcu_read_unlock();
+		goto drop;
+	}
+	IP_INC_STATS_BH(dev_net(dst->dev), IPSTATS_MIB_OUTFORWDATAGRAMS);
+	ret = neigh_output(neigh, skb);
+	rcu_read_unlock();
+	return ret;
+
+drop:
+	kfree_skb(skb);
+	return -EINVAL;
+}
+
+static unsigned int nf_flow_cache_in(unsigned int hooknum,
+				     struct sk_buff *skb,
+				     const struct net_device *in,
+				     const struct net_device *out,
+				     int (*okfn)(struct sk_buff *))
+{
+	struct nf_flow_cache_entry *e;
+	struct dst_entry *dst;
+	struct neighbour *neigh;
+	const struct iphdr *iph;
+	unsigned int thoff, hdrsize;
+	__be16 *ports;
+
+	if (!enable || !atomic_read(&nf_flow_cache_count))
+		return NF_ACCEPT;
+	if (skb->pkt_type != PACKET_HOST || !net_eq(dev_net(in), &init_net))
+		return NF_ACCEPT;
+	if (skb->nfct)
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph) || iph->ttl <= 1)
+		return NF_ACCEPT;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hdrsize = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrsize = sizeof(struct udphdr);
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+
+	thoff = iph->ihl * 4;
+	if (!pskb_may_pull(skb, thoff + hdrsize))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	ports = (__be16 *)(skb_network_header(skb) + thoff);
+
+	e = nf_flow_cache_lookup(iph->saddr, iph->daddr, ports[0], ports[1],
+				 iph->protocol, in->ifindex);
+	if (!e) {
+		NF_FLOW_CACHE_STAT_INC(miss);
+		return NF_ACCEPT;
+	}
+
+	if (unlikely(e->dead))
+		return NF_ACCEPT;
+
+	if (unlikely(nf_flow_cache_stale(e))) {
+		nf_flow_cache_remove(e);
+		return NF_ACCEPT;
+	}
+
+	if (iph->protocol == IPPROTO_TCP) {
+		const struct tcphdr *th = (const struct tcphdr *)ports;
+
+		if (unlikely(th->syn || th->fin || th->rst)) {
+			NF_FLOW_CACHE_STAT_INC(slowpath);
+			return NF_ACCEPT;
+		}
+	}
+
+	dst = e->dst;
+	if (unlikely(skb->len > dst_mtu(dst) && !skb_is_gso(skb))) {
+		NF_FLOW_CACHE_STAT_INC(slowpath);
+		return NF_ACCEPT;
+	}
+
+	neigh = dst_get_neighbour_noref(dst);
+	if (unlikely(!neigh)) {
+		NF_FLOW_CACHE_STAT_INC(slowpath);
+		return NF_ACCEPT;
+	}
+
+	if (skb_cow(skb, LL_RESERVED_SPACE(dst->dev) + dst->header_len)) {
+		NF_FLOW_CACHE_STAT_INC(slowpath);
+		return NF_ACCEPT;
+	}
+
+	skb_forward_csum(skb);
+	nf_flow_cache_nat(skb, thoff, false, e->new_daddr, e->new_dport);
+	ip_decrease_ttl(ip_hdr(skb));
+
+	nf_ct_refresh_acct(e->ct, e->ctinfo, skb, e->ct_timeout);
+	e->last_used = jiffies;
+	e->hits++;
+
+	/* FORWARD rules (tether counters, quotas) match on conntrack state */
+	nf_conntrack_get(&e->ct->ct_general);
+	skb->nfct = &e->ct->ct_general;
+	skb->nfctinfo = e->ctinfo;
+
+	skb_dst_drop(skb);
+	skb_dst_set(skb, dst_clone(dst));
+	IPCB(skb)->flags |= IPSKB_FORWARDED;
+
+	NF_FLOW_CACHE_STAT_INC(hit);
+	NF_HOOK(NFPROTO_IPV4, NF_INET_FORWARD, skb, skb->dev, dst->dev,
+		nf_flow_cache_xmit);
+	return NF_STOLEN;
+}
+
+static void nf_flow_cache_insert(struct nf_conn *ct,
+				 enum ip_conntrack_info ctinfo,
+				 int iif, struct dst_entry *dst)
+{
+	enum ip_conntrack_dir dir = CTINFO2DIR(ctinfo);
+	const struct nf_conntrack_tuple *orig = &ct->tuplehash[dir].tuple;
+	const struct nf_conntrack_tuple *repl = &ct->tuplehash[!dir].tuple;
+	struct nf_flow_cache_entry *e, *old;
+	u32 hash;
+
+	old = nf_flow_cache_lookup(orig->src.u3.ip, orig->dst.u3.ip,
+				   orig->src.u.all, orig->dst.u.all,
+				   orig->dst.protonum, iif);
+	if (old && !old->dead && old->ct == ct && old->dst == dst)
+		return;
+
+	if (atomic_read(&nf_flow_cache_count) >= max_entries) {
+		NF_FLOW_CACHE_STAT_INC(insert_failed);
+		return;
+	}
+
+	e = kmem_cache_alloc(nf_flow_cache_cachep, GFP_ATOMIC);
+	if (!e) {
+		NF_FLOW_CACHE_STAT_INC(insert_failed);
+		return;
+	}
+
+	e->saddr = orig->src.u3.ip;
+	e->daddr = orig->dst.u3.ip;
+	e->sport = orig->src.u.all;
+	e->dport = orig->dst.u.all;
+	e->protonum = orig->dst.protonum;
+	e->iif = iif;
+	e->dead = 0;
+
+	e->new_saddr = repl->dst.u3.ip;
+	e->new_daddr = repl->src.u3.ip;
+	e->new_sport = repl->dst.u.all;
+	e->new_dport = repl->src.u.all;
+
+	nf_conntrack_get(&ct->ct_general);
+	e->ct = ct;
+	e->ctinfo = ctinfo;
+	e->ct_timeout = max_t(long, ct->timeout.expires - jiffies, HZ);
+	e->dst = dst_clone(dst);
+	e->last_used = jiffies;
+	e->hits = 0;
+
+	if (e->protonum == IPPROTO_TCP) {
+		spin_lock_bh(&ct->lock);
+		ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		spin_unlock_bh(&ct->lock);
+	}
+
+	hash = nf_flow_cache_hashfn(e->saddr, e->daddr, e->sport, e->dport,
+				    e->protonum, iif);
+
+	spin_lock_bh(&nf_flow_cache_lock);
+	if (old)
+		__nf_flow_cache_remove(old);
+	hlist_add_head_rcu(&e->hnode, &nf_flow_cache_hash[hash]);
+	atomic_inc(&nf_flow_cache_count);
+	spin_unlock_bh(&nf_flow_cache_lock);
+
+	NF_FLOW_CACHE_STAT_INC(insert);
+}
+
+static unsigned int nf_flow_cache_out(unsigned int hooknum,
+				      struct sk_buff *skb,
+				      const struct net_device *in,
+				      const struct net_device *out,
+				      int (*okfn)(struct sk_buff *))
+{
+	enum ip_conntrack_info ctinfo;
+	struct dst_entry *dst;
+	struct nf_conn *ct;
+
+	if (!enable || !(IPCB(skb)->flags & IPSKB_FORWARDED))
+		return NF_ACCEPT;
+	if (!net_eq(dev_net(out), &init_net))
+		return NF_ACCEPT;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || nf_ct_is_untracked(ct))
+		return NF_ACCEPT;
+	if (ctinfo != IP_CT_ESTABLISHED && ctinfo != IP_CT_ESTABLISHED_REPLY)
+		return NF_ACCEPT;
+	if (!nf_ct_is_confirmed(ct) || nf_ct_is_dying(ct) || nfct_help(ct) ||
+	    test_bit(IPS_SEQ_ADJUST_BIT, &ct->status))
+		return NF_ACCEPT;
+
+	switch (nf_ct_protonum(ct)) {
+	case IPPROTO_TCP:
+		if (ct->proto.tcp.state != TCP_CONNTRACK_ESTABLISHED)
+			return NF_ACCEPT;
+		break;
+	case IPPROTO_UDP:
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+
+	dst = skb_dst(skb);
+	if (!dst || dst->xfrm ||
+	    ((struct rtable *)dst)->rt_type != RTN_UNICAST)
+		return NF_ACCEPT;
+
+	nf_flow_cache_insert(ct, ctinfo, skb->skb_iif, dst);
+	return NF_ACCEPT;
+}
+
+static struct nf_hook_ops nf_flow_cache_ops[] __read_mostly = {
+	{
+		.hook		= nf_flow_cache_in,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_CONNTRACK_DEFRAG - 1,
+	},
+	{
+		.hook		= nf_flow_cache_out,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_POST_ROUTING,
+		.priority	= NF_IP_PRI_LAST,
+	},
+};
+
+static int nf_flow_cache_netdev_event(struct notifier_block *this,
+				      unsigned long event, void *ptr)
+{
+	switch (event) {
+	case NETDEV_DOWN:
+	case NETDEV_UNREGISTER:
+	case NETDEV_CHANGEMTU:
+	case NETDEV_CHANGEADDR:
+		nf_flow_cache_flush();
+		break;
+	}
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block nf_flow_cache_netdev_notifier = {
+	.notifier_call	= nf_flow_cache_netdev_event,
+};
+
+/* cached flows were admitted under the old rules */
+static int nf_flow_cache_table_event(struct notifier_block *this,
+				     unsigned long af, void *ptr)
+{
+	if (af == NFPROTO_IPV4)
+		nf_flow_cache_flush();
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block nf_flow_cache_table_notifier = {
+	.notifier_call	= nf_flow_cache_table_event,
+};
+
+#ifdef CONFIG_PROC_FS
+static int nf_flow_cache_seq_show(struct seq_file *s, void *v)
+{
+	struct nf_flow_cache_stats sum;
+	struct nf_flow_cache_entry *e;
+	struct hlist_node *n;
+	int cpu, i;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		const struct nf_flow_cache_stats *st =
+			&per_cpu(nf_flow_cache_stats, cpu);
+
+		sum.hit += st->hit;
+		sum.miss += st->miss;
+		sum.slowpath += st->slowpath;
+		sum.insert += st->insert;
+		sum.insert_failed += st->insert_failed;
+		sum.evict += st->evict;
+	}
+
+	seq_printf(s, "entries %d hit %u miss %u slowpath %u insert %u "
+		   "insert_failed %u evict %u\n",
+		   atomic_read(&nf_flow_cache_count), sum.hit, sum.miss,
+		   sum.slowpath, sum.insert, sum.insert_failed, sum.evict);
+
+	rcu_read_lock();
+	for (i = 0; i < NF_FLOW_CACHE_HASH_SIZE; i++) {
+		hlist_for_each_entry_rcu(e, n, &nf_flow_cache_hash[i], hnode) {
+			seq_printf(s, "proto=%u iif=%d src=%pI4:%u "
+				   "dst=%pI4:%u -> src=%pI4:%u dst=%pI4:%u "
+				   "oif=%s hits=%lu\n",
+				   e->protonum, e->iif,
+				   &e->saddr, ntohs(e->sport),
+				   &e->daddr, ntohs(e->dport),
+				   &e->new_saddr, ntohs(e->new_sport),
+				   &e->new_daddr, ntohs(e->new_dport),
+				   e->dst->dev ? e->dst->dev->name : "-",
+				   e->hits);
+		}
+	}
+	rcu_read_unlock();
+	return 0;
+}
+
+static int nf_flow_cache_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nf_flow_cache_seq_show, NULL);
+}
+
+static const struct file_operations nf_flow_cache_fops = {
+	.owner		= THIS_MODULE,
+	.open		= nf_flow_cache_seq_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static int __init nf_flow_cache_init(void)
+{
+	int ret;
+
+	need_conntrack();
+	get_random_bytes(&nf_flow_cache_rnd, sizeof(nf_flow_cache_rnd));
+
+	nf_flow_cache_cachep = KMEM_CACHE(nf_flow_cache_entry, 0);
+	if (!nf_flow_cache_cachep)
+		return -ENOMEM;
+
+#ifdef CONFIG_PROC_FS
+	if (!proc_net_fops_create(&init_net, "nf_flow_cache", 0440,
+				  &nf_flow_cache_fops)) {
+		ret = -ENOMEM;
+		goto err_cache;
+	}
+#endif
+
+	ret = register_netdevice_notifier(&nf_flow_cache_netdev_notifier);
+	if (ret < 0)
+		goto err_proc;
+
+	ret = xt_register_table_notifier(&nf_flow_cache_table_notifier);
+	if (ret < 0)
+		goto err_notifier;
+
+	ret = nf_register_hooks(nf_flow_cache_ops,
+				ARRAY_SIZE(nf_flow_cache_ops));
+	if (ret < 0)
+		goto err_table;
+
+	INIT_DELAYED_WORK_DEFERRABLE(&nf_flow_cache_gc_work, nf_flow_cache_gc);
+	schedule_delayed_work(&nf_flow_cache_gc_work,
+			      NF_FLOW_CACHE_GC_INTERVAL);
+	return 0;
+
+err_table:
+	xt_unregister_table_notifier(&nf_flow_cache_table_notifier);
+err_notifier:
+	unregister_netdevice_notifier(&nf_flow_cache_netdev_notifier);
+err_proc:
+#ifdef CONFIG_PROC_FS
+	proc_net_remove(&init_net, "nf_flow_cache");
+err_cache:
+#endif
+	kmem_cache_destroy(nf_flow_cache_cachep);
+	return ret;
+}
+
+static void __exit nf_flow_cache_fini(void)
+{
+	nf_unregister_hooks(nf_flow_cache_ops, ARRAY_SIZE(nf_flow_cache_ops));
+	cancel_delayed_work_sync(&nf_flow_cache_gc_work);
+	xt_unregister_table_notifier(&nf_flow_cache_table_notifier);
+	unregister_netdevice_notifier(&nf_flow_cache_netdev_notifier);
+#ifdef CONFIG_PROC_FS
+	proc_net_remove(&init_net, "nf_flow_cache");
+#endif
+	nf_flow_cache_flush();
+	rcu_barrier();
+	kmem_cache_destroy(nf_flow_cache_cachep);
+}
+
+module_init(nf_flow_cache_init);
+module_exit(nf_flow_cache_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("IPv4 forwarding flow cache for established NAT flows");
@@ -25,6 +25,7 @@
 #include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/audit.h>
+#include <linux/notifier.h>
 #include <net/net_namespace.h>
 
 #include <linux/netfilter/x_tables.h>
@@ -784,6 +785,21 @@ static int xt_jumpstack_alloc(struct xt_table_info *i)
 	return 0;
 }
 
+static BLOCKING_NOTIFIER_HEAD(xt_table_notifier);
+
+/* Called after any table in any family gets a new ruleset */
+int xt_register_table_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&xt_table_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(xt_register_table_notifier);
+
+int xt_unregister_table_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&xt_table_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(xt_unregister_table_notifier);
+
 struct xt_table_info *
 xt_replace_table(struct xt_table *table,
 	      unsigned int num_counters,
@@ -832,6 +848,8 @@ xt_replace_table(struct xt_table *table,
 	}
 #endif
 
+	blocking_notifier_call_chain(&xt_table_notifier, table->af, table);
+
 	return private;
 }
 EXPORT_SYMBOL_GPL(xt_replace_table);
@@ -2852,6 +2852,10 @@ static int snd_pcm_common_ioctl1(struct file *file,
 	case SNDRV_COMPRESS_GET_PARAMS:
 	case SNDRV_COMPRESS_TSTAMP:
 	case SNDRV_COMPRESS_DRAIN:
+	case SNDRV_COMPRESS_SET_METADATA:
+	case SNDRV_COMPRESS_GET_METADATA:
+	case SNDRV_COMPRESS_NEXT_TRACK:
+	case SNDRV_COMPRESS_PARTIAL_DRAIN:
 		return snd_compressed_ioctl(substream, cmd, arg);
 	}
 	snd_printd("unknown ioctl = 0x%x\n", cmd);
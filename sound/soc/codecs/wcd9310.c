@@ -8264,6 +8264,7 @@ static struct platform_driver tabla_codec_driver = {
 #ifdef CONFIG_PM
 		.pm = &tabla_pm_ops,
 #endif
+		.async_domain = &device_async_audio,
 	},
 };
 
@@ -8276,6 +8277,7 @@ static struct platform_driver tabla1x_codec_driver = {
 #ifdef CONFIG_PM
 		.pm = &tabla_pm_ops,
 #endif
+		.async_domain = &device_async_audio,
 	},
 };
 
@@ -19,6 +19,8 @@
 #include <linux/wait.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <sound/core.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -49,9 +51,22 @@
 #define COMPRE_CAPTURE_PERIOD_SIZE	(COMPRE_CAPTURE_MAX_FRAME_SIZE + \
 					 COMPRE_CAPTURE_HEADER_SIZE)
 #define COMPRE_OUTPUT_METADATA_SIZE	(sizeof(struct output_meta_data_st))
+#define COMPRE_REFILL_WAKELOCK_TIMEOUT	(HZ + HZ / 2)
 
 struct wake_lock compr_lpa_wakelock;
 
+struct compr_wakeup_stats {
+	u32 write_done;
+	u32 user_wakeups;
+	u32 skipped_wakeups;
+	u32 refill_wakelocks;
+	u32 starved;
+	u32 partial_drains;
+	u64 bytes;
+	u64 run_ms;
+};
+static struct compr_wakeup_stats compr_stats;
+
 struct snd_msm {
 	struct msm_audio *prtd;
 	unsigned volume;
@@ -120,6 +135,89 @@ void htc_register_compr_q6_ops(struct msm_compr_q6_ops *ops)
 	cops = ops;
 }
 
+static snd_pcm_sframes_t compr_frames_diff(struct snd_pcm_runtime *runtime,
+		snd_pcm_uframes_t a, snd_pcm_uframes_t b)
+{
+	snd_pcm_sframes_t diff = a - b;
+
+	if (diff < 0)
+		diff += runtime->boundary;
+	return diff;
+}
+
+/*
+ * Frames the DSP has returned, in the same units as appl_ptr.  Unlike
+ * hw_ptr this does not depend on when ALSA last asked for the pointer.
+ */
+static snd_pcm_uframes_t compr_done_frames(struct compr_audio *compr)
+{
+	return compr->consumed;
+}
+
+static void compr_consume(struct compr_audio *compr)
+{
+	struct snd_pcm_runtime *runtime = compr->prtd.substream->runtime;
+
+	compr->consumed += runtime->period_size;
+	if (compr->consumed >= runtime->boundary)
+		compr->consumed -= runtime->boundary;
+}
+
+static snd_pcm_uframes_t compr_queued_frames(struct compr_audio *compr)
+{
+	struct snd_pcm_runtime *runtime = compr->prtd.substream->runtime;
+	snd_pcm_sframes_t queued;
+
+	queued = compr_frames_diff(runtime, runtime->control->appl_ptr,
+			compr_done_frames(compr));
+	if (queued > runtime->buffer_size)
+		queued = 0;
+	return queued;
+}
+
+static int compr_track_drained(struct compr_audio *compr)
+{
+	struct snd_pcm_runtime *runtime = compr->prtd.substream->runtime;
+	snd_pcm_sframes_t left;
+
+	left = compr_frames_diff(runtime, compr->gapless.track_end,
+			compr_done_frames(compr));
+	return left <= runtime->period_size || left > runtime->buffer_size;
+}
+
+static snd_pcm_uframes_t compr_period_done(struct compr_audio *compr)
+{
+	struct snd_pcm_substream *substream = compr->prtd.substream;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	snd_pcm_uframes_t queued;
+
+	queued = compr_queued_frames(compr);
+	if (queued <= runtime->period_size) {
+		compr_stats.refill_wakelocks++;
+		wake_lock_timeout(&compr_lpa_wakelock,
+				COMPRE_REFILL_WAKELOCK_TIMEOUT);
+	}
+	if (!compr->no_wake_mode || queued <= runtime->period_size) {
+		compr_stats.user_wakeups++;
+		snd_pcm_period_elapsed(substream);
+	} else {
+		compr_stats.skipped_wakeups++;
+	}
+	if (!queued)
+		compr_stats.starved++;
+	return queued;
+}
+
+static void compr_account_run(struct compr_audio *compr, int running)
+{
+	ktime_t now = ktime_get();
+
+	if (compr->run_start.tv64)
+		compr_stats.run_ms += ktime_to_ms(ktime_sub(now,
+						compr->run_start));
+	compr->run_start = running ? now : ktime_set(0, 0);
+}
+
 static void compr_event_handler(uint32_t opcode,
 		uint32_t token, uint32_t *payload, void *priv)
 {
@@ -135,7 +233,10 @@ static void compr_event_handler(uint32_t opcode,
 	int i = 0;
 	int time_stamp_flag = 0;
 	int buffer_length = 0;
-	wake_lock_timeout(&compr_lpa_wakelock, 1.5 * HZ);
+	snd_pcm_uframes_t queued = 0;
+
+	if (opcode != ASM_DATA_EVENT_WRITE_DONE)
+		wake_lock_timeout(&compr_lpa_wakelock, 1.5 * HZ);
 
 	
 	switch (opcode) {
@@ -144,8 +245,11 @@ static void compr_event_handler(uint32_t opcode,
 		pr_debug("[%p] ASM_DATA_EVENT_WRITE_DONE\n", prtd);
 		pr_debug("[%p] Buffer Consumed = 0x%08x\n", prtd, *ptrmem);
 		prtd->pcm_irq_pos += prtd->pcm_count;
+		compr_consume(compr);
+		compr_stats.write_done++;
+		compr_stats.bytes += prtd->pcm_count;
 		if (atomic_read(&prtd->start))
-			snd_pcm_period_elapsed(substream);
+			queued = compr_period_done(compr);
 		else
 			if (substream->timer_running)
 				snd_timer_interrupt(substream->timer, 1);
@@ -156,7 +260,7 @@ static void compr_event_handler(uint32_t opcode,
 			break;
 		} else
 			atomic_set(&prtd->pending_buffer, 0);
-		if (runtime->status->hw_ptr >= runtime->control->appl_ptr)
+		if (!queued)
 			break;
 		buf = prtd->audio_client->port[IN].buf;
 		pr_debug("[%p] %s:writing %d bytes of buffer[%d] to dsp 2\n",
@@ -294,13 +398,15 @@ static void compr_event_handler(uint32_t opcode,
 				 prtd,
 				 output_meta_data.timestamp_msw,
 				 output_meta_data.timestamp_lsw);
-			param.paddr = (unsigned long)buf[prtd->out_head].phys
+			param.paddr = (unsigned long)buf[0].phys
+					+ (prtd->out_head * prtd->pcm_count)
 					+ output_meta_data.meta_data_length;
 			param.len = buffer_length;
 			param.msw_ts = output_meta_data.timestamp_msw;
 			param.lsw_ts = output_meta_data.timestamp_lsw;
 			param.flags = time_stamp_flag;
-			param.uid =  (unsigned long)buf[prtd->out_head].phys
+			param.uid =  (unsigned long)buf[0].phys
+					+ (prtd->out_head * prtd->pcm_count)
 					+ output_meta_data.meta_data_length;
 			if (q6asm_async_write(prtd->audio_client,
 						&param) < 0)
@@ -349,6 +455,8 @@ static int msm_compr_playback_prepare(struct snd_pcm_substream *substream)
 	prtd->channel_mode = runtime->channels;
 	prtd->out_head = 0;
 	atomic_set(&prtd->out_count, runtime->periods);
+	compr->consumed = runtime->status->hw_ptr;
+	compr->gapless.next_track = 0;
 
 	if (prtd->enabled)
 		return 0;
@@ -527,6 +635,7 @@ static int msm_compr_trigger(struct snd_pcm_substream *substream, int cmd)
 		pr_debug("[%p] %s: Trigger start/resume\n", prtd, __func__);
 		q6asm_run_nowait(prtd->audio_client, 0, 0, 0);
 		atomic_set(&prtd->start, 1);
+		compr_account_run(compr, 1);
 		
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
@@ -546,12 +655,15 @@ static int msm_compr_trigger(struct snd_pcm_substream *substream, int cmd)
 				0);
 		}
 		atomic_set(&prtd->start, 0);
+		compr_account_run(compr, 0);
+		wake_up(&the_locks.write_wait);
 		break;
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 		pr_debug("[%p] SNDRV_PCM_TRIGGER_PAUSE\n", prtd);
 		q6asm_cmd_nowait(prtd->audio_client, CMD_PAUSE);
 		atomic_set(&prtd->start, 0);
+		compr_account_run(compr, 0);
 		break;
 	default:
 		ret = -EINVAL;
@@ -639,6 +751,11 @@ static int msm_compr_open(struct snd_pcm_substream *substream)
 	if (ret < 0)
 		pr_info("[%p] snd_pcm_hw_constraint_integer failed\n", prtd);
 
+	ret = snd_pcm_hw_constraint_pow2(runtime, 0,
+			    SNDRV_PCM_HW_PARAM_PERIODS);
+	if (ret < 0)
+		pr_info("[%p] snd_pcm_hw_constraint_pow2 failed\n", prtd);
+
 	prtd->dsp_cnt = 0;
 	atomic_set(&prtd->pending_buffer, 1);
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
@@ -706,6 +823,7 @@ static int msm_compr_playback_close(struct snd_pcm_substream *substream)
 	dir = IN;
 	atomic_set(&prtd->pending_buffer, 0);
 	prtd->pcm_irq_pos = 0;
+	compr_account_run(compr, 0);
 	q6asm_cmd(prtd->audio_client, CMD_CLOSE);
 
 	str_name = (char*)rtd->dai_link->stream_name;
@@ -786,7 +904,7 @@ static snd_pcm_uframes_t msm_compr_pointer(struct snd_pcm_substream *substream)
 	struct msm_audio *prtd = &compr->prtd;
 
 	if (prtd->pcm_irq_pos >= prtd->pcm_size)
-		prtd->pcm_irq_pos = 0;
+		prtd->pcm_irq_pos %= prtd->pcm_size;
 
 	pr_debug("[%p] %s: pcm_irq_pos = %d, pcm_size = %d, sample_bits = %d,\n"
 			 "frame_bits = %d\n", prtd, __func__, prtd->pcm_irq_pos,
@@ -994,7 +1112,8 @@ static int msm_compr_ioctl(struct snd_pcm_substream *substream,
 	uint32_t eos_flush_check;
 	
 
-	wake_lock_timeout(&compr_lpa_wakelock, 3 * HZ);
+	if (cmd != SNDRV_COMPRESS_TSTAMP)
+		wake_lock_timeout(&compr_lpa_wakelock, 3 * HZ);
 	switch (cmd) {
 	case SNDRV_COMPRESS_TSTAMP: {
 		struct snd_compr_tstamp tstamp;
@@ -1078,6 +1197,7 @@ static int msm_compr_ioctl(struct snd_pcm_substream *substream,
 			compr->codec = FORMAT_LINEAR_PCM;
 			break;
 		}
+		compr->no_wake_mode = compr->info.codec_param.no_wake_mode;
 		return 0;
 	case SNDRV_PCM_IOCTL1_RESET:
 		pr_debug("[%p] %s: SNDRV_PCM_IOCTL1_RESET\n", prtd, __func__);
@@ -1116,8 +1236,13 @@ static int msm_compr_ioctl(struct snd_pcm_substream *substream,
 			}
 			
 			prtd->pcm_irq_pos = 0;
+			compr->gapless.next_track = 0;
+			wake_up(&the_locks.write_wait);
 		}
-		break;
+		rc = snd_pcm_lib_ioctl(substream, cmd, arg);
+		/* nothing is queued now, appl_ptr is set to hw_ptr after this */
+		compr->consumed = runtime->status->hw_ptr;
+		return rc;
 	case SNDRV_COMPRESS_DRAIN:
 		pr_debug("[%p] %s: SNDRV_COMPRESS_DRAIN\n", prtd, __func__);
 		atomic_set(&prtd->eos, 1);
@@ -1132,6 +1257,77 @@ static int msm_compr_ioctl(struct snd_pcm_substream *substream,
 			pr_err("[%p] SNDRV_COMPRESS_DRAIN EOS cmd timeout, rc = %d\n", prtd, rc);
 		pr_debug("[%p] %s: SNDRV_COMPRESS_DRAIN	out of wait\n", prtd, __func__);
 		return 0;
+	case SNDRV_COMPRESS_SET_METADATA: {
+		struct snd_compr_metadata metadata;
+
+		if (copy_from_user(&metadata, (void *) arg,
+			sizeof(struct snd_compr_metadata)))
+			return -EFAULT;
+		switch (metadata.key) {
+		case SNDRV_COMPRESS_ENCODER_DELAY:
+			if (compr->gapless.next_track)
+				compr->gapless.next_delay = metadata.value[0];
+			else
+				compr->gapless.encoder_delay = metadata.value[0];
+			break;
+		case SNDRV_COMPRESS_ENCODER_PADDING:
+			if (compr->gapless.next_track)
+				compr->gapless.next_padding = metadata.value[0];
+			else
+				compr->gapless.encoder_padding =
+							metadata.value[0];
+			break;
+		default:
+			return -EINVAL;
+		}
+		return 0;
+	}
+	case SNDRV_COMPRESS_GET_METADATA: {
+		struct snd_compr_metadata metadata;
+
+		if (copy_from_user(&metadata, (void *) arg,
+			sizeof(struct snd_compr_metadata)))
+			return -EFAULT;
+		switch (metadata.key) {
+		case SNDRV_COMPRESS_ENCODER_DELAY:
+			metadata.value[0] = compr->gapless.encoder_delay;
+			break;
+		case SNDRV_COMPRESS_ENCODER_PADDING:
+			metadata.value[0] = compr->gapless.encoder_padding;
+			break;
+		default:
+			return -EINVAL;
+		}
+		if (copy_to_user((void *) arg, &metadata,
+			sizeof(struct snd_compr_metadata)))
+			return -EFAULT;
+		return 0;
+	}
+	case SNDRV_COMPRESS_NEXT_TRACK:
+		pr_debug("[%p] %s: SNDRV_COMPRESS_NEXT_TRACK\n", prtd, __func__);
+		if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK)
+			return -EINVAL;
+		compr->gapless.track_end = runtime->control->appl_ptr;
+		compr->gapless.next_track = 1;
+		return 0;
+	case SNDRV_COMPRESS_PARTIAL_DRAIN:
+		pr_debug("[%p] %s: SNDRV_COMPRESS_PARTIAL_DRAIN\n", prtd, __func__);
+		if (!compr->gapless.next_track)
+			return -EPERM;
+		compr_stats.partial_drains++;
+		
+		rc = wait_event_interruptible(the_locks.write_wait,
+			!atomic_read(&prtd->start) ||
+			!compr->gapless.next_track ||
+			compr_track_drained(compr));
+		if (rc < 0)
+			return rc;
+		compr->gapless.next_track = 0;
+		compr->gapless.encoder_delay = compr->gapless.next_delay;
+		compr->gapless.encoder_padding = compr->gapless.next_padding;
+		compr->gapless.next_delay = 0;
+		compr->gapless.next_padding = 0;
+		return 0;
 	case SNDRV_PCM_IOCTL1_ENABLE_EFFECT:
 	{
 		struct param {
@@ -1273,6 +1469,41 @@ static struct platform_driver msm_compr_driver = {
 	.remove = __devexit_p(msm_compr_remove),
 };
 
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *compr_stats_dentry;
+
+static int compr_stats_show(struct seq_file *s, void *unused)
+{
+	struct compr_wakeup_stats st = compr_stats;
+	u64 per_min = 0;
+
+	if (st.run_ms)
+		per_min = div64_u64((u64)st.write_done * 60000, st.run_ms);
+	seq_printf(s, "run_ms:           %llu\n", st.run_ms);
+	seq_printf(s, "bytes:            %llu\n", st.bytes);
+	seq_printf(s, "write_done:       %u\n", st.write_done);
+	seq_printf(s, "write_done/min:   %llu\n", per_min);
+	seq_printf(s, "user_wakeups:     %u\n", st.user_wakeups);
+	seq_printf(s, "skipped_wakeups:  %u\n", st.skipped_wakeups);
+	seq_printf(s, "refill_wakelocks: %u\n", st.refill_wakelocks);
+	seq_printf(s, "starved:          %u\n", st.starved);
+	seq_printf(s, "partial_drains:   %u\n", st.partial_drains);
+	return 0;
+}
+
+static int compr_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, compr_stats_show, NULL);
+}
+
+static const struct file_operations compr_stats_fops = {
+	.open		= compr_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 static int __init msm_soc_platform_init(void)
 {
 	init_waitqueue_head(&the_locks.enable_wait);
@@ -1283,6 +1514,10 @@ static int __init msm_soc_platform_init(void)
 
 	wake_lock_init(&compr_lpa_wakelock, WAKE_LOCK_SUSPEND,
 				"compr_lpa");
+#ifdef CONFIG_DEBUG_FS
+	compr_stats_dentry = debugfs_create_file("msm_compr_wakeups",
+				S_IRUGO, NULL, NULL, &compr_stats_fops);
+#endif
 
 	return platform_driver_register(&msm_compr_driver);
 }
@@ -1290,6 +1525,9 @@ module_init(msm_soc_platform_init);
 
 static void __exit msm_soc_platform_exit(void)
 {
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove(compr_stats_dentry);
+#endif
 	platform_driver_unregister(&msm_compr_driver);
 }
 module_exit(msm_soc_platform_exit);
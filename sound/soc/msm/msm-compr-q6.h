@@ -13,6 +13,7 @@
 
 #ifndef _MSM_COMPR_H
 #define _MSM_COMPR_H
+#include <linux/ktime.h>
 #include <sound/apr_audio.h>
 #include <sound/q6asm.h>
 #include <sound/compress_params.h>
@@ -27,10 +28,23 @@ struct compr_info {
 	struct snd_compr_params codec_param;
 };
 
+struct compr_gapless_state {
+	uint32_t encoder_delay;
+	uint32_t encoder_padding;
+	uint32_t next_delay;
+	uint32_t next_padding;
+	snd_pcm_uframes_t track_end;
+	int next_track;
+};
+
 struct compr_audio {
 	struct msm_audio prtd;
 	struct compr_info info;
 	uint32_t codec;
+	struct compr_gapless_state gapless;
+	int no_wake_mode;
+	snd_pcm_uframes_t consumed;
+	ktime_t run_start;
 };
 
 struct msm_compr_q6_ops {
@@ -0,0 +1,128 @@
+#!/usr/bin/env python
+#
+# boot_timeline.py - render /sys/kernel/debug/boot_timeline as SVG
+#
+# Each task (initcall thread, async worker, ...) gets a row; initcalls,
+# driver probes and async calls are drawn as bars on that row, and
+# initcall levels as shaded bands behind everything.  Only entries
+# longer than the -m threshold are labelled.
+#
+#   adb shell cat /sys/kernel/debug/boot_timeline > timeline.txt
+#   boot_timeline.py [-m min_us] timeline.txt > timeline.svg
+#
+# Licensed under the terms of the GNU GPL License version 2
+
+import sys
+import getopt
+
+COLORS = {
+	'initcall': '#4a90d9',
+	'probe': '#e8a33d',
+	'async': '#59b26b',
+}
+LEVEL_COLORS = ['#f4f4f4', '#e8e8e8']
+ROW_H = 18
+LEFT = 80
+WIDTH = 1600
+
+
+def usage():
+	sys.stderr.write("usage: %s [-m min_us] [timeline.txt]\n" % sys.argv[0])
+	sys.exit(1)
+
+
+def parse(f):
+	entries = []
+	for line in f:
+		if line.startswith('#'):
+			continue
+		parts = line.rstrip('\n').split(' ', 6)
+		if len(parts) != 7:
+			continue
+		kind, cpu, pid, start, end, ret, name = parts
+		entries.append((kind, int(cpu), int(pid), int(start),
+				int(end), int(ret), name))
+	return entries
+
+
+def esc(s):
+	return s.replace('&', '&amp;').replace('<', '&lt;').replace('>', '&gt;')
+
+
+def render(entries, min_us):
+	if not entries:
+		sys.stderr.write("no timeline entries\n")
+		sys.exit(1)
+
+	t0 = min(e[3] for e in entries)
+	t1 = max(e[4] for e in entries)
+	scale = float(WIDTH) / max(t1 - t0, 1)
+
+	rows = {}
+	for e in entries:
+		if e[0] != 'level' and e[2] not in rows:
+			rows[e[2]] = len(rows)
+
+	height = (len(rows) + 2) * ROW_H
+	out = []
+	out.append('<svg xmlns="http://www.w3.org/2000/svg" width="%d" '
+		   'height="%d" font-family="sans-serif" font-size="10">' %
+		   (LEFT + WIDTH + 20, height + 20))
+
+	n = 0
+	for e in entries:
+		if e[0] != 'level':
+			continue
+		x = LEFT + (e[3] - t0) * scale
+		w = max((e[4] - e[3]) * scale, 1)
+		out.append('<rect x="%.1f" y="0" width="%.1f" height="%d" '
+			   'fill="%s"/>' % (x, w, height, LEVEL_COLORS[n % 2]))
+		out.append('<text x="%.1f" y="%d">level %s</text>' %
+			   (x + 2, height + 12, esc(e[6])))
+		n += 1
+
+	for pid, row in rows.items():
+		out.append('<text x="2" y="%d">pid %d</text>' %
+			   ((row + 1) * ROW_H - 5, pid))
+
+	for e in entries:
+		kind, cpu, pid, start, end, ret, name = e
+		if kind == 'level':
+			continue
+		y = rows[pid] * ROW_H + 2
+		if kind == 'probe':
+			y += ROW_H / 3
+		x = LEFT + (start - t0) * scale
+		w = max((end - start) * scale, 0.5)
+		title = '%s %s cpu%d %d us ret %d' % (kind, name, cpu,
+						      end - start, ret)
+		out.append('<rect x="%.1f" y="%d" width="%.1f" height="%d" '
+			   'fill="%s"><title>%s</title></rect>' %
+			   (x, y, w, ROW_H - 4 - (y - rows[pid] * ROW_H - 2),
+			    COLORS.get(kind, '#999'), esc(title)))
+		if end - start >= min_us:
+			out.append('<text x="%.1f" y="%d">%s</text>' %
+				   (x + 1, y + 10, esc(name)))
+
+	out.append('</svg>')
+	return '\n'.join(out)
+
+
+def main():
+	min_us = 10000
+	try:
+		opts, args = getopt.getopt(sys.argv[1:], 'm:')
+	except getopt.GetoptError:
+		usage()
+	for o, a in opts:
+		if o == '-m':
+			min_us = int(a)
+	if len(args) > 1:
+		usage()
+
+	f = open(args[0]) if args else sys.stdin
+	print(render(parse(f), min_us))
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,177 @@
+/*
+ * ashmem_pin_bench:
+ *
+ * Measure ASHMEM_PIN/ASHMEM_UNPIN throughput from several threads at
+ * once.  Each thread owns its own region and repeatedly unpins and
+ * re-pins one page-aligned chunk at a time, the way cursor windows and
+ * graphics buffers are handled.  With -s all threads share one region.
+ * Contention counters are in /sys/kernel/debug/ashmem_stats.
+ *
+ *   ashmem_pin_bench [-t threads] [-d seconds] [-p pages] [-s]
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ASHMEM_NAME_LEN		256
+
+struct ashmem_pin {
+	__u32 offset;
+	__u32 len;
+};
+
+#define __ASHMEMIOC		0x77
+#define ASHMEM_SET_NAME		_IOW(__ASHMEMIOC, 1, char[ASHMEM_NAME_LEN])
+#define ASHMEM_SET_SIZE		_IOW(__ASHMEMIOC, 3, size_t)
+#define ASHMEM_PIN		_IOW(__ASHMEMIOC, 7, struct ashmem_pin)
+#define ASHMEM_UNPIN		_IOW(__ASHMEMIOC, 8, struct ashmem_pin)
+
+#define MAX_THREADS	64
+
+static int nthreads = 1;
+static int duration = 5;
+static int npages = 64;
+static int shared;
+static long page_size;
+static volatile int stop;
+
+struct worker {
+	pthread_t thread;
+	int fd;
+	int id;
+	unsigned long ops;
+	unsigned long purged;
+	unsigned long errors;
+};
+
+static void die(const char *msg)
+{
+	perror(msg);
+	exit(1);
+}
+
+static int region_create(void)
+{
+	char name[ASHMEM_NAME_LEN] = "pin_bench";
+	void *p;
+	int fd;
+
+	fd = open("/dev/ashmem", O_RDWR);
+	if (fd < 0)
+		return -1;
+	ioctl(fd, ASHMEM_SET_NAME, name);
+	if (ioctl(fd, ASHMEM_SET_SIZE, (size_t)npages * page_size) < 0)
+		die("ASHMEM_SET_SIZE");
+	p = mmap(NULL, npages * page_size, PROT_READ | PROT_WRITE,
+		 MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		die("mmap");
+	memset(p, 0xa5, npages * page_size);
+	return fd;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct ashmem_pin pin;
+	unsigned int page = w->id;
+	int ret;
+
+	pin.len = page_size;
+	while (!stop) {
+		pin.offset = (page % npages) * page_size;
+		page += nthreads;
+
+		if (ioctl(w->fd, ASHMEM_UNPIN, &pin) < 0) {
+			w->errors++;
+			continue;
+		}
+		ret = ioctl(w->fd, ASHMEM_PIN, &pin);
+		if (ret < 0)
+			w->errors++;
+		else if (ret)
+			w->purged++;
+		w->ops += 2;
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	struct worker w[MAX_THREADS];
+	unsigned long ops = 0, purged = 0, errors = 0;
+	int opt, i, fd = -1;
+
+	while ((opt = getopt(argc, argv, "t:d:p:s")) != -1) {
+		switch (opt) {
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'p':
+			npages = atoi(optarg);
+			break;
+		case 's':
+			shared = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t threads] [-d seconds] "
+				"[-p pages] [-s]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nthreads < 1 || nthreads > MAX_THREADS) {
+		fprintf(stderr, "threads must be 1..%d\n", MAX_THREADS);
+		return 1;
+	}
+	if (npages < 1) {
+		fprintf(stderr, "pages must be at least 1\n");
+		return 1;
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+	memset(w, 0, sizeof(w));
+	for (i = 0; i < nthreads; i++) {
+		if (!shared || fd < 0)
+			fd = region_create();
+		if (fd < 0) {
+			if (errno == ENOENT) {
+				printf("/dev/ashmem not present, skipping\n");
+				return 0;
+			}
+			die("/dev/ashmem");
+		}
+		w[i].fd = fd;
+		w[i].id = i;
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&w[i].thread, NULL, worker_fn, &w[i]);
+
+	sleep(duration);
+	stop = 1;
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(w[i].thread, NULL);
+		ops += w[i].ops;
+		purged += w[i].purged;
+		errors += w[i].errors;
+	}
+
+	printf("threads %d%s: %.0f pin+unpin/s (%lu ops, %lu purged, "
+	       "%lu errors)\n", nthreads, shared ? " shared" : "",
+	       (double)ops / duration, ops, purged, errors);
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * smallfile_bench:
+ *
+ * Create, fsync and read back a large number of small files, the way
+ * app databases, preferences and thumbnails are written, and report
+ * throughput and the space consumed on the filesystem.  Every file gets
+ * its own byte pattern, and the read back checks both the size and the
+ * contents.  Run it on an ext4 mount with and without the inline_data
+ * option to compare.
+ *
+ *   smallfile_bench [-d dir] [-n files] [-s bytes] [-k]
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static long long fs_used(const char *dir)
+{
+	struct statvfs st;
+
+	if (statvfs(dir, &st) < 0) {
+		perror("statvfs");
+		exit(1);
+	}
+	return (long long)(st.f_blocks - st.f_bfree) * st.f_frsize;
+}
+
+static void fill(char *buf, int size, int seed)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = 'a' + (seed + i) % 26;
+}
+
+static void drop_caches(void)
+{
+	int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+
+	sync();
+	if (fd < 0)
+		return;
+	if (write(fd, "3\n", 2) < 0)
+		perror("drop_caches");
+	close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *dir = "/data/local/tmp/smallfile_bench";
+	int nfiles = 2000, size = 256, keep = 0;
+	long long used, blocks = 0;
+	double t0, create, readback;
+	char path[4096], *buf, *rbuf;
+	struct stat st;
+	int c, i, fd;
+
+	while ((c = getopt(argc, argv, "d:n:s:k")) != -1) {
+		switch (c) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 'n':
+			nfiles = atoi(optarg);
+			break;
+		case 's':
+			size = atoi(optarg);
+			break;
+		case 'k':
+			keep = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d dir] [-n files] "
+				"[-s bytes] [-k]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nfiles <= 0 || size <= 0)
+		return 1;
+
+	buf = malloc(size);
+	rbuf = malloc(size + 1);
+	if (!buf || !rbuf)
+		return 1;
+
+	if (mkdir(dir, 0700) < 0 && errno != EEXIST) {
+		perror(dir);
+		return 1;
+	}
+	sync();
+	used = fs_used(dir);
+
+	t0 = now();
+	for (i = 0; i < nfiles; i++) {
+		snprintf(path, sizeof(path), "%s/f%06d", dir, i);
+		fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+		if (fd < 0) {
+			perror(path);
+			return 1;
+		}
+		fill(buf, size, i);
+		if (write(fd, buf, size) != size || fsync(fd) < 0) {
+			perror(path);
+			return 1;
+		}
+		close(fd);
+	}
+	create = now() - t0;
+	sync();
+	used = fs_used(dir) - used;
+
+	drop_caches();
+	t0 = now();
+	for (i = 0; i < nfiles; i++) {
+		snprintf(path, sizeof(path), "%s/f%06d", dir, i);
+		fd = open(path, O_RDONLY);
+		if (fd < 0 || fstat(fd, &st) < 0) {
+			perror(path);
+			return 1;
+		}
+		fill(buf, size, i);
+		if (st.st_size != size || read(fd, rbuf, size + 1) != size ||
+		    memcmp(buf, rbuf, size)) {
+			fprintf(stderr, "%s: data mismatch\n", path);
+			return 1;
+		}
+		blocks += st.st_blocks;
+		close(fd);
+	}
+	readback = now() - t0;
+
+	printf("size %6d files %6d: create+fsync %8.0f files/s, "
+	       "read %8.0f files/s, %lld KB used, %lld blocks in files\n",
+	       size, nfiles, nfiles / create, nfiles / readback,
+	       used / 1024, blocks);
+
+	if (!keep) {
+		for (i = 0; i < nfiles; i++) {
+			snprintf(path, sizeof(path), "%s/f%06d", dir, i);
+			unlink(path);
+		}
+		rmdir(dir);
+	}
+	free(rbuf);
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * conn_setup_rate:
+ *
+ * Measure how many short-lived TCP connections per second can be set
+ * up and torn down over loopback from several threads at once.  Every
+ * connection creates and destroys a conntrack entry when conntrack is
+ * loaded, so this exercises the conntrack insert/delete paths under
+ * contention.  See run_conntrack_bench.
+ *
+ *   conn_setup_rate [-t threads] [-d seconds] [-p port]
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_PORT	5301
+#define MAX_THREADS	64
+
+static int port = DEFAULT_PORT;
+static int nthreads = 1;
+static int duration = 5;
+static volatile int stop;
+
+struct worker {
+	pthread_t thread;
+	int lfd;
+	int port;
+	unsigned long conns;
+	unsigned long errors;
+};
+
+static void die(const char *msg)
+{
+	perror(msg);
+	exit(1);
+}
+
+static int listen_on(int p)
+{
+	struct sockaddr_in sin;
+	int one = 1;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		die("socket");
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = htons(p);
+	if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+		die("bind");
+	if (listen(fd, 128) < 0)
+		die("listen");
+	return fd;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct linger lin = { .l_onoff = 1, .l_linger = 0 };
+	struct sockaddr_in sin;
+	int fd, afd;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = htons(w->port);
+
+	while (!stop) {
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			w->errors++;
+			continue;
+		}
+
+		setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+		if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+			w->errors++;
+			close(fd);
+			continue;
+		}
+		afd = accept(w->lfd, NULL, NULL);
+		if (afd < 0) {
+			w->errors++;
+			close(fd);
+			continue;
+		}
+		close(fd);
+		close(afd);
+		w->conns++;
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	struct worker w[MAX_THREADS];
+	unsigned long total = 0, errors = 0;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "t:d:p:")) != -1) {
+		switch (opt) {
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t threads] [-d seconds] "
+				"[-p port]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nthreads < 1 || nthreads > MAX_THREADS) {
+		fprintf(stderr, "threads must be 1..%d\n", MAX_THREADS);
+		return 1;
+	}
+
+	memset(w, 0, sizeof(w));
+	for (i = 0; i < nthreads; i++) {
+		w[i].port = port + i;
+		w[i].lfd = listen_on(w[i].port);
+		pthread_create(&w[i].thread, NULL, worker_fn, &w[i]);
+	}
+
+	sleep(duration);
+	stop = 1;
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(w[i].thread, NULL);
+		close(w[i].lfd);
+		total += w[i].conns;
+		errors += w[i].errors;
+	}
+
+	printf("threads %d: %.0f conn/s (%lu connections, %lu errors)\n",
+	       nthreads, (double)total / duration, total, errors);
+	return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * tcp_tsq_latency:
+ *
+ * Measure the round trip latency of a small request/response TCP flow
+ * while a bulk TCP flow saturates the same path.  Used to evaluate
+ * TCP Small Queues (net.ipv4.tcp_limit_output_bytes).
+ *
+ * By default both flows run over loopback.  To exercise a real qdisc,
+ * run the sink side on the peer of a veth pair (see run_tsq_bench) and
+ * pass its address with -a.
+ *
+ *   tcp_tsq_latency [-a addr] [-p port] [-n samples] [-s]
+ *
+ *   -s   server mode: only run the bulk sink and echo server
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BULK_CHUNK	65536
+#define DEFAULT_PORT	5201
+#define DEFAULT_SAMPLES	1000
+
+static const char *addr = "127.0.0.1";
+static int port = DEFAULT_PORT;
+static int samples = DEFAULT_SAMPLES;
+static volatile int stop;
+
+static void die(const char *msg)
+{
+	perror(msg);
+	exit(1);
+}
+
+static int listen_on(int p)
+{
+	struct sockaddr_in sin;
+	int one = 1;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		die("socket");
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	sin.sin_port = htons(p);
+	if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+		die("bind");
+	if (listen(fd, 4) < 0)
+		die("listen");
+	return fd;
+}
+
+static int connect_to(int p)
+{
+	struct sockaddr_in sin;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		die("socket");
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(p);
+	if (inet_pton(AF_INET, addr, &sin.sin_addr) != 1)
+		die("inet_pton");
+	if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+		die("connect");
+	return fd;
+}
+
+static void *bulk_sink(void *arg)
+{
+	int lfd = (long)arg;
+	static char buf[BULK_CHUNK];
+	int fd;
+
+	fd = accept(lfd, NULL, NULL);
+	if (fd < 0)
+		die("accept");
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+	close(fd);
+	return NULL;
+}
+
+static void *echo_server(void *arg)
+{
+	int lfd = (long)arg;
+	int one = 1;
+	char c;
+	int fd;
+
+	fd = accept(lfd, NULL, NULL);
+	if (fd < 0)
+		die("accept");
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	while (read(fd, &c, 1) == 1)
+		if (write(fd, &c, 1) != 1)
+			break;
+	close(fd);
+	return NULL;
+}
+
+static void *bulk_source(void *arg)
+{
+	static char buf[BULK_CHUNK];
+	long long *sent = arg;
+	int fd;
+	ssize_t n;
+
+	fd = connect_to(port);
+	while (!stop) {
+		n = write(fd, buf, sizeof(buf));
+		if (n <= 0)
+			break;
+		*sent += n;
+	}
+	close(fd);
+	return NULL;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void run_servers(pthread_t *t)
+{
+	int bulk_lfd = listen_on(port);
+	int echo_lfd = listen_on(port + 1);
+
+	pthread_create(&t[0], NULL, bulk_sink, (void *)(long)bulk_lfd);
+	pthread_create(&t[1], NULL, echo_server, (void *)(long)echo_lfd);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t srv[2], bulk;
+	long long sent = 0;
+	double *rtt, start, elapsed;
+	int server_only = 0;
+	int one = 1;
+	int opt, fd, i;
+	char c = 'x';
+
+	while ((opt = getopt(argc, argv, "a:p:n:s")) != -1) {
+		switch (opt) {
+		case 'a':
+			addr = optarg;
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'n':
+			samples = atoi(optarg);
+			break;
+		case 's':
+			server_only = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-a addr] [-p port] "
+				"[-n samples] [-s]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (server_only) {
+		run_servers(srv);
+		pthread_join(srv[0], NULL);
+		pthread_join(srv[1], NULL);
+		return 0;
+	}
+
+	if (!strcmp(addr, "127.0.0.1"))
+		run_servers(srv);
+
+	rtt = calloc(samples, sizeof(*rtt));
+	if (!rtt)
+		die("calloc");
+
+	pthread_create(&bulk, NULL, bulk_source, &sent);
+	usleep(200000);
+
+	fd = connect_to(port + 1);
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	start = now_us();
+	for (i = 0; i < samples; i++) {
+		double t0 = now_us();
+
+		if (write(fd, &c, 1) != 1 || read(fd, &c, 1) != 1)
+			die("echo");
+		rtt[i] = now_us() - t0;
+		usleep(1000);
+	}
+	elapsed = now_us() - start;
+	stop = 1;
+	close(fd);
+	pthread_join(bulk, NULL);
+
+	qsort(rtt, samples, sizeof(*rtt), cmp_double);
+	printf("interactive rtt us: p50 %.0f p90 %.0f p99 %.0f max %.0f\n",
+	       rtt[samples / 2], rtt[samples * 9 / 10],
+	       rtt[samples * 99 / 100], rtt[samples - 1]);
+	printf("bulk throughput: %.1f Mbit/s\n", sent * 8 / elapsed);
+	free(rtt);
+	return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * tsb_bench:
+ *
+ * Compare the cost of collecting per-process statistics by reading
+ * /proc/<pid>/stat and /proc/<pid>/statm for every pid, the way system
+ * monitors sample the process list, with a single read of
+ * /dev/taskstats_bulk.  With -c the device is read in incremental mode,
+ * with -t one record per thread is requested.
+ *
+ *   tsb_bench [-n iterations] [-c] [-t]
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define TSB_VERSION		1
+#define TSB_MAX_PIDS		64
+#define TSB_THREADS		0x4
+#define TSB_CHANGED		0x8
+#define TSB_TRUNCATED		0x1
+
+struct tsb_filter {
+	__u32 flags;
+	__u32 uid;
+	__u32 nr_pids;
+	__u32 pids[TSB_MAX_PIDS];
+};
+
+struct tsb_header {
+	__u16 version;
+	__u16 record_size;
+	__u32 flags;
+	__u64 generation;
+	__u64 since;
+	__u32 nr_records;
+	__u32 nr_tasks;
+};
+
+#define TSB_IOC_MAGIC 0xB8
+#define TSB_IOC_SET_FILTER _IOW(TSB_IOC_MAGIC, 1, struct tsb_filter)
+
+#define BUF_SIZE	(1024 * 1024)
+
+static int iterations = 100;
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int read_file(const char *path, char *buf, size_t len)
+{
+	int fd, n;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	n = read(fd, buf, len - 1);
+	close(fd);
+	if (n < 0)
+		return -1;
+	buf[n] = '\0';
+	return n;
+}
+
+static int proc_scan(void)
+{
+	unsigned long utime, stime, minflt, majflt, size, rss;
+	char path[300], buf[1024], *p;
+	struct dirent *de;
+	int found = 0;
+	DIR *dir;
+
+	dir = opendir("/proc");
+	if (!dir) {
+		perror("/proc");
+		exit(1);
+	}
+	while ((de = readdir(dir))) {
+		if (!isdigit(de->d_name[0]))
+			continue;
+		snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
+		if (read_file(path, buf, sizeof(buf)) < 0)
+			continue;
+		p = strrchr(buf, ')');
+		if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %lu %*u "
+				 "%lu %*u %lu %lu", &minflt, &majflt, &utime,
+				 &stime) != 4)
+			continue;
+		snprintf(path, sizeof(path), "/proc/%s/statm", de->d_name);
+		if (read_file(path, buf, sizeof(buf)) < 0)
+			continue;
+		if (sscanf(buf, "%lu %lu", &size, &rss) != 2)
+			continue;
+		found++;
+	}
+	closedir(dir);
+	return found;
+}
+
+static int tsb_scan(int fd, char *buf, unsigned int *tasks)
+{
+	struct tsb_header *hdr = (struct tsb_header *)buf;
+
+	if (read(fd, buf, BUF_SIZE) < (ssize_t)sizeof(*hdr)) {
+		perror("read");
+		exit(1);
+	}
+	if (hdr->version != TSB_VERSION) {
+		fprintf(stderr, "unexpected version %u\n", hdr->version);
+		exit(1);
+	}
+	if (hdr->flags & TSB_TRUNCATED)
+		fprintf(stderr, "warning: snapshot truncated\n");
+	*tasks = hdr->nr_tasks;
+	return hdr->nr_records;
+}
+
+int main(int argc, char **argv)
+{
+	struct tsb_filter filter;
+	unsigned long records = 0;
+	unsigned int tasks = 0;
+	double t0, proc_us, tsb_us;
+	int opt, i, fd, found = 0;
+	char *buf;
+
+	memset(&filter, 0, sizeof(filter));
+	while ((opt = getopt(argc, argv, "n:ct")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'c':
+			filter.flags |= TSB_CHANGED;
+			break;
+		case 't':
+			filter.flags |= TSB_THREADS;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations] [-c] [-t]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 1) {
+		fprintf(stderr, "iterations must be at least 1\n");
+		return 1;
+	}
+
+	fd = open("/dev/taskstats_bulk", O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT) {
+			printf("/dev/taskstats_bulk not present, skipping\n");
+			return 0;
+		}
+		perror("/dev/taskstats_bulk");
+		return 1;
+	}
+	if (ioctl(fd, TSB_IOC_SET_FILTER, &filter) < 0) {
+		perror("TSB_IOC_SET_FILTER");
+		return 1;
+	}
+	buf = malloc(BUF_SIZE);
+	if (!buf) {
+		perror("malloc");
+		return 1;
+	}
+
+	t0 = now();
+	for (i = 0; i < iterations; i++)
+		found = proc_scan();
+	proc_us = (now() - t0) * 1e6 / iterations;
+
+	/* the first incremental read returns everything */
+	if (filter.flags & TSB_CHANGED)
+		tsb_scan(fd, buf, &tasks);
+
+	t0 = now();
+	for (i = 0; i < iterations; i++)
+		records += tsb_scan(fd, buf, &tasks);
+	tsb_us = (now() - t0) * 1e6 / iterations;
+
+	printf("/proc scan: %.0f us (%d processes)\n", proc_us, found);
+	printf("taskstats_bulk%s%s: %.0f us (%u tasks, %.1f records/read), "
+	       "%.1fx\n", filter.flags & TSB_THREADS ? " threads" : "",
+	       filter.flags & TSB_CHANGED ? " changed" : "", tsb_us, tasks,
+	       (double)records / iterations, proc_us / tsb_us);
+
+	free(buf);
+	close(fd);
+	return 0;
+}